@@ -0,0 +1,241 @@
+#include "HydraEngine/Base.h"
+
+import HE;
+import std;
+import HRay;
+import Editor;
+
+// Minimal single part scanline OpenEXR writer, reference: https://openexr.com/en/latest/OpenEXRFileLayout.html
+
+template<typename T>
+static void Write(std::vector<uint8_t>& out, T value)
+{
+    auto bytes = std::bit_cast<std::array<uint8_t, sizeof(T)>>(value);
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+static void WriteString(std::vector<uint8_t>& out, std::string_view str)
+{
+    out.insert(out.end(), str.begin(), str.end());
+    out.push_back(0);
+}
+
+static void WriteAttribute(std::vector<uint8_t>& out, std::string_view name, std::string_view type, uint32_t size)
+{
+    WriteString(out, name);
+    WriteString(out, type);
+    Write<int32_t>(out, size);
+}
+
+// Same byte stream as OpenEXR's RLE compressor : split even / odd bytes, delta encode, then run length encode.
+// Returns false if the result is not smaller than the input, in which case the block is stored raw.
+static bool CompressRLE(const std::vector<uint8_t>& in, std::vector<uint8_t>& out)
+{
+    constexpr int c_MinRunLength = 3;
+    constexpr int c_MaxRunLength = 127;
+
+    // nothing to gain on an empty line, stored raw
+    size_t size = in.size();
+    if (size == 0)
+        return false;
+
+    std::vector<uint8_t> tmp(size);
+
+    {
+        size_t half = (size + 1) / 2;
+        for (size_t i = 0; i < size; i++)
+            tmp[(i & 1) ? half + i / 2 : i / 2] = in[i];
+    }
+
+    {
+        int p = tmp[0];
+        for (size_t i = 1; i < size; i++)
+        {
+            int d = int(tmp[i]) - p + (128 + 256);
+            p = tmp[i];
+            tmp[i] = uint8_t(d);
+        }
+    }
+
+    out.clear();
+    out.reserve(size);
+
+    size_t runStart = 0;
+    size_t runEnd = 1;
+
+    while (runStart < size)
+    {
+        while (runEnd < size && tmp[runStart] == tmp[runEnd] && runEnd - runStart - 1 < c_MaxRunLength)
+            ++runEnd;
+
+        if (runEnd - runStart >= c_MinRunLength)
+        {
+            out.push_back(uint8_t(int8_t(runEnd - runStart - 1)));
+            out.push_back(tmp[runStart]);
+            runStart = runEnd;
+        }
+        else
+        {
+            while (runEnd < size &&
+                ((runEnd + 1 >= size || tmp[runEnd] != tmp[runEnd + 1]) || (runEnd + 2 >= size || tmp[runEnd + 1] != tmp[runEnd + 2])) &&
+                runEnd - runStart < c_MaxRunLength)
+            {
+                ++runEnd;
+            }
+
+            out.push_back(uint8_t(int8_t(-int(runEnd - runStart))));
+            while (runStart < runEnd)
+                out.push_back(tmp[runStart++]);
+        }
+
+        ++runEnd;
+
+        if (out.size() >= size)
+            return false;
+    }
+
+    return true;
+}
+
+bool Editor::WriteEXR(const std::string& filePath, uint32_t width, uint32_t height, const uint8_t* data, size_t rowPitch, EXRPixelType pixelType, EXRCompression compression)
+{
+    const size_t rowSize = size_t(width) * sizeof(float) * 4;
+
+    return WriteEXR(filePath, width, height, 64, [&](uint32_t y, uint32_t count, uint8_t* dst) {
+
+        for (uint32_t i = 0; i < count; i++)
+            std::memcpy(dst + i * rowSize, data + (y + i) * rowPitch, rowSize);
+
+    }, pixelType, compression);
+}
+
+bool Editor::WriteEXR(const std::string& filePath, uint32_t width, uint32_t height, uint32_t bandHeight, const ReadRowsFn& readRows, EXRPixelType pixelType, EXRCompression compression)
+{
+    HE_PROFILE_FUNCTION();
+
+    // channels are stored in alphabetical order
+    constexpr std::array<const char*, 4> c_ChannelNames = { "A", "B", "G", "R" };
+    constexpr std::array<uint32_t, 4> c_ChannelSource = { 3, 2, 1, 0 };
+
+    const uint32_t pixelSize = pixelType == EXRPixelType::Half ? 2 : 4;
+    const size_t lineSize = size_t(width) * pixelSize * c_ChannelNames.size();
+    const size_t rowSize = size_t(width) * sizeof(float) * 4;
+
+    std::vector<uint8_t> header;
+    {
+        Write<uint32_t>(header, 20000630);
+        Write<uint32_t>(header, 2);
+
+        WriteAttribute(header, "channels", "chlist", uint32_t(c_ChannelNames.size() * (2 + 16) + 1));
+        for (auto name : c_ChannelNames)
+        {
+            WriteString(header, name);
+            Write<int32_t>(header, pixelType == EXRPixelType::Half ? 1 : 2);
+            Write<uint32_t>(header, 0); // pLinear + reserved
+            Write<int32_t>(header, 1);  // xSampling
+            Write<int32_t>(header, 1);  // ySampling
+        }
+        header.push_back(0);
+
+        WriteAttribute(header, "compression", "compression", 1);
+        header.push_back(compression == EXRCompression::RLE ? 1 : 0);
+
+        for (auto name : { "dataWindow", "displayWindow" })
+        {
+            WriteAttribute(header, name, "box2i", 16);
+            Write<int32_t>(header, 0);
+            Write<int32_t>(header, 0);
+            Write<int32_t>(header, int32_t(width) - 1);
+            Write<int32_t>(header, int32_t(height) - 1);
+        }
+
+        WriteAttribute(header, "lineOrder", "lineOrder", 1);
+        header.push_back(0); // INCREASING_Y
+
+        WriteAttribute(header, "pixelAspectRatio", "float", 4);
+        Write<float>(header, 1.0f);
+
+        WriteAttribute(header, "screenWindowCenter", "v2f", 8);
+        Write<float>(header, 0.0f);
+        Write<float>(header, 0.0f);
+
+        WriteAttribute(header, "screenWindowWidth", "float", 4);
+        Write<float>(header, 1.0f);
+
+        header.push_back(0);
+    }
+
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file)
+        return false;
+
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    // the offset table is filled in once every block is written
+    std::vector<uint64_t> offsets(height);
+    file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    uint64_t offset = header.size() + sizeof(uint64_t) * height;
+
+    // the image is streamed in bands, only one band of source rows and encoded blocks is in memory.
+    // uncompressed and RLE files both use one scanline per block, the blocks of a band are encoded in parallel
+    bandHeight = std::max(bandHeight, 1u);
+    std::vector<uint8_t> band(rowSize * std::min(bandHeight, height));
+    std::vector<std::vector<uint8_t>> blocks(std::min(bandHeight, height));
+
+    for (uint32_t bandStart = 0; bandStart < height; bandStart += bandHeight)
+    {
+        uint32_t count = std::min(bandHeight, height - bandStart);
+        readRows(bandStart, count, band.data());
+
+        HRay::ParallelFor(count, 8, [&](uint32_t i) {
+
+            uint32_t y = bandStart + i;
+            const float* row = reinterpret_cast<const float*>(band.data() + i * rowSize);
+
+            std::vector<uint8_t> line(lineSize);
+            uint8_t* dst = line.data();
+
+            for (uint32_t c = 0; c < c_ChannelNames.size(); c++)
+            {
+                uint32_t src = c_ChannelSource[c];
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    float value = row[x * 4 + src];
+                    if (pixelType == EXRPixelType::Half)
+                    {
+                        uint16_t half = HRay::FloatToHalf(value);
+                        std::memcpy(dst, &half, sizeof(half));
+                    }
+                    else
+                    {
+                        std::memcpy(dst, &value, sizeof(value));
+                    }
+                    dst += pixelSize;
+                }
+            }
+
+            auto& block = blocks[i];
+            block.clear();
+            Write<int32_t>(block, int32_t(y));
+
+            std::vector<uint8_t> compressed;
+            bool isCompressed = compression == EXRCompression::RLE && CompressRLE(line, compressed);
+            const auto& payload = isCompressed ? compressed : line;
+
+            Write<int32_t>(block, int32_t(payload.size()));
+            block.insert(block.end(), payload.begin(), payload.end());
+        });
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            offsets[bandStart + i] = offset;
+            offset += blocks[i].size();
+            file.write(reinterpret_cast<const char*>(blocks[i].data()), blocks[i].size());
+        }
+    }
+
+    file.seekp(header.size());
+    file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+    return file.good();
+}
@@ -220,6 +220,143 @@ static void InitEntityFactory()
     };
 }
 
+static constexpr float c_SceneLoadTimeout = 300.0f; // seconds
+
+// true once every asset the renderer reads is resident, GetAsset() starts loading the ones that are not
+bool Editor::IsSceneLoaded(Assets::Scene* scene)
+{
+    auto& am = Editor::GetAssetManager();
+
+    auto isLoaded = [&](Assets::AssetHandle handle) {
+        auto asset = am.GetAsset(handle);
+        return !asset || asset.GetState() == Assets::AssetState::Loaded;
+    };
+
+    bool loaded = true;
+
+    for (auto e : scene->registry.view<Assets::MeshComponent>())
+    {
+        Assets::Entity entity = { e, scene };
+        loaded &= isLoaded(entity.GetComponent<Assets::MeshComponent>().meshSourceHandle);
+    }
+
+    for (auto e : scene->registry.view<Assets::SkyLightComponent>())
+    {
+        Assets::Entity entity = { e, scene };
+        loaded &= isLoaded(entity.GetComponent<Assets::SkyLightComponent>().textureHandle);
+    }
+
+    for (auto e : am.registry.view<Assets::Material>())
+    {
+        Assets::Asset materialAsset = { e, &am };
+        auto& material = materialAsset.Get<Assets::Material>();
+        loaded &= isLoaded(material.baseTextureHandle);
+        loaded &= isLoaded(material.emissiveTextureHandle);
+        loaded &= isLoaded(material.metallicRoughnessTextureHandle);
+        loaded &= isLoaded(material.normalTextureHandle);
+    }
+
+    return loaded;
+}
+
+static bool HasCommandLineFlag(const ApplicationCommandLineArgs& args, std::string_view flag)
+{
+    for (int i = 2; i < args.count; i++)
+        if (flag == args[i])
+            return true;
+
+    return false;
+}
+
+// HRay <project.hray> [--batch] [--serve] [--jobs dir] [--render] [--frames start end step] [--spp n] [--size width height] [--output dir] [--first-sample n] [--partial file] [--worker dir] [--stats file]
+// false on a missing or malformed value
+static bool ParseCommandLine(Editor::Context& ctx, const ApplicationCommandLineArgs& args)
+{
+    bool valid = true;
+
+    auto hasValues = [&](int i, int count) {
+        if (i + count < args.count)
+            return true;
+
+        HE_ERROR("Missing value for command line argument {}", args[i]);
+        valid = false;
+        return false;
+    };
+
+    auto parseNumber = [&](std::string_view arg, std::string_view str, auto& value) {
+        auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+        if (ec == std::errc() && end == str.data() + str.size())
+            return;
+
+        HE_ERROR("Invalid value {} for command line argument {}", str, arg);
+        valid = false;
+    };
+
+    for (int i = 2; i < args.count; i++)
+    {
+        std::string_view arg = args[i];
+
+        if (arg == "--render")
+        {
+            ctx.commandLineRender = true;
+        }
+        else if (arg == "--batch" || arg == "--serve")
+        {
+            // handled before the plugins are loaded
+        }
+        else if (arg == "--jobs" && hasValues(i, 1))
+        {
+            ctx.renderServer.jobsDir = args[++i];
+        }
+        else if (arg == "--frames" && hasValues(i, 3))
+        {
+            parseNumber(arg, args[++i], ctx.frameStart);
+            parseNumber(arg, args[++i], ctx.frameEnd);
+            parseNumber(arg, args[++i], ctx.frameStep);
+        }
+        else if (arg == "--spp" && hasValues(i, 1))
+        {
+            parseNumber(arg, args[++i], ctx.maxSamples);
+        }
+        else if (arg == "--size" && hasValues(i, 2))
+        {
+            parseNumber(arg, args[++i], ctx.width);
+            parseNumber(arg, args[++i], ctx.height);
+        }
+        else if (arg == "--output" && hasValues(i, 1))
+        {
+            ctx.outputPath = args[++i];
+        }
+        else if (arg == "--first-sample" && hasValues(i, 1))
+        {
+            // index of the first sample, workers rendering the same frame use disjoint ranges
+            parseNumber(arg, args[++i], ctx.fd.sampleOffset);
+        }
+        else if (arg == "--partial" && hasValues(i, 1))
+        {
+            ctx.partialOutputPath = args[++i];
+            ctx.enableCheckpoints = false;
+        }
+        else if (arg == "--worker" && hasValues(i, 1))
+        {
+            // distributed worker, the project is shared read-only : checkpoints and tiles go to the scratch directory
+            // of the worker and the cooked textures are read from the project cache but never written back
+            ctx.project.cacheDir = args[++i];
+            ctx.rd.textureCacheReadOnly = true;
+        }
+        else if (arg == "--stats" && hasValues(i, 1))
+        {
+            ctx.statsOutputPath = args[++i];
+        }
+        else
+        {
+            HE_ERROR("Unknown command line argument {}", arg);
+        }
+    }
+
+    return valid;
+}
+
 void Editor::App::OnAttach()
 {
     HE_PROFILE_FUNCTION();
@@ -237,14 +374,21 @@ void Editor::App::OnAttach()
     // Paths
     {
         auto args = Application::GetApplicationDesc().commandLineArgs;
-        projecFilePath = args.count == 2 ? args[1] : "";
+        projecFilePath = args.count >= 2 ? args[1] : "";
 
         ctx.appData = FileSystem::GetAppDataPath(Application::GetApplicationDesc().windowDesc.title);
         ctx.keyBindingsFilePath = std::filesystem::current_path() / "Resources" / "keyBindings.json";
     }
 
-    Plugins::LoadPluginsInDirectory("Plugins");
-    Input::DeserializeKeyBindings(ctx.keyBindingsFilePath);
+    ctx.batchMode = HasCommandLineFlag(Application::GetApplicationDesc().commandLineArgs, "--batch");
+    ctx.renderServer.enabled = HasCommandLineFlag(Application::GetApplicationDesc().commandLineArgs, "--serve");
+    ctx.commandLineRender = ctx.batchMode && !ctx.renderServer.enabled;
+
+    if (!ctx.batchMode)
+    {
+        Plugins::LoadPluginsInDirectory("Plugins");
+        Input::DeserializeKeyBindings(ctx.keyBindingsFilePath);
+    }
 
     {
         Assets::AssetManagerDesc desc;
@@ -253,11 +397,13 @@ void Editor::App::OnAttach()
     }
 
     // Tiny2D
+    if (!ctx.batchMode)
     {
         Tiny2D::Init(ctx.device);
     }
 
     // icons
+    if (!ctx.batchMode)
     {
         HE_PROFILE_SCOPE("Load Icons");
 
@@ -284,6 +430,7 @@ void Editor::App::OnAttach()
     {
         ctx.rd.am = &Editor::GetAssetManager();
         HRay::Init(ctx.rd, ctx.device, ctx.commandList);
+        ctx.readbackQueue.Init(ctx.device);
     }
 
     {
@@ -310,6 +457,7 @@ void Editor::App::OnAttach()
     }
 
     // Windows
+    if (!ctx.batchMode)
     {
         Editor::BindWindow<ViewPortWindow>({
             .title = "View Port",
@@ -350,6 +498,19 @@ void Editor::App::OnAttach()
     }
 
     OpenProject(projecFilePath);
+
+    // command line overrides are applied after the project settings are loaded
+    if (!ParseCommandLine(ctx, Application::GetApplicationDesc().commandLineArgs))
+    {
+        ctx.exitCode = 1;
+        Application::Shutdown();
+    }
+    else if (ctx.batchMode && !std::filesystem::exists(ctx.project.projectFilePath))
+    {
+        HE_ERROR("Batch render : invalid project file {}", projecFilePath.string());
+        ctx.exitCode = 1;
+        Application::Shutdown();
+    }
 }
 
 void Editor::App::OnDetach()
@@ -358,15 +519,30 @@ void Editor::App::OnDetach()
 
     auto& ctx = GetContext();
 
+    Editor::ShutdownRenderServer();
+
     if (ctx.sceneMode == Editor::SceneMode::Runtime)
         Stop();
 
-    Editor::Serialize();
+    ctx.readbackQueue.Flush();
+
+    // a malformed command line may have applied part of its overrides, they are not written to the project
+    if (!ctx.commandLineRender && !ctx.batchMode && ctx.exitCode == 0)
+        Editor::Serialize();
+
     Editor::GetAssetManager().UnSubscribe(ctx.assetEventCallbackHandle);
 
-    Tiny2D::Shutdown();
+    if (!ctx.batchMode)
+        Tiny2D::Shutdown();
+
+    bool commandLineRender = ctx.batchMode || ctx.commandLineRender;
+    int exitCode = commandLineRender && ctx.readbackQueue.failedWrites > 0 ? 1 : ctx.exitCode;
 
     delete App::s_Context;
+
+    // the engine's main loop has no exit code, report failures to the calling process here
+    if (exitCode != 0)
+        std::exit(exitCode);
 }
 
 void Editor::App::OnEvent(Event& e)
@@ -404,6 +580,7 @@ void Editor::App::OnAssetLoaded(Assets::Asset asset)
     case Assets::AssetType::MeshSource:
     {
         auto& meshSource = asset.Get<Assets::MeshSource>();
+        Editor::InvalidateMeshDebugLines(asset);
 
         if (ctx.importing)
         {
@@ -445,6 +622,96 @@ void Editor::App::OnUpdate(const FrameInfo& info)
 
     auto& ctx = GetContext();
 
+    ctx.readbackQueue.Update();
+    Editor::UpdateRenderServer();
+
+    if (ctx.commandLineRender && ctx.sceneMode == Editor::SceneMode::Editor && !ctx.renderStarted)
+    {
+        Assets::Scene* scene = Editor::GetScene();
+
+        // wait for the assets so that the first frames are not rendered without them
+        if (scene && Editor::IsSceneLoaded(scene))
+        {
+            ctx.renderStarted = true;
+
+            if (!std::filesystem::exists(ctx.outputPath))
+                std::filesystem::create_directories(ctx.outputPath);
+
+            Editor::Animate();
+
+            if (ctx.sceneMode != Editor::SceneMode::Runtime)
+            {
+                HE_ERROR("Failed to start rendering, the scene has no camera");
+                ctx.exitCode = 1;
+                Application::Shutdown();
+            }
+        }
+        else if (HE::Application::GetTime() > c_SceneLoadTimeout)
+        {
+            HE_ERROR("Failed to start rendering, the scene did not load within {} s", c_SceneLoadTimeout);
+            ctx.renderStarted = true;
+            ctx.exitCode = 1;
+            Application::Shutdown();
+        }
+    }
+
+    // Distributed render
+    {
+        auto& dr = ctx.distributed;
+        if (dr.active && dr.workers->running == 0)
+        {
+            dr.active = false;
+
+            if (dr.workers->failed > 0)
+            {
+                HE_ERROR("Distributed render failed, {} worker(s) did not finish", dr.workers->failed.load());
+
+                std::error_code ec;
+                std::filesystem::remove_all(dr.scratchDir, ec);
+            }
+            else if (dr.mode == DistributedMode::Samples)
+            {
+                auto partials = dr.partials;
+                auto scratchDir = dr.scratchDir;
+                auto filePath = std::format("{}/{}.exr", ctx.outputPath, dr.frameIndex);
+                auto pixelType = ctx.exrPixelType;
+                auto compression = ctx.exrCompression;
+
+                HE::Jops::SubmitTask([partials, scratchDir, filePath, pixelType, compression]() {
+                    if (Editor::MergePartialRenders(partials, filePath, pixelType, compression))
+                        HE_INFO("Successfully merged {} partial renders into {}", partials.size(), filePath);
+                    else
+                        HE_ERROR("Failed to merge partial renders into {}", filePath);
+
+                    std::error_code ec;
+                    std::filesystem::remove_all(scratchDir, ec);
+                });
+            }
+            else
+            {
+                HE_INFO("Distributed render finished");
+
+                std::error_code ec;
+                std::filesystem::remove_all(dr.scratchDir, ec);
+            }
+        }
+    }
+
+    // Texture streaming
+    {
+        // an offline frame renders with every texture level from its first sample, all its tiles and samples see
+        // the same levels. The interactive views discard the samples taken with the coarser levels
+        if (ctx.sceneMode == Editor::SceneMode::Runtime)
+        {
+            if (ctx.sampleCount == 0 && ctx.tileIndex == 0 && HRay::MakeTexturesResident(ctx.rd))
+                Editor::ClearViewPorts();
+        }
+        else if (HRay::UpdateTextureStreaming(ctx.rd))
+        {
+            Editor::ClearViewPorts();
+        }
+    }
+
     Assets::Scene* scene = Editor::GetAssetManager().GetAsset<Assets::Scene>(ctx.sceneHandle);
 
     if (scene && ctx.sceneMode == Editor::SceneMode::Runtime && (int)ctx.frameIndex < ctx.frameEnd)
@@ -508,7 +775,7 @@ void Editor::App::OnUpdate(const FrameInfo& info)
                     {
                         auto& meshSource = asset.Get<Assets::MeshSource>();
                         auto& mesh = meshSource.meshes[dm.meshIndex];
-                        HRay::SubmitMesh(ctx.rd, ctx.fd, asset, mesh, wt, (uint32_t)e, ctx.commandList);
+                        HRay::SubmitMesh(ctx.rd, ctx.fd, asset, mesh, wt, (uint32_t)e, ctx.commandList, Editor::GetInstanceMask(entity));
                     }
                 }
             }
@@ -546,19 +813,93 @@ void Editor::App::OnUpdate(const FrameInfo& info)
                 ctx.fd.sceneInfo.light.enableEnvironmentLight = view.size();
             }
 
-            HRay::EndScene(ctx.rd, ctx.fd, ctx.commandList, { viewMatrix, projection, camPos, c.perspectiveFieldOfView, (uint32_t)ctx.width, (uint32_t)ctx.height });
+            HRay::ViewDesc viewDesc = { viewMatrix, projection, camPos, c.perspectiveFieldOfView, (uint32_t)ctx.width, (uint32_t)ctx.height };
+
+            // partial renders are merged as whole frames and checkpoints store whole frames, neither is tiled
+            bool tiled = ctx.tileSize > 0 && ctx.partialOutputPath.empty();
+            uint32_t tilesX = 1;
+            uint32_t tileCount = 1;
+            if (tiled)
+            {
+                uint32_t tileSize = (uint32_t)ctx.tileSize;
+                tilesX = (ctx.width + tileSize - 1) / tileSize;
+                tileCount = tilesX * ((ctx.height + tileSize - 1) / tileSize);
+
+                uint32_t x = (ctx.tileIndex % tilesX) * tileSize;
+                uint32_t y = (ctx.tileIndex / tilesX) * tileSize;
+                viewDesc.tileOffset = { x, y };
+                viewDesc.tileSize = { Math::min(tileSize, (uint32_t)ctx.width - x), Math::min(tileSize, (uint32_t)ctx.height - y) };
+            }
+
+            bool enableCheckpoints = ctx.enableCheckpoints && !tiled;
+            bool needsSceneHash = enableCheckpoints || !ctx.partialOutputPath.empty();
+            uint64_t sceneHash = needsSceneHash ? HRay::ComputeSceneHash(ctx.rd, ctx.fd, viewDesc) : 0;
+
+            if (enableCheckpoints && ctx.sampleCount == 0)
+                Editor::ResumeFromCheckpoint(sceneHash);
+
+            HRay::EndScene(ctx.rd, ctx.fd, ctx.commandList, viewDesc);
 
             {
                 ctx.sampleCount++;
                 ctx.sampleCount = Math::min(ctx.sampleCount, ctx.maxSamples);
 
-                if (ctx.sampleCount == ctx.maxSamples)
+                bool frameCompleted = ctx.sampleCount == ctx.maxSamples;
+
+                if (frameCompleted && tiled)
+                {
+                    auto rt = ctx.outputFormat == OutputFormat::EXR ? HRay::GetHDRTarget(ctx.fd) : HRay::GetColorTarget(ctx.fd);
+
+                    if (ctx.tileIndex == 0)
+                    {
+                        auto image = HE::CreateRef<TiledImage>();
+                        auto storagePath = ctx.project.cacheDir / "Tiles" / std::format("{}.raw", ctx.frameIndex);
+                        image->Create(storagePath, ctx.width, ctx.height, ctx.tileSize, rt->getDesc().format);
+                        image->remainingTiles = tileCount;
+                        image->filePath = std::format("{}/{}.{}", ctx.outputPath, ctx.frameIndex, ctx.outputFormat == OutputFormat::EXR ? "exr" : "png");
+                        image->outputFormat = ctx.outputFormat;
+                        image->pixelType = ctx.exrPixelType;
+                        image->compression = ctx.exrCompression;
+                        ctx.tiledImage = image;
+                    }
+
+                    ctx.readbackQueue.Enqueue(ctx.commandList, rt, ctx.tiledImage, viewDesc.tileOffset.x, viewDesc.tileOffset.y);
+
+                    // each tile accumulates from scratch
+                    ctx.tileIndex++;
+                    frameCompleted = ctx.tileIndex == tileCount;
+                    if (!frameCompleted)
+                    {
+                        ctx.sampleCount = 0;
+                        Editor::Clear();
+                    }
+                    else
+                    {
+                        ctx.tileIndex = 0;
+                        ctx.tiledImage.reset();
+                    }
+                }
+
+                if (frameCompleted)
                 {
                     for (int i = 0; i <= ctx.frameStep; i++)
                         OnUpdateFrame();
 
-                    auto rt = HRay::GetColorTarget(ctx.fd);
-                    Editor::Save(ctx.device, rt, ctx.outputPath, ctx.frameIndex);
+                    if (!ctx.partialOutputPath.empty())
+                    {
+                        Editor::WriteAccumulation(ctx.partialOutputPath, sceneHash);
+                    }
+                    else if (!tiled)
+                    {
+                        auto rt = ctx.outputFormat == OutputFormat::EXR ? HRay::GetHDRTarget(ctx.fd) : HRay::GetColorTarget(ctx.fd);
+                        ctx.readbackQueue.Enqueue(ctx.commandList, rt, ctx.outputPath, ctx.frameIndex, ctx.outputFormat, ctx.exrPixelType, ctx.exrCompression);
+                    }
+
+                    if (enableCheckpoints)
+                        Editor::RemoveCheckpoint(ctx.frameIndex);
+
+                    if (!ctx.statsOutputPath.empty())
+                        Editor::WriteRendererStats(ctx.statsOutputPath);
 
                     ctx.sampleCount = 0;
                     ctx.frameIndex += ctx.frameStep;
@@ -566,12 +907,25 @@ void Editor::App::OnUpdate(const FrameInfo& info)
 
                     Editor::Clear();
                     if (ctx.frameIndex >= ctx.frameEnd)
+                    {
                         Stop();
+
+                        if (ctx.commandLineRender)
+                            Application::Shutdown();
+                    }
+                }
+                else if (enableCheckpoints && HE::Application::GetTime() - ctx.lastCheckpointTime >= ctx.checkpointInterval)
+                {
+                    Editor::SaveCheckpoint(sceneHash);
+                    ctx.lastCheckpointTime = HE::Application::GetTime();
                 }
             }
         }
     }
 
+    if (ctx.batchMode)
+        return;
+
     bool validProject = std::filesystem::exists(ctx.project.projectFilePath);
 
     // Shortcuts
@@ -925,7 +1279,9 @@ void Editor::App::OnBegin(const FrameInfo& info)
     auto& ctx = GetContext();
 
     ctx.commandList->open();
-    nvrhi::utils::ClearColorAttachment(ctx.commandList, info.fb, 0, nvrhi::Color(0.1f));
+
+    if (!ctx.batchMode)
+        nvrhi::utils::ClearColorAttachment(ctx.commandList, info.fb, 0, nvrhi::Color(0.1f));
 
     for (auto& w : ctx.windowManager.scripts)
         if (w.instance)
@@ -940,6 +1296,7 @@ void Editor::App::OnEnd(const FrameInfo& info)
 
     ctx.commandList->close();
     ctx.device->executeCommandList(ctx.commandList);
+    ctx.readbackQueue.Submit();
 
     for (auto& w : ctx.windowManager.scripts)
         if (w.instance)
@@ -982,6 +1339,39 @@ Assets::Entity Editor::GetSceneCamera(Assets::Scene* scene)
     return {};
 }
 
+bool Editor::WriteRendererStats(const std::filesystem::path& file)
+{
+    auto& ctx = Editor::GetContext();
+
+    std::ofstream out(file);
+    if (!out)
+    {
+        HE_ERROR("Editor::WriteRendererStats : Unable to open file for writing, {}", file.string());
+        return false;
+    }
+
+    HRay::WriteRendererStats(ctx.fd.stats, out);
+    return true;
+}
+
+uint32_t Editor::GetInstanceMask(Assets::Entity entity)
+{
+    auto& ctx = Editor::GetContext();
+
+    auto it = ctx.instanceMasks.find((uint64_t)entity.GetUUID());
+    return it != ctx.instanceMasks.end() ? it->second : HRay::c_instanceMaskAll;
+}
+
+void Editor::SetInstanceMask(Assets::Entity entity, uint32_t mask)
+{
+    auto& ctx = Editor::GetContext();
+
+    if (mask == HRay::c_instanceMaskAll)
+        ctx.instanceMasks.erase((uint64_t)entity.GetUUID());
+    else
+        ctx.instanceMasks[(uint64_t)entity.GetUUID()] = mask;
+}
+
 void Editor::SetRendererToSceneCameraProp(HRay::FrameData& frameData, const Assets::CameraComponent& c)
 {
     frameData.sceneInfo.view.minDistance = c.perspectiveNear;
@@ -1017,6 +1407,7 @@ void Editor::Animate()
     ctx.sceneHandle = handle;
     ctx.sampleCount = 0;
     ctx.frameIndex = 0;
+    ctx.lastCheckpointTime = HE::Application::GetTime();
     Editor::SelectEntity({});
 
     Editor::Clear();
@@ -1066,6 +1457,8 @@ void Editor::Stop()
     ctx.sceneHandle = ctx.tempSceneHandle;
     ctx.sampleCount = 0;
     ctx.frameIndex = 0;
+    ctx.tileIndex = 0;
+    ctx.tiledImage.reset();
     Editor::SelectEntity({});
     Editor::Clear();
 
@@ -1124,6 +1517,8 @@ void Editor::OpenProject(const std::filesystem::path& file)
     ctx.project.projectFilePath = file;
     ctx.project.assetsDir = file.parent_path() / "Assets";
     ctx.project.cacheDir = cacheDir;
+    ctx.rd.textureCacheDir = cacheDir / "Textures";
+    ctx.instanceMasks.clear();
     ctx.project.assetsMetaDataFilePath = cacheDir / "assetsMetaData.json";
     
     ctx.project.layoutFilePath = (cacheDir / "layout.ini").lexically_normal().string();
@@ -1184,6 +1579,8 @@ void Editor::CreateNewProject(const std::filesystem::path& path, std::string pro
     auto newProjectDir = path / projectName;
     auto cacheDir = newProjectDir / "Cache";
     ctx.project.cacheDir = cacheDir;
+    ctx.rd.textureCacheDir = cacheDir / "Textures";
+    ctx.instanceMasks.clear();
     ctx.project.projectFilePath = newProjectDir / std::format("{}.hray", projectName);
     ctx.project.assetsDir = newProjectDir / "Assets";
     ctx.project.assetsMetaDataFilePath = cacheDir / "assetsMetaData.json";
@@ -1260,9 +1657,14 @@ void Editor::NewScene()
 void Editor::Clear()
 {
     auto& ctx = Editor::GetContext();
-    auto& windowManager = ctx.windowManager;
 
     HRay::Clear(ctx.fd);
+    Editor::ClearViewPorts();
+}
+
+void Editor::ClearViewPorts()
+{
+    auto& windowManager = Editor::GetContext().windowManager;
 
     for (auto s : windowManager.scripts)
     {
@@ -1287,16 +1689,33 @@ Assets::Scene* Editor::GetScene()
     return ctx.assetManager.GetAsset<Assets::Scene>(ctx.sceneHandle);
 }
 
-void Editor::Save(nvrhi::IDevice* device, nvrhi::ITexture* texture, const std::string& directory, uint32_t frameIndex)
+// Gamma encode lookup tables, UNORM value -> pow(value, 1 / 2.2) in 8 bit
+static const std::array<uint8_t, 256>& GetGammaLUT8()
 {
-    if (!std::filesystem::exists(directory))
-    {
-        HE_ERROR("Invalid path: {}", directory);
-        return;
-    }
+    static const std::array<uint8_t, 256> lut = [] {
+        std::array<uint8_t, 256> table;
+        for (uint32_t i = 0; i < table.size(); i++)
+            table[i] = static_cast<uint8_t>(std::clamp(std::pow(i / 255.0f, 1.0f / 2.2f) * 255.0f, 0.0f, 255.0f));
+        return table;
+    }();
+
+    return lut;
+}
 
-    std::string filePath = std::format("{}/{}.png", directory, frameIndex);
+static const std::vector<uint8_t>& GetGammaLUT16()
+{
+    static const std::vector<uint8_t> lut = [] {
+        std::vector<uint8_t> table(65536);
+        for (uint32_t i = 0; i < table.size(); i++)
+            table[i] = static_cast<uint8_t>(std::clamp(std::pow(i / 65535.0f, 1.0f / 2.2f) * 255.0f, 0.0f, 255.0f));
+        return table;
+    }();
+
+    return lut;
+}
 
+static nvrhi::StagingTextureHandle CopyToStagingTexture(nvrhi::IDevice* device, nvrhi::ITexture* texture)
+{
     const auto& desc = texture->getDesc();
     auto textureState = nvrhi::ResourceStates::UnorderedAccess;
 
@@ -1322,108 +1741,794 @@ void Editor::Save(nvrhi::IDevice* device, nvrhi::ITexture* texture, const std::s
     commandList->close();
     device->executeCommandList(commandList);
 
-    HE::Jops::SubmitTask([device, filePath, stagingTexture]() {
-
-        size_t rowPitch = 0;
-        void* pData = device->mapStagingTexture(stagingTexture, nvrhi::TextureSlice(), nvrhi::CpuAccessMode::Read, &rowPitch);
-        HE_VERIFY(pData);
-
-        const auto& texDesc = stagingTexture->getDesc();
-        uint32_t width = texDesc.width;
-        uint32_t height = texDesc.height;
+    return stagingTexture;
+}
 
-        if (texDesc.format != nvrhi::Format::RGBA8_UNORM && texDesc.format != nvrhi::Format::RGBA16_UNORM)
-        {
-            HE_ERROR("Unsupported texture format: {}. Expected RGBA8 or RGBA16.", static_cast<int>(texDesc.format));
-            device->unmapStagingTexture(stagingTexture);
-            return;
-        }
+// Gamma encodes rows of an RGBA8 / RGBA16 UNORM image into tightly packed RGBA8 rows
+static void ConvertToRGBA8(const uint8_t* pixels, size_t rowPitch, uint32_t width, uint32_t rows, nvrhi::Format textureFormat, uint8_t* rgba8Data)
+{
+    HE_PROFILE_FUNCTION();
 
-        std::vector<uint8_t> rgba8Data(width * height * 4);
-        float invGamma = 1.0f / 2.2f;
+    if (textureFormat == nvrhi::Format::RGBA16_UNORM)
+    {
+        const auto& lut = GetGammaLUT16();
 
-        for (uint32_t y = 0; y < height; ++y)
-        {
-            if (texDesc.format == nvrhi::Format::RGBA16_UNORM)
-            {
-                const uint16_t* row = reinterpret_cast<const uint16_t*>(pData) + (y * rowPitch / sizeof(uint16_t));
-                for (uint32_t x = 0; x < width; ++x)
-                {
-                    uint32_t idx = (y * width + x) * 4;
+        HRay::ParallelFor(rows, 16, [&](uint32_t y) {
 
-                    // RGB
-                    for (int c = 0; c < 3; ++c)
-                    {
-                        float value = row[x * 4 + c] / 65535.0f;
-                        rgba8Data[idx + c] = static_cast<uint8_t>(std::clamp(std::pow(value, invGamma) * 255.0f, 0.0f, 255.0f));
-                    }
+            const uint16_t* row = reinterpret_cast<const uint16_t*>(pixels + y * rowPitch);
+            uint8_t* dst = rgba8Data + size_t(y) * width * 4;
 
-                    // Alpha
-                    rgba8Data[idx + 3] = static_cast<uint8_t>(row[x * 4 + 3] >> 8);
-                }
-            }
-            else if (texDesc.format == nvrhi::Format::RGBA8_UNORM)
+            for (uint32_t x = 0; x < width; ++x)
             {
-                const uint8_t* row = reinterpret_cast<const uint8_t*>(pData) + y * rowPitch;
-                for (uint32_t x = 0; x < width; ++x)
-                {
-                    uint32_t idx = (y * width + x) * 4;
-
-                    // RGB
-                    for (int c = 0; c < 3; ++c)
-                    {
-                        float value = row[x * 4 + c] / 255.0f;
-                        rgba8Data[idx + c] = static_cast<uint8_t>(std::clamp(std::pow(value, invGamma) * 255.0f, 0.0f, 255.0f));
-                    }
-
-                    // Alpha
-                    rgba8Data[idx + 3] = row[x * 4 + 3];
-                }
+                dst[x * 4 + 0] = lut[row[x * 4 + 0]];
+                dst[x * 4 + 1] = lut[row[x * 4 + 1]];
+                dst[x * 4 + 2] = lut[row[x * 4 + 2]];
+                dst[x * 4 + 3] = uint8_t(row[x * 4 + 3] >> 8);
             }
-        }
+        });
+    }
+    else if (textureFormat == nvrhi::Format::RGBA8_UNORM)
+    {
+        const auto& lut = GetGammaLUT8();
 
-        int result = HE::Image::SaveAsPNG(filePath.c_str(), width, height, 4, rgba8Data.data(), width * 4);
+        HRay::ParallelFor(rows, 16, [&](uint32_t y) {
 
-        if (result)
-        {
-            HE_INFO("Successfully wrote PNG file: {}", filePath);
-        }
-        else
-        {
-            HE_ERROR("Failed to write PNG file: {}", filePath);
-        }
+            const uint8_t* row = pixels + y * rowPitch;
+            uint8_t* dst = rgba8Data + size_t(y) * width * 4;
 
-        device->unmapStagingTexture(stagingTexture);
-    });
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                dst[x * 4 + 0] = lut[row[x * 4 + 0]];
+                dst[x * 4 + 1] = lut[row[x * 4 + 1]];
+                dst[x * 4 + 2] = lut[row[x * 4 + 2]];
+                dst[x * 4 + 3] = row[x * 4 + 3];
+            }
+        });
+    }
 }
 
-bool Editor::IsEntityNameExistInChildren(Assets::Scene* scene, const std::string& name, Assets::Entity entity)
+static bool CheckOutputFormat(nvrhi::Format textureFormat, Editor::OutputFormat format)
 {
-    for (auto id : entity.GetChildren())
+    if (format == Editor::OutputFormat::EXR && textureFormat != nvrhi::Format::RGBA32_FLOAT)
     {
-        Assets::Entity entity = scene->FindEntity(id);
-        if (entity.GetName() == name)
-            return true;
+        HE_ERROR("Unsupported texture format: {}. Expected RGBA32_FLOAT.", static_cast<int>(textureFormat));
+        return false;
     }
 
-    return false;
+    if (format == Editor::OutputFormat::PNG && textureFormat != nvrhi::Format::RGBA8_UNORM && textureFormat != nvrhi::Format::RGBA16_UNORM)
+    {
+        HE_ERROR("Unsupported texture format: {}. Expected RGBA8 or RGBA16.", static_cast<int>(textureFormat));
+        return false;
+    }
+
+    return true;
 }
 
-std::string Editor::GetIncrementedReletiveEntityName(Assets::Scene* scene, const std::string& name, Assets::Entity parent)
+static void LogWriteResult(bool result, const std::string& filePath, Editor::OutputFormat format)
 {
-    if (!IsEntityNameExistInChildren(scene, name, parent))
-        return  name;
-
-    std::string result = IncrementString(name);
-    return GetIncrementedReletiveEntityName(scene, result, parent); // keep Incrementing the number
+    if (result)
+    {
+        HE_INFO("Successfully wrote {} file: {}", magic_enum::enum_name(format), filePath);
+    }
+    else
+    {
+        HE_ERROR("Failed to write {} file: {}", magic_enum::enum_name(format), filePath);
+    }
 }
 
-Assets::Entity Editor::CreateEntity(Assets::Scene* scene, const std::string& key, Assets::UUID parent)
+// above this size PNG files are streamed in scanline bands instead of being compressed in memory
+static constexpr uint64_t c_MaxInMemoryPNGPixels = 64ull * 1024 * 1024;
+static constexpr uint32_t c_StreamingBandHeight = 64;
+
+// Encodes an image held in memory to filePath, runs on a worker thread.
+// EXR files are written from the HDR accumulation target, the sums are divided by the sample counts on the way
+static bool EncodeImage(
+    const uint8_t* pixels,
+    size_t rowPitch,
+    uint32_t width,
+    uint32_t height,
+    nvrhi::Format textureFormat,
+    const std::string& filePath,
+    Editor::OutputFormat format,
+    Editor::EXRPixelType pixelType,
+    Editor::EXRCompression compression
+)
 {
-    auto& ctx = Editor::GetContext();
+    HE_PROFILE_FUNCTION();
 
-    if (ctx.createEnityFucntions.contains(key))
-        return ctx.createEnityFucntions.at(key)(scene, parent);
+    if (!CheckOutputFormat(textureFormat, format))
+        return false;
+
+    bool result = false;
+
+    if (format == Editor::OutputFormat::EXR)
+    {
+        const size_t rowSize = size_t(width) * sizeof(Math::float4);
+
+        result = Editor::WriteEXR(filePath, width, height, c_StreamingBandHeight, [&](uint32_t y, uint32_t count, uint8_t* dst) {
+
+            for (uint32_t i = 0; i < count; i++)
+                std::memcpy(dst + i * rowSize, pixels + (y + i) * rowPitch, rowSize);
+
+            HRay::ResolveAccumulation(reinterpret_cast<Math::float4*>(dst), size_t(width) * count);
+
+        }, pixelType, compression);
+    }
+    else if (uint64_t(width) * height > c_MaxInMemoryPNGPixels)
+    {
+        result = Editor::WritePNG(filePath, width, height, c_StreamingBandHeight, [&](uint32_t y, uint32_t count, uint8_t* dst) {
+            ConvertToRGBA8(pixels + y * rowPitch, rowPitch, width, count, textureFormat, dst);
+        });
+    }
+    else
+    {
+        std::vector<uint8_t> rgba8Data(size_t(width) * height * 4);
+        ConvertToRGBA8(pixels, rowPitch, width, height, textureFormat, rgba8Data.data());
+
+        result = HE::Image::SaveAsPNG(filePath.c_str(), width, height, 4, rgba8Data.data(), width * 4);
+    }
+
+    LogWriteResult(result, filePath, format);
+
+    return result;
+}
+
+// Streams a disk backed tiled image to its output file one band of tiles at a time, runs on a worker thread
+static bool EncodeTiledImage(Editor::TiledImage& image)
+{
+    HE_PROFILE_FUNCTION();
+
+    if (!CheckOutputFormat(image.format, image.outputFormat))
+        return false;
+
+    bool result = false;
+
+    if (image.outputFormat == Editor::OutputFormat::EXR)
+    {
+        result = Editor::WriteEXR(image.filePath, image.width, image.height, image.tileSize, [&](uint32_t y, uint32_t count, uint8_t* dst) {
+            image.ReadRows(y, count, dst);
+            HRay::ResolveAccumulation(reinterpret_cast<Math::float4*>(dst), size_t(image.width) * count);
+        }, image.pixelType, image.compression);
+    }
+    else
+    {
+        const size_t rowSize = size_t(image.width) * image.bytesPerPixel;
+        std::vector<uint8_t> band(rowSize * Math::min(image.tileSize, image.height));
+
+        result = Editor::WritePNG(image.filePath, image.width, image.height, image.tileSize, [&](uint32_t y, uint32_t count, uint8_t* dst) {
+            image.ReadRows(y, count, band.data());
+            ConvertToRGBA8(band.data(), rowSize, image.width, count, image.format, dst);
+        });
+    }
+
+    LogWriteResult(result, image.filePath, image.outputFormat);
+
+    return result;
+}
+
+static bool EncodeStagingTexture(
+    nvrhi::IDevice* device,
+    nvrhi::IStagingTexture* stagingTexture,
+    const std::string& filePath,
+    Editor::OutputFormat format,
+    Editor::EXRPixelType pixelType,
+    Editor::EXRCompression compression
+)
+{
+    HE_PROFILE_FUNCTION();
+
+    const auto& texDesc = stagingTexture->getDesc();
+
+    size_t rowPitch = 0;
+    void* pData = device->mapStagingTexture(stagingTexture, nvrhi::TextureSlice(), nvrhi::CpuAccessMode::Read, &rowPitch);
+    HE_VERIFY(pData);
+
+    bool result = EncodeImage(reinterpret_cast<const uint8_t*>(pData), rowPitch, texDesc.width, texDesc.height, texDesc.format, filePath, format, pixelType, compression);
+
+    device->unmapStagingTexture(stagingTexture);
+
+    return result;
+}
+
+void Editor::Save(nvrhi::IDevice* device, nvrhi::ITexture* texture, const std::string& directory, uint32_t frameIndex)
+{
+    if (!std::filesystem::exists(directory))
+    {
+        HE_ERROR("Invalid path: {}", directory);
+        return;
+    }
+
+    std::string filePath = std::format("{}/{}.png", directory, frameIndex);
+
+    nvrhi::StagingTextureHandle stagingTexture = CopyToStagingTexture(device, texture);
+
+    HE::Jops::SubmitTask([device, filePath, stagingTexture]() {
+        EncodeStagingTexture(device, stagingTexture, filePath, OutputFormat::PNG, {}, {});
+    });
+}
+
+void Editor::SaveEXR(nvrhi::IDevice* device, nvrhi::ITexture* texture, const std::string& directory, uint32_t frameIndex, EXRPixelType pixelType, EXRCompression compression)
+{
+    if (!std::filesystem::exists(directory))
+    {
+        HE_ERROR("Invalid path: {}", directory);
+        return;
+    }
+
+    std::string filePath = std::format("{}/{}.exr", directory, frameIndex);
+
+    nvrhi::StagingTextureHandle stagingTexture = CopyToStagingTexture(device, texture);
+
+    HE::Jops::SubmitTask([device, filePath, stagingTexture, pixelType, compression]() {
+        EncodeStagingTexture(device, stagingTexture, filePath, OutputFormat::EXR, pixelType, compression);
+    });
+}
+
+void Editor::ReadbackQueue::Init(nvrhi::IDevice* pDevice)
+{
+    device = pDevice;
+
+    for (auto& slot : slots)
+        slot.eventQuery = device->createEventQuery();
+}
+
+void Editor::ReadbackQueue::Enqueue(nvrhi::ICommandList* commandList, nvrhi::ITexture* texture, EncodeFn encode)
+{
+    HE_PROFILE_FUNCTION();
+
+    Slot& slot = slots[next];
+
+    // back-pressure : every slot is in flight, wait for the oldest one to be written to disk
+    if (slot.state != Slot::State::Free)
+    {
+        HE_PROFILE_SCOPE("ReadbackQueue::Wait");
+
+        // the ring wrapped within one command list, its copies have to reach the GPU before the slot can free up
+        if (slot.state == Slot::State::Recorded)
+            SubmitRecorded();
+
+        if (slot.state == Slot::State::Submitted)
+            device->waitEventQuery(slot.eventQuery);
+
+        while (slot.state != Slot::State::Free)
+        {
+            Update();
+            std::this_thread::yield();
+        }
+    }
+
+    const auto& desc = texture->getDesc();
+    if (!slot.stagingTexture ||
+        slot.stagingTexture->getDesc().width != desc.width ||
+        slot.stagingTexture->getDesc().height != desc.height ||
+        slot.stagingTexture->getDesc().format != desc.format)
+    {
+        slot.stagingTexture = device->createStagingTexture(desc, nvrhi::CpuAccessMode::Read);
+        HE_VERIFY(slot.stagingTexture);
+    }
+
+    commandList->copyTexture(slot.stagingTexture, nvrhi::TextureSlice(), texture, nvrhi::TextureSlice());
+
+    slot.encode = std::move(encode);
+    slot.state = Slot::State::Recorded;
+    recordingCommandList = commandList;
+
+    next = (next + 1) % c_MaxSlots;
+}
+
+void Editor::ReadbackQueue::Enqueue(
+    nvrhi::ICommandList* commandList,
+    nvrhi::ITexture* texture,
+    const std::string& directory,
+    uint32_t frameIndex,
+    OutputFormat format,
+    EXRPixelType pixelType,
+    EXRCompression compression
+)
+{
+    if (!std::filesystem::exists(directory))
+    {
+        HE_ERROR("Invalid path: {}", directory);
+        failedWrites++;
+        return;
+    }
+
+    std::string filePath = std::format("{}/{}.{}", directory, frameIndex, format == OutputFormat::EXR ? "exr" : "png");
+
+    Enqueue(commandList, texture, [this, filePath, format, pixelType, compression](nvrhi::IDevice* device, nvrhi::IStagingTexture* stagingTexture) {
+        if (!EncodeStagingTexture(device, stagingTexture, filePath, format, pixelType, compression))
+            failedWrites++;
+    });
+}
+
+Editor::TiledImage::~TiledImage()
+{
+    if (storage.is_open())
+        storage.close();
+
+    std::error_code ec;
+    if (!storagePath.empty())
+        std::filesystem::remove(storagePath, ec);
+}
+
+bool Editor::TiledImage::Create(const std::filesystem::path& path, uint32_t pWidth, uint32_t pHeight, uint32_t pTileSize, nvrhi::Format pFormat)
+{
+    HE_PROFILE_FUNCTION();
+
+    width = pWidth;
+    height = pHeight;
+    tileSize = pTileSize;
+    format = pFormat;
+    bytesPerPixel = nvrhi::getFormatInfo(format).bytesPerBlock;
+    storagePath = path;
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    }
+
+    // sparse on most file systems, pages are only allocated as the tiles land
+    std::filesystem::resize_file(path, uint64_t(width) * height * bytesPerPixel, ec);
+    if (ec)
+    {
+        HE_ERROR("Failed to create tile storage {}", path.string());
+        return false;
+    }
+
+    storage.open(path, std::ios::in | std::ios::out | std::ios::binary);
+
+    return storage.is_open();
+}
+
+void Editor::TiledImage::WriteTile(uint32_t x, uint32_t y, uint32_t tileWidth, uint32_t tileHeight, const uint8_t* data, size_t rowPitch)
+{
+    HE_PROFILE_FUNCTION();
+
+    const size_t rowSize = size_t(tileWidth) * bytesPerPixel;
+    const uint64_t imageRowSize = uint64_t(width) * bytesPerPixel;
+
+    std::scoped_lock lock(mutex);
+
+    for (uint32_t row = 0; row < tileHeight; row++)
+    {
+        storage.seekp((y + row) * imageRowSize + uint64_t(x) * bytesPerPixel);
+        storage.write(reinterpret_cast<const char*>(data + row * rowPitch), rowSize);
+    }
+}
+
+void Editor::TiledImage::ReadRows(uint32_t y, uint32_t count, uint8_t* dst)
+{
+    HE_PROFILE_FUNCTION();
+
+    const uint64_t imageRowSize = uint64_t(width) * bytesPerPixel;
+
+    std::scoped_lock lock(mutex);
+
+    storage.seekg(y * imageRowSize);
+    storage.read(reinterpret_cast<char*>(dst), count * imageRowSize);
+}
+
+void Editor::ReadbackQueue::Enqueue(nvrhi::ICommandList* commandList, nvrhi::ITexture* texture, HE::Ref<TiledImage> image, uint32_t x, uint32_t y)
+{
+    Enqueue(commandList, texture, [this, image, x, y](nvrhi::IDevice* device, nvrhi::IStagingTexture* stagingTexture) {
+
+        const auto& desc = stagingTexture->getDesc();
+
+        size_t rowPitch = 0;
+        void* pData = device->mapStagingTexture(stagingTexture, nvrhi::TextureSlice(), nvrhi::CpuAccessMode::Read, &rowPitch);
+        HE_VERIFY(pData);
+
+        image->WriteTile(x, y, desc.width, desc.height, reinterpret_cast<const uint8_t*>(pData), rowPitch);
+
+        device->unmapStagingTexture(stagingTexture);
+
+        if (--image->remainingTiles == 0)
+        {
+            if (!image->storage.is_open() || !image->storage.good() || !EncodeTiledImage(*image))
+                failedWrites++;
+        }
+    });
+}
+
+void Editor::ReadbackQueue::Submit()
+{
+    for (auto& slot : slots)
+    {
+        if (slot.state == Slot::State::Recorded)
+        {
+            device->resetEventQuery(slot.eventQuery);
+            device->setEventQuery(slot.eventQuery, nvrhi::CommandQueue::Graphics);
+            slot.state = Slot::State::Submitted;
+        }
+    }
+
+    recordingCommandList = nullptr;
+}
+
+// executes the open command list that holds the Recorded copies and reopens it, recording continues in the same list
+void Editor::ReadbackQueue::SubmitRecorded()
+{
+    HE_PROFILE_FUNCTION();
+
+    if (!recordingCommandList)
+        return;
+
+    nvrhi::CommandListHandle commandList = recordingCommandList;
+    commandList->close();
+    device->executeCommandList(commandList);
+    Submit();
+    commandList->open();
+}
+
+void Editor::ReadbackQueue::Update()
+{
+    for (auto& slot : slots)
+    {
+        if (slot.state == Slot::State::Submitted && device->pollEventQuery(slot.eventQuery))
+        {
+            slot.state = Slot::State::Encoding;
+
+            HE::Jops::SubmitTask([this, &slot]() {
+                slot.encode(device, slot.stagingTexture);
+                slot.encode = nullptr;
+                slot.state = Slot::State::Free;
+            });
+        }
+    }
+}
+
+void Editor::ReadbackQueue::Flush()
+{
+    HE_PROFILE_FUNCTION();
+
+    // a readback recorded last is still in the open command list
+    SubmitRecorded();
+
+    for (auto& slot : slots)
+    {
+        if (slot.state == Slot::State::Submitted)
+            device->waitEventQuery(slot.eventQuery);
+    }
+
+    Update();
+
+    for (auto& slot : slots)
+    {
+        while (slot.state == Slot::State::Encoding)
+            std::this_thread::yield();
+    }
+}
+
+struct CheckpointHeader
+{
+    static constexpr uint32_t c_Magic = 0x50435248; // "HRCP"
+    static constexpr uint32_t c_Version = 2; // 2 : radiance sums and sample counts instead of averages
+
+    uint32_t magic = c_Magic;
+    uint32_t version = c_Version;
+    uint64_t sceneHash = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t rendererFrameIndex = 0;
+    uint32_t sampleCount = 0;
+};
+
+static std::filesystem::path GetCheckpointPath(uint32_t frameIndex)
+{
+    auto& ctx = Editor::GetContext();
+
+    return ctx.project.cacheDir / "Checkpoints" / std::format("{}.hcp", frameIndex);
+}
+
+void Editor::WriteAccumulation(const std::filesystem::path& filePath, uint64_t sceneHash, HE::Ref<CheckpointState> checkpoint)
+{
+    HE_PROFILE_FUNCTION();
+
+    auto& ctx = Editor::GetContext();
+
+    std::filesystem::create_directories(filePath.parent_path());
+
+    auto texture = HRay::GetHDRTarget(ctx.fd);
+
+    CheckpointHeader header;
+    header.sceneHash = sceneHash;
+    header.width = texture->getDesc().width;
+    header.height = texture->getDesc().height;
+    header.rendererFrameIndex = ctx.fd.frameIndex;
+    header.sampleCount = ctx.sampleCount;
+
+    ctx.readbackQueue.Enqueue(ctx.commandList, texture, [filePath, header, checkpoint](nvrhi::IDevice* device, nvrhi::IStagingTexture* stagingTexture) {
+
+        HE_PROFILE_SCOPE("Write Accumulation");
+
+        size_t rowPitch = 0;
+        void* pData = device->mapStagingTexture(stagingTexture, nvrhi::TextureSlice(), nvrhi::CpuAccessMode::Read, &rowPitch);
+        HE_VERIFY(pData);
+
+        // write next to the previous file and swap, an interrupted write never corrupts the last good one
+        auto tmpPath = std::filesystem::path(filePath).replace_extension(".tmp");
+        {
+            std::ofstream file(tmpPath, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            const size_t rowSize = size_t(header.width) * sizeof(Math::float4);
+            for (uint32_t y = 0; y < header.height; y++)
+                file.write(reinterpret_cast<const char*>(pData) + y * rowPitch, rowSize);
+        }
+
+        device->unmapStagingTexture(stagingTexture);
+
+        std::unique_lock<std::mutex> lock;
+        if (checkpoint)
+        {
+            lock = std::unique_lock(checkpoint->mutex);
+            if (checkpoint->retired)
+            {
+                std::error_code ec;
+                std::filesystem::remove(tmpPath, ec);
+                return;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, filePath, ec);
+        if (ec)
+            HE_ERROR("Failed to write accumulation: {}, {}", filePath.string(), ec.message());
+        else
+            HE_TRACE("Accumulation written: {} ({} samples)", filePath.string(), header.sampleCount);
+    });
+}
+
+void Editor::SaveCheckpoint(uint64_t sceneHash)
+{
+    auto& ctx = Editor::GetContext();
+
+    Editor::WriteAccumulation(GetCheckpointPath(ctx.frameIndex), sceneHash, ctx.checkpoint);
+}
+
+bool Editor::ResumeFromCheckpoint(uint64_t sceneHash)
+{
+    HE_PROFILE_FUNCTION();
+
+    auto& ctx = Editor::GetContext();
+
+    auto filePath = GetCheckpointPath(ctx.frameIndex);
+    if (!std::filesystem::exists(filePath))
+        return false;
+
+    std::ifstream file(filePath, std::ios::binary);
+
+    CheckpointHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!file ||
+        header.magic != CheckpointHeader::c_Magic ||
+        header.version != CheckpointHeader::c_Version ||
+        header.sceneHash != sceneHash ||
+        header.width != (uint32_t)ctx.width ||
+        header.height != (uint32_t)ctx.height ||
+        header.sampleCount >= (uint32_t)ctx.maxSamples)
+    {
+        HE_TRACE("Ignoring stale checkpoint: {}", filePath.string());
+        return false;
+    }
+
+    std::vector<Math::float4> pixels(size_t(header.width) * header.height);
+    file.read(reinterpret_cast<char*>(pixels.data()), pixels.size() * sizeof(Math::float4));
+    if (!file)
+    {
+        HE_ERROR("Truncated checkpoint: {}", filePath.string());
+        return false;
+    }
+
+    HRay::ResumeAccumulation(ctx.rd, ctx.fd, ctx.commandList, header.width, header.height, pixels.data(), header.width * sizeof(Math::float4), header.rendererFrameIndex);
+    ctx.sampleCount = header.sampleCount;
+
+    HE_INFO("Resumed frame {} from checkpoint at {} samples", ctx.frameIndex, header.sampleCount);
+
+    return true;
+}
+
+void Editor::RemoveCheckpoint(uint32_t frameIndex)
+{
+    auto& ctx = Editor::GetContext();
+
+    // the writes of this frame may still be queued, they are dropped rather than renamed over the removed file
+    {
+        std::scoped_lock lock(ctx.checkpoint->mutex);
+        ctx.checkpoint->retired = true;
+
+        std::error_code ec;
+        std::filesystem::remove(GetCheckpointPath(frameIndex), ec);
+    }
+
+    ctx.checkpoint = HE::CreateRef<CheckpointState>();
+}
+
+void Editor::RenderDistributed()
+{
+    HE_PROFILE_FUNCTION();
+
+    auto& ctx = Editor::GetContext();
+    auto& dr = ctx.distributed;
+
+    if (dr.active)
+        return;
+
+    if (!std::filesystem::exists(ctx.outputPath))
+    {
+        HE_ERROR("Invalid path: {}", ctx.outputPath);
+        return;
+    }
+
+    // workers load the project and the scene from disk
+    Editor::GetAssetManager().SaveAsset(ctx.sceneHandle);
+    Editor::Serialize();
+
+    std::filesystem::path executable = std::filesystem::absolute(Application::GetApplicationDesc().commandLineArgs[0]);
+
+    // workers share the project read-only, their partials, checkpoints and tiles go to scratch directories outside of it
+    std::random_device random;
+    uint64_t runId = (uint64_t(random()) << 32) | random();
+    std::error_code ec;
+    std::filesystem::path scratchDir = std::filesystem::temp_directory_path(ec) / std::format("HRay-{:016x}", runId);
+    if (ec)
+    {
+        HE_ERROR("Failed to find the temporary directory : {}", ec.message());
+        return;
+    }
+
+    int workerCount = std::max(dr.workerCount, 1);
+    int frameStep = std::max(ctx.frameStep, 1);
+    int frameCount = (ctx.frameEnd - ctx.frameStart + frameStep - 1) / frameStep;
+
+    // workers of one frame draw consecutive sample indices, merged they form a single low discrepancy sequence
+    int firstSample = 0;
+
+    dr.active = true;
+    dr.frameIndex = ctx.frameStart;
+    dr.workers = HE::CreateRef<DistributedRender::Workers>();
+    dr.partials.clear();
+    dr.scratchDir = scratchDir;
+
+    for (int k = 0; k < workerCount; k++)
+    {
+        // headless, the exit code of a batch render reports its failures. The renderer settings come with the project
+        auto workerDir = scratchDir / std::format("Worker{}", k);
+        std::string args = std::format("--batch --size {} {} --output \"{}\" --worker \"{}\"", ctx.width, ctx.height, ctx.outputPath, workerDir.string());
+
+        if (dr.mode == DistributedMode::Frames)
+        {
+            int begin = k * frameCount / workerCount;
+            int end = (k + 1) * frameCount / workerCount;
+            if (begin == end)
+                continue;
+
+            args += std::format(" --frames {} {} {} --spp {}", ctx.frameStart + begin * frameStep, ctx.frameStart + end * frameStep, frameStep, ctx.maxSamples);
+        }
+        else
+        {
+            int spp = ctx.maxSamples / workerCount + (k < ctx.maxSamples % workerCount ? 1 : 0);
+            if (spp == 0)
+                continue;
+
+            auto partial = workerDir / std::format("{}.hcp", ctx.frameStart);
+            dr.partials.push_back(partial);
+
+            args += std::format(" --frames {} {} 1 --spp {} --first-sample {} --partial \"{}\"", ctx.frameStart, ctx.frameStart + 1, spp, firstSample, partial.string());
+            firstSample += spp;
+        }
+
+        std::string command = std::format("\"{}\" \"{}\" {}", executable.string(), ctx.project.projectFilePath.string(), args);
+#ifdef _WIN32
+        command = "\"" + command + "\""; // cmd.exe strips the outer quotes
+#endif
+
+        HE_INFO("Starting render worker {} : {}", k, command);
+
+        dr.workers->running++;
+        std::thread([command, workers = dr.workers]() {
+
+            int result = std::system(command.c_str());
+            if (result != 0)
+            {
+                HE_ERROR("Render worker failed with {} : {}", result, command);
+                workers->failed++;
+            }
+
+            workers->running--;
+        }).detach();
+    }
+}
+
+bool Editor::MergePartialRenders(const std::vector<std::filesystem::path>& partials, const std::string& filePath, EXRPixelType pixelType, EXRCompression compression)
+{
+    HE_PROFILE_FUNCTION();
+
+    CheckpointHeader reference;
+    std::vector<Math::float4> merged;
+    std::vector<Math::float4> pixels;
+    uint64_t totalSamples = 0;
+
+    for (const auto& path : partials)
+    {
+        std::ifstream file(path, std::ios::binary);
+
+        CheckpointHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        if (!file || header.magic != CheckpointHeader::c_Magic || header.version != CheckpointHeader::c_Version)
+        {
+            HE_ERROR("Invalid partial render: {}", path.string());
+            return false;
+        }
+
+        if (merged.empty())
+        {
+            reference = header;
+            merged.assign(size_t(header.width) * header.height, Math::float4(0.0f));
+        }
+        else if (header.width != reference.width || header.height != reference.height || header.sceneHash != reference.sceneHash)
+        {
+            HE_ERROR("Partial render does not match the others: {}", path.string());
+            return false;
+        }
+
+        pixels.resize(merged.size());
+        file.read(reinterpret_cast<char*>(pixels.data()), pixels.size() * sizeof(Math::float4));
+        if (!file)
+        {
+            HE_ERROR("Truncated partial render: {}", path.string());
+            return false;
+        }
+
+        // partials hold radiance sums and per pixel sample counts, merging is a plain sum
+        HRay::ParallelFor((uint32_t)merged.size(), 4096, [&](uint32_t i) {
+            merged[i] += pixels[i];
+        });
+
+        totalSamples += header.sampleCount;
+    }
+
+    if (totalSamples == 0)
+        return false;
+
+    HRay::ParallelFor((uint32_t)merged.size(), 4096, [&](uint32_t i) {
+        HRay::ResolveAccumulation(&merged[i], 1);
+    });
+
+    return Editor::WriteEXR(filePath, reference.width, reference.height, reinterpret_cast<const uint8_t*>(merged.data()), reference.width * sizeof(Math::float4), pixelType, compression);
+}
+
+bool Editor::IsEntityNameExistInChildren(Assets::Scene* scene, const std::string& name, Assets::Entity entity)
+{
+    for (auto id : entity.GetChildren())
+    {
+        Assets::Entity entity = scene->FindEntity(id);
+        if (entity.GetName() == name)
+            return true;
+    }
+
+    return false;
+}
+
+std::string Editor::GetIncrementedReletiveEntityName(Assets::Scene* scene, const std::string& name, Assets::Entity parent)
+{
+    if (!IsEntityNameExistInChildren(scene, name, parent))
+        return  name;
+
+    std::string result = IncrementString(name);
+    return GetIncrementedReletiveEntityName(scene, result, parent); // keep Incrementing the number
+}
+
+Assets::Entity Editor::CreateEntity(Assets::Scene* scene, const std::string& key, Assets::UUID parent)
+{
+    auto& ctx = Editor::GetContext();
+
+    if (ctx.createEnityFucntions.contains(key))
+        return ctx.createEnityFucntions.at(key)(scene, parent);
 
     return {};
 }
@@ -1558,6 +2663,14 @@ void Editor::Serialize()
         out << "\t\"sceneHandle\" : " << ctx.sceneHandle << ",\n";
     }
 
+    // instance masks
+    {
+        out << "\t\"instanceMasks\" : [";
+        for (size_t i = 0; auto& [uuid, mask] : ctx.instanceMasks)
+            out << (i++ ? ", " : " ") << "{ \"uuid\" : " << uuid << ", \"mask\" : " << mask << " }";
+        out << " ],\n";
+    }
+
     {
         Editor::SerializeWindows(out);
     }
@@ -1569,9 +2682,28 @@ void Editor::Serialize()
             out << "\t\t\"frameStart\" : " << ctx.frameStart << ",\n";
             out << "\t\t\"frameEnd\" : " << ctx.frameEnd << ",\n";
             out << "\t\t\"frameStep\" : " << ctx.frameStep << ",\n";
+            out << "\t\t\"tileSize\" : " << ctx.tileSize << ",\n";
             out << "\t\t\"maxSamples\" : " << ctx.maxSamples << ",\n";
             out << "\t\t\"width\" : " << ctx.width << ",\n";
             out << "\t\t\"height\" : " << ctx.height << ",\n";
+            out << "\t\t\"outputFormat\" : \"" << magic_enum::enum_name<OutputFormat>(ctx.outputFormat) << "\",\n";
+            out << "\t\t\"exrPixelType\" : \"" << magic_enum::enum_name<EXRPixelType>(ctx.exrPixelType) << "\",\n";
+            out << "\t\t\"exrCompression\" : \"" << magic_enum::enum_name<EXRCompression>(ctx.exrCompression) << "\",\n";
+            out << "\t\t\"enableCheckpoints\" : " << (ctx.enableCheckpoints ? "true" : "false") << ",\n";
+            out << "\t\t\"checkpointInterval\" : " << ctx.checkpointInterval << ",\n";
+            out << "\t\t\"distributedWorkers\" : " << ctx.distributed.workerCount << ",\n";
+            out << "\t\t\"distributedMode\" : \"" << magic_enum::enum_name<DistributedMode>(ctx.distributed.mode) << "\",\n";
+
+            // renderer settings of the offline renders, batch renders and distributed workers read them from here
+            const auto& settings = ctx.fd.sceneInfo.settings;
+            const auto& postProssing = ctx.fd.sceneInfo.postProssing;
+            out << "\t\t\"maxLighteBounces\" : " << settings.maxLighteBounces << ",\n";
+            out << "\t\t\"samplerType\" : \"" << magic_enum::enum_name<HRay::SamplerType>(settings.samplerType) << "\",\n";
+            out << "\t\t\"integrator\" : \"" << magic_enum::enum_name<HRay::IntegratorType>(ctx.fd.integrator) << "\",\n";
+            out << "\t\t\"enableCompensatedSummation\" : " << (settings.enableCompensatedSummation ? "true" : "false") << ",\n";
+            out << "\t\t\"exposure\" : " << postProssing.exposure << ",\n";
+            out << "\t\t\"gamma\" : " << postProssing.gamma << ",\n";
+            out << "\t\t\"tonMappingType\" : \"" << magic_enum::enum_name<HRay::TonMapingType>(postProssing.tonMappingType) << "\",\n";
 
             out << "\t\t\"fontScale\" : " << ctx.fontScale << ",\n";
             out << "\t\t\"enableTitlebar\" : " << (ctx.enableTitlebar ? "true" : "false") << "\n";
@@ -1609,7 +2741,22 @@ bool Editor::Deserialize()
             ctx.sceneHandle = sceneHandleData.get_uint64().value();
     }
 
-    if(!doc.error())
+    // instance masks
+    {
+        auto instanceMasks = doc["instanceMasks"];
+        if (!instanceMasks.error())
+        {
+            for (auto element : instanceMasks.get_array())
+            {
+                auto uuid = element["uuid"];
+                auto mask = element["mask"];
+                if (!uuid.error() && !mask.error())
+                    ctx.instanceMasks[uuid.get_uint64().value()] = (uint32_t)mask.get_uint64().value() & HRay::c_instanceMaskAll;
+            }
+        }
+    }
+
+    if(!doc.error() && !ctx.batchMode)
         Editor::DeserializeWindows(doc.value());
 
     auto main = doc["main"];
@@ -1633,6 +2780,12 @@ bool Editor::Deserialize()
                 ctx.frameStep = (int)frameStep.get_int64().value();
         }
 
+        {
+            auto tileSize = main["tileSize"];
+            if (!tileSize.error())
+                ctx.tileSize = (int)tileSize.get_int64().value();
+        }
+
         {
             auto maxSamples = main["maxSamples"];
             if (!maxSamples.error())
@@ -1650,6 +2803,90 @@ bool Editor::Deserialize()
             if (!height.error())
                 ctx.height = (int)height.get_int64().value();
         }
+
+        {
+            auto outputFormat = main["outputFormat"];
+            if (!outputFormat.error())
+                ctx.outputFormat = magic_enum::enum_cast<OutputFormat>(outputFormat.get_c_str().value()).value_or(OutputFormat::PNG);
+        }
+
+        {
+            auto exrPixelType = main["exrPixelType"];
+            if (!exrPixelType.error())
+                ctx.exrPixelType = magic_enum::enum_cast<EXRPixelType>(exrPixelType.get_c_str().value()).value_or(EXRPixelType::Half);
+        }
+
+        {
+            auto exrCompression = main["exrCompression"];
+            if (!exrCompression.error())
+                ctx.exrCompression = magic_enum::enum_cast<EXRCompression>(exrCompression.get_c_str().value()).value_or(EXRCompression::RLE);
+        }
+
+        {
+            auto enableCheckpoints = main["enableCheckpoints"];
+            if (!enableCheckpoints.error())
+                ctx.enableCheckpoints = enableCheckpoints.get_bool().value();
+        }
+
+        {
+            auto checkpointInterval = main["checkpointInterval"];
+            if (!checkpointInterval.error())
+                ctx.checkpointInterval = (float)checkpointInterval.get_double().value();
+        }
+
+        {
+            auto distributedWorkers = main["distributedWorkers"];
+            if (!distributedWorkers.error())
+                ctx.distributed.workerCount = (int)distributedWorkers.get_int64().value();
+        }
+
+        {
+            auto distributedMode = main["distributedMode"];
+            if (!distributedMode.error())
+                ctx.distributed.mode = magic_enum::enum_cast<DistributedMode>(distributedMode.get_c_str().value()).value_or(DistributedMode::Frames);
+        }
+
+        {
+            auto maxLighteBounces = main["maxLighteBounces"];
+            if (!maxLighteBounces.error())
+                ctx.fd.sceneInfo.settings.maxLighteBounces = (int)maxLighteBounces.get_int64().value();
+        }
+
+        {
+            auto samplerType = main["samplerType"];
+            if (!samplerType.error())
+                ctx.fd.sceneInfo.settings.samplerType = magic_enum::enum_cast<HRay::SamplerType>(samplerType.get_c_str().value()).value_or(HRay::SamplerType::Sobol);
+        }
+
+        {
+            auto integrator = main["integrator"];
+            if (!integrator.error())
+                ctx.fd.integrator = magic_enum::enum_cast<HRay::IntegratorType>(integrator.get_c_str().value()).value_or(HRay::IntegratorType::Megakernel);
+        }
+
+        {
+            auto enableCompensatedSummation = main["enableCompensatedSummation"];
+            if (!enableCompensatedSummation.error())
+                ctx.fd.sceneInfo.settings.enableCompensatedSummation = enableCompensatedSummation.get_bool().value();
+        }
+
+        {
+            auto exposure = main["exposure"];
+            if (!exposure.error())
+                ctx.fd.sceneInfo.postProssing.exposure = (float)exposure.get_double().value();
+        }
+
+        {
+            auto gamma = main["gamma"];
+            if (!gamma.error())
+                ctx.fd.sceneInfo.postProssing.gamma = (float)gamma.get_double().value();
+        }
+
+        {
+            auto tonMappingType = main["tonMappingType"];
+            if (!tonMappingType.error())
+                ctx.fd.sceneInfo.postProssing.tonMappingType = magic_enum::enum_cast<HRay::TonMapingType>(tonMappingType.get_c_str().value()).value_or(ctx.fd.sceneInfo.postProssing.tonMappingType);
+        }
         
         {
             auto fontScale = main["fontScale"];
@@ -1664,7 +2901,8 @@ bool Editor::Deserialize()
         }
     }
 
-    Editor::DeserializeWindowsState();
+    if (!ctx.batchMode)
+        Editor::DeserializeWindowsState();
 
     return true;
 }
@@ -1676,7 +2914,7 @@ HE::ApplicationContext* HE::CreateApplication(ApplicationCommandLineArgs args)
     desc.commandLineArgs = args;
 
 #ifdef HE_DIST
-    if (args.count == 2)
+    if (args.count >= 2)
         desc.workingDirectory = std::filesystem::path(args[0]).parent_path();
 #endif
 
@@ -305,6 +305,24 @@ export namespace Editor {
         Math::quat   endRotation;
     };
 
+    enum class OutputFormat
+    {
+        PNG,
+        EXR
+    };
+
+    enum class EXRPixelType
+    {
+        Half,
+        Float
+    };
+
+    enum class EXRCompression
+    {
+        None,
+        RLE
+    };
+
     struct PixelReadbackPass
     {
         void Init(nvrhi::IDevice* device);
@@ -323,6 +341,150 @@ export namespace Editor {
         void* mapedBuffer = nullptr;
     };
 
+    // Fills rows [y, y + count) of an image into dst, rows are tightly packed. Lets the writers stream
+    // an image in scanline bands instead of holding all of it in memory.
+    using ReadRowsFn = std::function<void(uint32_t y, uint32_t count, uint8_t* dst)>;
+
+    // Disk backed image of a tiled render. Finished tiles are written in place into a raw file in the cache
+    // directory and the encoder streams it back in scanline bands, so the memory use is bounded by the tile size
+    // and not by the output resolution. The raw file is removed with the image.
+    struct TiledImage
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t tileSize = 0;
+        nvrhi::Format format = nvrhi::Format::UNKNOWN;
+        uint32_t bytesPerPixel = 0;
+        std::atomic<uint32_t> remainingTiles = 0;
+
+        std::filesystem::path storagePath;
+        std::fstream storage;
+        std::mutex mutex;
+
+        std::string filePath;
+        OutputFormat outputFormat = OutputFormat::PNG;
+        EXRPixelType pixelType = EXRPixelType::Half;
+        EXRCompression compression = EXRCompression::RLE;
+
+        ~TiledImage();
+        bool Create(const std::filesystem::path& path, uint32_t width, uint32_t height, uint32_t tileSize, nvrhi::Format format);
+        void WriteTile(uint32_t x, uint32_t y, uint32_t tileWidth, uint32_t tileHeight, const uint8_t* data, size_t rowPitch);
+        void ReadRows(uint32_t y, uint32_t count, uint8_t* dst);
+    };
+
+    // Ring of staging textures for offline renders. The copy is recorded into the frame command list,
+    // the encode job starts once the GPU signals the slot's event query, so encoding overlaps the next frames.
+    struct ReadbackQueue
+    {
+        static constexpr uint32_t c_MaxSlots = 3;
+
+        // called on a worker thread once the copy is done, maps / unmaps the staging texture itself
+        using EncodeFn = std::function<void(nvrhi::IDevice* device, nvrhi::IStagingTexture* stagingTexture)>;
+
+        struct Slot
+        {
+            enum class State
+            {
+                Free,
+                Recorded,
+                Submitted,
+                Encoding
+            };
+
+            nvrhi::StagingTextureHandle stagingTexture;
+            nvrhi::EventQueryHandle eventQuery;
+            EncodeFn encode;
+            std::atomic<State> state = State::Free;
+        };
+
+        nvrhi::DeviceHandle device;
+        nvrhi::CommandListHandle recordingCommandList; // holds the copies of the Recorded slots until it is executed
+        std::array<Slot, c_MaxSlots> slots;
+        uint32_t next = 0;
+        std::atomic<uint32_t> failedWrites = 0;
+
+        void Init(nvrhi::IDevice* device);
+        void Enqueue(nvrhi::ICommandList* commandList, nvrhi::ITexture* texture, EncodeFn encode);
+        void Enqueue(nvrhi::ICommandList* commandList, nvrhi::ITexture* texture, const std::string& directory, uint32_t frameIndex, OutputFormat format, EXRPixelType pixelType, EXRCompression compression);
+        void Enqueue(nvrhi::ICommandList* commandList, nvrhi::ITexture* texture, HE::Ref<TiledImage> image, uint32_t x, uint32_t y);
+        void Submit();
+        void SubmitRecorded();
+        void Update();
+        void Flush();
+    };
+
+    // Shared by the queued checkpoint writes of a frame. Once the frame completes its checkpoint is retired and
+    // a write still in the queue is dropped instead of bringing the file back
+    struct CheckpointState
+    {
+        std::mutex mutex;
+        bool retired = false;
+    };
+
+    enum class DistributedMode
+    {
+        Frames,  // each worker renders a contiguous part of the frame range
+        Samples  // each worker renders a share of the samples of one frame, partial results are merged
+    };
+
+    // Offline render split across local worker processes, each worker runs this executable with --batch and --worker
+    struct DistributedRender
+    {
+        DistributedMode mode = DistributedMode::Frames;
+        int workerCount = 2;
+
+        // shared with the detached threads waiting on the worker processes, they may outlive the render and the context
+        struct Workers
+        {
+            std::atomic<int> running = 0;
+            std::atomic<int> failed = 0;
+        };
+
+        bool active = false;
+        int frameIndex = 0;
+        HE::Ref<Workers> workers = HE::CreateRef<Workers>();
+        std::vector<std::filesystem::path> partials;
+        std::filesystem::path scratchDir; // under the temporary directory, the worker directories, removed once the render is done
+    };
+
+    // Render service started with --serve : renders job files dropped into a spool directory,
+    // the project, its assets and the acceleration structures stay loaded between jobs
+    struct RenderServer
+    {
+        enum class State
+        {
+            Idle,
+            Loading,
+            Rendering
+        };
+
+        bool enabled = false;
+        std::filesystem::path jobsDir;
+        State state = State::Idle;
+
+        // project settings a job overrides, restored once it finishes
+        struct Settings
+        {
+            Assets::AssetHandle sceneHandle = 0;
+            int frameStart = 0;
+            int frameEnd = 0;
+            int frameStep = 1;
+            int maxSamples = 1;
+            int width = 0;
+            int height = 0;
+            std::string outputPath;
+            OutputFormat outputFormat = OutputFormat::PNG;
+        };
+
+        std::filesystem::path jobFilePath;
+        std::string camera;
+        Settings projectSettings;
+        bool hasProjectSettings = false;
+        float jobStartTime = 0.0f;
+        float lastPollTime = 0.0f;
+        float lastStatusTime = 0.0f;
+    };
+
     struct App;
     struct Context
     {
@@ -354,6 +516,9 @@ export namespace Editor {
 
         Assets::Entity selectedEntity;
 
+        // TLAS instance mask of the mesh entities by UUID, see HRay::c_instanceMaskCamera. Entities not listed are visible to every ray
+        std::map<uint64_t, uint32_t> instanceMasks;
+
         bool enableTitlebar = true;
         bool enableStartMenu = true;
         bool enableCreateNewProjectPopub = false;
@@ -369,10 +534,37 @@ export namespace Editor {
         int width = 1920;
         int height = 1080;
 
+        // renders the frame in tiles of tileSize x tileSize pixels, only one tile is resident on the GPU. 0 disables tiling
+        int tileSize = 0;
+        uint32_t tileIndex = 0;
+        HE::Ref<TiledImage> tiledImage;
+
         int frameStart = 0;
         int frameEnd = 50;
         int frameStep = 1;
         int maxSamples = 1024;
+
+        OutputFormat outputFormat = OutputFormat::PNG;
+        EXRPixelType exrPixelType = EXRPixelType::Half;
+        EXRCompression exrCompression = EXRCompression::RLE;
+        ReadbackQueue readbackQueue;
+
+        bool enableCheckpoints = true;
+        float checkpointInterval = 120.0f; // seconds
+        float lastCheckpointTime = 0.0f;
+        HE::Ref<CheckpointState> checkpoint = HE::CreateRef<CheckpointState>();
+
+        // started with --render : render on start, exit when done and never write back to the project
+        bool commandLineRender = false;
+        bool renderStarted = false;
+
+        // started with --batch : no plugins, ImGui, Tiny2D, icons or windows, the process exit code reports failures
+        bool batchMode = false;
+        int exitCode = 0;
+        std::filesystem::path partialOutputPath;
+        std::filesystem::path statsOutputPath; // --stats, rewritten after every frame with the HRay::RendererStats of its last sample
+        DistributedRender distributed;
+        RenderServer renderServer;
         
         int sampleCount = 0;
         int frameIndex = 0;
@@ -400,6 +592,10 @@ export namespace Editor {
     nvrhi::ITexture* GetIcon(AppIcons icon);
 
     Assets::Entity GetSceneCamera(Assets::Scene* scene);
+    uint32_t GetInstanceMask(Assets::Entity entity);
+    bool WriteRendererStats(const std::filesystem::path& file); // stats of the last frame of the render as JSON
+    void SetInstanceMask(Assets::Entity entity, uint32_t mask);
+    void InvalidateMeshDebugLines(Assets::Asset asset); // drops the debug lines cached for a mesh source that was reloaded
    
     void SetRendererToSceneCameraProp(HRay::FrameData& frameData, const Assets::CameraComponent& c);
 
@@ -415,12 +611,26 @@ export namespace Editor {
     void OpenStartMeue();
 
     void Clear();
+    void ClearViewPorts(); // restarts the accumulation of the interactive views only
 
     Assets::Entity GetSelectedEntity();
     void SelectEntity(Assets::Entity entity);
     Assets::Scene* GetScene();
 
     void Save(nvrhi::IDevice* device, nvrhi::ITexture* texture, const std::string& directory, uint32_t frameIndex);
+    void SaveEXR(nvrhi::IDevice* device, nvrhi::ITexture* texture, const std::string& directory, uint32_t frameIndex, EXRPixelType pixelType, EXRCompression compression);
+    void WriteAccumulation(const std::filesystem::path& filePath, uint64_t sceneHash, HE::Ref<CheckpointState> checkpoint = nullptr);
+    void SaveCheckpoint(uint64_t sceneHash);
+    bool ResumeFromCheckpoint(uint64_t sceneHash);
+    void RemoveCheckpoint(uint32_t frameIndex);
+    void UpdateRenderServer();
+    void ShutdownRenderServer(); // fails the running job and restores the project settings it overrode
+    bool IsSceneLoaded(Assets::Scene* scene);
+    void RenderDistributed();
+    bool MergePartialRenders(const std::vector<std::filesystem::path>& partials, const std::string& filePath, EXRPixelType pixelType, EXRCompression compression);
+    bool WriteEXR(const std::string& filePath, uint32_t width, uint32_t height, const uint8_t* data, size_t rowPitch, EXRPixelType pixelType, EXRCompression compression);
+    bool WriteEXR(const std::string& filePath, uint32_t width, uint32_t height, uint32_t bandHeight, const ReadRowsFn& readRows, EXRPixelType pixelType, EXRCompression compression);
+    bool WritePNG(const std::string& filePath, uint32_t width, uint32_t height, uint32_t bandHeight, const ReadRowsFn& readRows);
     void ImportMeshSource(Assets::Scene* scene, Assets::Entity parent, Assets::Node& node, Assets::Asset asset)
     {
         for (auto& node : node.GetChildren(asset.Get<Assets::MeshSourecHierarchy>()))
@@ -554,6 +764,7 @@ export namespace Editor {
             bool enableMeshAABB = false;
             bool enableStats = false;
             float lineLength = 0.05f;
+            float lineSpacing = 4.0f;
             float colorOpacity = 1.0f;
         } debug;
 
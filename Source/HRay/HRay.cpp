@@ -2,10 +2,14 @@
 
 #if NVRHI_HAS_D3D12
 #include "Embeded/dxil/Main.bin.h"
+#include "Embeded/dxil/Wavefront.bin.h"
+#include "Embeded/dxil/WavefrontScan_Main.bin.h"
 #endif
 
 #if NVRHI_HAS_VULKAN
 #include "Embeded/spirv/Main.bin.h"
+#include "Embeded/spirv/Wavefront.bin.h"
+#include "Embeded/spirv/WavefrontScan_Main.bin.h"
 #endif
 
 import HRay;
@@ -21,6 +25,10 @@ struct MeshSourceBuffers
 {
     nvrhi::BufferHandle indexBuffer;
     nvrhi::BufferHandle vertexBuffer;
+
+    // layout of vertexBuffer, quantization.data is released once uploaded
+    HRay::VertexLayout vertexLayout = HRay::VertexLayout::Float;
+    HRay::QuantizedVertices quantization;
 };
 
 struct MeshSourceDescriptors
@@ -29,33 +37,112 @@ struct MeshSourceDescriptors
     Assets::DescriptorHandle vertexBufferDescriptor;
 };
 
-struct HitInfo
+// Triangle classification of the alpha tested geometries, keyed by the byte offset of their indices.
+// The classification reorders the triangles in cpuIndexBuffer, see HRay::ClassifyTriangles
+struct MeshSourceOpacity
+{
+    std::map<uint64_t, HRay::GeometryOpacity> geometries;
+};
+
+// mirrors RayPayload in Base.hlsli, sizes the pipeline payload
+struct RayPayload
 {
-    Math::float3 normal;
-    Math::float3 ffnormal;
-    Math::float3 tangent;
-    Math::float3 bitangent;
     float distance;
-    uint32_t entityID;
-
-    Math::float3 baseColor;
-    Math::float3 emissive;
-    float metallic;
-    float roughness;
-    float anisotropic;
-    float subsurface;
-    float specularTint;
-    float sheen;
-    float sheenTint;
-    float clearcoat;
-    float clearcoatRoughness;
-    float specTrans;
-    float ior;
-
-    float eta;
-    float ax, ay;
+    uint32_t instanceIndex;
+    uint32_t primitiveIndex;
+    uint32_t geometryIndex;
+    uint32_t barycentrics;
+};
+
+static_assert(sizeof(RayPayload) == 20);
+
+// mirror the structures of Wavefront.hlsl
+struct PathState
+{
+    Math::float3 origin;
+    uint32_t rngState;
+    Math::float3 direction;
+    float coneWidth;
+    Math::float3 throughput;
+    float coneSpreadAngle;
+    uint32_t rayMask;
 };
 
+struct HitRecord
+{
+    RayPayload payload;
+    uint32_t pathIndex;
+    uint32_t materialIndex;
+};
+
+struct WavefrontConstants
+{
+    uint32_t sampleIndex;
+    uint32_t bounce;
+    uint32_t materialCount;
+    uint32_t targetWidth;
+};
+
+// mirrors WavefrontScanConstants in WavefrontScan.hlsl
+struct WavefrontScanConstants
+{
+    uint32_t bounce;
+    uint32_t materialCount;
+};
+
+// Wavefront.hlsl entry points in dispatch order, index the shader tables of HRay::WavefrontPipeline.
+// The material scan between Count and Scatter is the compute shader of WavefrontScan.hlsl
+enum class WavefrontStage : uint32_t
+{
+    Generate,
+    Extend,
+    Count,
+    Scatter,
+    Shade,
+    Resolve
+};
+
+constexpr std::array<const char*, 6> c_WavefrontStageNames = { "Generate", "Extend", "Count", "Scatter", "Shade", "Resolve" };
+static_assert(c_WavefrontStageNames.size() == std::tuple_size_v<decltype(HRay::WavefrontPipeline::shaderTables)>);
+constexpr uint32_t c_WavefrontCounterCount = 4; // two ray queue sizes and the hit count
+
+// layouts of PathTracer.hlsli, whole 16 byte lines. The shaders assert the sizes too
+static_assert(sizeof(HRay::GeometryData) == 64);
+static_assert(offsetof(HRay::GeometryData, texCoord0Offset) == 16);
+static_assert(offsetof(HRay::GeometryData, positionBias) == 32);
+static_assert(offsetof(HRay::GeometryData, positionScale) == 48);
+static_assert(sizeof(HRay::InstanceData) == 80);
+static_assert(offsetof(HRay::InstanceData, normalMatrix) == 48);
+static_assert(offsetof(HRay::InstanceData, id) == 68);
+
+static void WriteBuffer(HRay::FrameData& frameData, nvrhi::ICommandList* commandList, nvrhi::IBuffer* buffer, const void* data, size_t byteSize, uint64_t destOffset = 0)
+{
+    commandList->writeBuffer(buffer, data, byteSize, destOffset);
+    frameData.stats.uploadBytes += byteSize;
+}
+
+// adds the VRAM of a resource once per frame however many instances reference it
+static void AddResourceBytes(HRay::FrameData& frameData, const void* resource, uint64_t& counter, uint64_t byteSize)
+{
+    if (resource && frameData.statsResources.insert(resource).second)
+        counter += byteSize;
+}
+
+static uint64_t GetTextureBytes(const nvrhi::TextureDesc& desc)
+{
+    const auto& formatInfo = nvrhi::getFormatInfo(desc.format);
+
+    uint64_t byteSize = 0;
+    for (uint32_t level = 0; level < desc.mipLevels; level++)
+    {
+        uint64_t blocksX = (std::max(desc.width >> level, 1u) + formatInfo.blockSize - 1) / formatInfo.blockSize;
+        uint64_t blocksY = (std::max(desc.height >> level, 1u) + formatInfo.blockSize - 1) / formatInfo.blockSize;
+        byteSize += blocksX * blocksY * formatInfo.bytesPerBlock;
+    }
+
+    return byteSize * desc.arraySize * desc.depth;
+}
+
 static void GetCameraBasis(const Math::float4x4& clipToWorld, Math::float3& camFront, Math::float3& camUp, Math::float3& camRight)
 {
     Math::float4 originCS = Math::float4(0, 0, 0, 1);
@@ -98,6 +185,263 @@ static float Luminance(float r, float g, float b)
     return 0.212671f * r + 0.715160f * g + 0.072169f * b;
 }
 
+// Sobol direction numbers from Joe and Kuo (new-joe-kuo-6.21201), the first dimension is the van der Corput sequence
+// Reference: https://web.maths.unsw.edu.au/~fkuo/sobol/
+struct SobolPolynomial
+{
+    uint32_t degree;
+    uint32_t coefficients;
+    uint32_t m[6];
+};
+
+static constexpr SobolPolynomial c_SobolPolynomials[HRay::c_SobolDimensions - 1] = {
+    { 1, 0,  { 1 } },
+    { 2, 1,  { 1, 3 } },
+    { 3, 1,  { 1, 3, 1 } },
+    { 3, 2,  { 1, 1, 1 } },
+    { 4, 1,  { 1, 1, 3, 3 } },
+    { 4, 4,  { 1, 3, 5, 13 } },
+    { 5, 2,  { 1, 1, 5, 5, 17 } },
+    { 5, 4,  { 1, 1, 5, 5, 5 } },
+    { 5, 7,  { 1, 1, 7, 11, 19 } },
+    { 5, 11, { 1, 1, 5, 1, 1 } },
+    { 5, 13, { 1, 1, 1, 3, 11 } },
+    { 5, 14, { 1, 3, 5, 5, 31 } },
+    { 6, 1,  { 1, 3, 3, 9, 7, 49 } },
+    { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+    { 6, 16, { 1, 3, 1, 13, 27, 49 } },
+};
+
+std::vector<uint32_t> HRay::GenerateSobolMatrices()
+{
+    HE_PROFILE_FUNCTION();
+
+    std::vector<uint32_t> matrices(HRay::c_SobolDimensions * HRay::c_SobolBits);
+
+    for (uint32_t k = 0; k < HRay::c_SobolBits; k++)
+        matrices[k] = 1u << (31 - k);
+
+    for (uint32_t d = 1; d < HRay::c_SobolDimensions; d++)
+    {
+        const auto& p = c_SobolPolynomials[d - 1];
+        uint32_t* v = matrices.data() + d * HRay::c_SobolBits;
+
+        for (uint32_t k = 0; k < HRay::c_SobolBits; k++)
+        {
+            if (k < p.degree)
+            {
+                v[k] = p.m[k] << (31 - k);
+                continue;
+            }
+
+            v[k] = v[k - p.degree] ^ (v[k - p.degree] >> p.degree);
+            for (uint32_t j = 1; j < p.degree; j++)
+                if ((p.coefficients >> (p.degree - 1 - j)) & 1)
+                    v[k] ^= v[k - j];
+        }
+    }
+
+    return matrices;
+}
+
+// Hash, LaineKarrasPermutation and NestedUniformScramble of Sampler.hlsli
+static uint32_t SamplerHash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static uint32_t LaineKarrasPermutation(uint32_t x, uint32_t seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+static uint32_t ReverseBits(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+static uint32_t NestedUniformScramble(uint32_t x, uint32_t seed)
+{
+    return ReverseBits(LaineKarrasPermutation(ReverseBits(x), seed));
+}
+
+float HRay::SampleSobol(std::span<const uint32_t> sobolMatrices, uint32_t index, uint32_t dimension, float shift)
+{
+    uint32_t padding = dimension / c_SobolDimensions;
+    uint32_t seed = SamplerHash(dimension);
+    if (padding != 0)
+        index = NestedUniformScramble(index, SamplerHash(padding * 0x9e3779b9u));
+
+    uint32_t result = 0;
+    for (uint32_t bit = 0; index != 0; index >>= 1, bit++)
+    {
+        if (index & 1)
+            result ^= sobolMatrices[(dimension % c_SobolDimensions) * c_SobolBits + bit];
+    }
+
+    float u = float(NestedUniformScramble(result, seed)) * (1.0f / 4294967296.0f) + shift;
+    return std::min(u - std::floor(u), 0.99999994f);
+}
+
+// Void and cluster blue noise, values are the normalized ranks in [0, 1)
+// Reference: Ulichney, The void-and-cluster method for dither array generation, 1993
+static std::vector<float> GenerateBlueNoise(uint32_t size)
+{
+    HE_PROFILE_FUNCTION();
+
+    constexpr float c_Sigma = 1.9f;
+
+    const uint32_t count = size * size;
+
+    // toroidal gaussian, indexed by the offset from the splatted pixel
+    std::vector<float> kernel(count);
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            float dx = float(std::min(x, size - x));
+            float dy = float(std::min(y, size - y));
+            kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * c_Sigma * c_Sigma));
+        }
+    }
+
+    std::vector<uint8_t> pattern(count, 0);
+    std::vector<float> energy(count, 0.0f);
+
+    auto splat = [&](uint32_t p, float sign) {
+        uint32_t px = p % size;
+        uint32_t py = p / size;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            const float* row = kernel.data() + ((y + size - py) % size) * size;
+            for (uint32_t x = 0; x < size; x++)
+                energy[y * size + x] += sign * row[(x + size - px) % size];
+        }
+    };
+
+    auto tightestCluster = [&]() {
+        uint32_t best = 0;
+        float bestEnergy = -std::numeric_limits<float>::max();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (pattern[i] && energy[i] > bestEnergy)
+            {
+                best = i;
+                bestEnergy = energy[i];
+            }
+        }
+        return best;
+    };
+
+    // the tightest cluster of the empty pixels is the largest void of the filled ones
+    auto largestVoid = [&]() {
+        uint32_t best = 0;
+        float bestEnergy = std::numeric_limits<float>::max();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (!pattern[i] && energy[i] < bestEnergy)
+            {
+                best = i;
+                bestEnergy = energy[i];
+            }
+        }
+        return best;
+    };
+
+    // initial binary pattern, random points that are then spread until stable
+    const uint32_t initialCount = count / 10;
+    {
+        std::mt19937 rng(count);
+        std::uniform_int_distribution<uint32_t> dist(0, count - 1);
+        for (uint32_t i = 0; i < initialCount;)
+        {
+            uint32_t p = dist(rng);
+            if (pattern[p])
+                continue;
+
+            pattern[p] = 1;
+            splat(p, 1.0f);
+            i++;
+        }
+
+        while (true)
+        {
+            uint32_t cluster = tightestCluster();
+            pattern[cluster] = 0;
+            splat(cluster, -1.0f);
+
+            uint32_t hole = largestVoid();
+            pattern[hole] = 1;
+            splat(hole, 1.0f);
+
+            if (hole == cluster)
+                break;
+        }
+    }
+
+    std::vector<uint32_t> rank(count);
+    auto prototype = pattern;
+    auto prototypeEnergy = energy;
+
+    for (uint32_t r = initialCount; r > 0; r--)
+    {
+        uint32_t cluster = tightestCluster();
+        pattern[cluster] = 0;
+        splat(cluster, -1.0f);
+        rank[cluster] = r - 1;
+    }
+
+    pattern = std::move(prototype);
+    energy = std::move(prototypeEnergy);
+
+    for (uint32_t r = initialCount; r < count; r++)
+    {
+        uint32_t hole = largestVoid();
+        pattern[hole] = 1;
+        splat(hole, 1.0f);
+        rank[hole] = r;
+    }
+
+    std::vector<float> values(count);
+    for (uint32_t i = 0; i < count; i++)
+        values[i] = (float(rank[i]) + 0.5f) / float(count);
+
+    return values;
+}
+
+template<typename T>
+static void Hash(uint64_t& hash, const T& value)
+{
+    // FNV-1a
+    auto bytes = std::bit_cast<std::array<uint8_t, sizeof(T)>>(value);
+    for (uint8_t b : bytes)
+    {
+        hash ^= b;
+        hash *= 1099511628211ull;
+    }
+}
+
+static void ResetBindingSets(HRay::FrameData& frameData)
+{
+    frameData.bindingSets = {};
+    frameData.wavefront.bindingSets = {};
+    frameData.wavefront.scanBindingSet = nullptr;
+}
+
 static void CreateOrResizeRenderTarget(HRay::RendererData& data, HRay::FrameData& frameData, uint32_t width, uint32_t height)
 {
     HE_PROFILE_FUNCTION();
@@ -111,25 +455,38 @@ static void CreateOrResizeRenderTarget(HRay::RendererData& data, HRay::FrameData
     desc.isRenderTarget = false;
     desc.isUAV = true;
 
-    desc.debugName = "HDRColor";
-    frameData.HDRColor = data.device->createTexture(desc);
+    desc.debugName = "Accumulation0";
+    frameData.accumulation[0] = data.device->createTexture(desc);
 
-    desc.debugName = "accumulationOutput";
-    frameData.accumulationOutput = data.device->createTexture(desc);
+    desc.debugName = "Accumulation1";
+    frameData.accumulation[1] = data.device->createTexture(desc);
 
-    desc.format = nvrhi::Format::RGBA16_UNORM;
+    frameData.accumulationError = nullptr;
+    if (frameData.sceneInfo.settings.enableCompensatedSummation)
+    {
+        desc.debugName = "AccumulationError";
+        frameData.accumulationError = data.device->createTexture(desc);
+    }
+
+    desc.format = HRay::c_ColorTargetFormat;
     desc.debugName = "LDRColor";
     frameData.LDRColor = data.device->createTexture(desc);
 
-    desc.format = nvrhi::Format::D32;
-    desc.debugName = "Depth";
-    frameData.depth = data.device->createTexture(desc);
+    frameData.depth = nullptr;
+    frameData.entitiesID = nullptr;
 
-    desc.format = nvrhi::Format::R32_UINT;
-    desc.debugName = "entitiesID";
-    frameData.entitiesID = data.device->createTexture(desc);
+    if (frameData.enableDepthAndIDTargets)
+    {
+        desc.format = nvrhi::Format::D32;
+        desc.debugName = "Depth";
+        frameData.depth = data.device->createTexture(desc);
 
-    frameData.bindingSet.Reset();
+        desc.format = nvrhi::Format::R32_UINT;
+        desc.debugName = "entitiesID";
+        frameData.entitiesID = data.device->createTexture(desc);
+    }
+
+    ResetBindingSets(frameData);
 }
 
 static void CreateOrResizeGeoBuffer(HRay::RendererData& data, HRay::FrameData& frameData, uint32_t newSize)
@@ -147,7 +504,7 @@ static void CreateOrResizeGeoBuffer(HRay::RendererData& data, HRay::FrameData& f
     bufferDesc.keepInitialState = true;
     frameData.geometryBuffer = data.device->createBuffer(bufferDesc);
 
-    frameData.bindingSet.Reset();
+    ResetBindingSets(frameData);
 }
 
 static void CreateOrResizeInstanceBuffer(HRay::RendererData& data, HRay::FrameData& frameData, uint32_t newSize)
@@ -182,7 +539,7 @@ static void CreateOrResizeInstanceBuffer(HRay::RendererData& data, HRay::FrameDa
         HE_ASSERT(frameData.instanceBuffer);
     }
 
-    frameData.bindingSet.Reset();
+    ResetBindingSets(frameData);
 }
 
 static void CreateOrResizeMaterialBuffer(HRay::RendererData& data, HRay::FrameData& frameData, uint32_t newSize)
@@ -200,7 +557,7 @@ static void CreateOrResizeMaterialBuffer(HRay::RendererData& data, HRay::FrameDa
     bufferDesc.keepInitialState = true;
     frameData.materialBuffer = data.device->createBuffer(bufferDesc);
 
-    frameData.bindingSet.Reset();
+    ResetBindingSets(frameData);
 }
 
 static void CreateOrResizeDirectionalLightBuffer(HRay::RendererData& data, HRay::FrameData& frameData, uint32_t newSize)
@@ -218,7 +575,326 @@ static void CreateOrResizeDirectionalLightBuffer(HRay::RendererData& data, HRay:
     bufferDesc.keepInitialState = true;
     frameData.directionalLightBuffer = data.device->createBuffer(bufferDesc);
 
-    frameData.bindingSet.Reset();
+    ResetBindingSets(frameData);
+}
+
+static void CreateOrResizeWavefrontBuffers(HRay::RendererData& data, HRay::FrameData& frameData, nvrhi::ICommandList* commandList, uint32_t pathCount)
+{
+    HE_PROFILE_FUNCTION();
+
+    auto& wavefront = frameData.wavefront;
+    uint32_t materialCapacity = uint32_t(frameData.materialData.size());
+
+    nvrhi::BufferDesc bufferDesc;
+    bufferDesc.canHaveUAVs = true;
+    bufferDesc.canHaveRawViews = true;
+    bufferDesc.initialState = nvrhi::ResourceStates::UnorderedAccess;
+    bufferDesc.keepInitialState = true;
+
+    auto createBuffer = [&](const char* name, uint32_t stride, size_t count) {
+
+        bufferDesc.debugName = name;
+        bufferDesc.structStride = stride;
+        bufferDesc.byteSize = stride * count;
+        nvrhi::BufferHandle buffer = data.device->createBuffer(bufferDesc);
+        HE_VERIFY(buffer);
+
+        return buffer;
+    };
+
+    wavefront.paths = createBuffer("WavefrontPaths", sizeof(PathState), pathCount);
+    wavefront.rayQueues = createBuffer("WavefrontRayQueues", sizeof(uint32_t), size_t(pathCount) * 2);
+    wavefront.hits = createBuffer("WavefrontHits", sizeof(HitRecord), pathCount);
+    wavefront.sortedHits = createBuffer("WavefrontSortedHits", sizeof(uint32_t), pathCount);
+    wavefront.radianceSum = createBuffer("WavefrontRadianceSum", sizeof(Math::float4), pathCount);
+    wavefront.counters = createBuffer("WavefrontCounters", sizeof(uint32_t), c_WavefrontCounterCount);
+    wavefront.materialBins = createBuffer("WavefrontMaterialBins", sizeof(uint32_t), size_t(materialCapacity) * 2);
+
+    // the scan keeps the bin counts zeroed from one bounce to the next, only the initial state is cleared here
+    commandList->clearBufferUInt(wavefront.counters, 0);
+    commandList->clearBufferUInt(wavefront.materialBins, 0);
+
+    wavefront.pathCount = pathCount;
+    wavefront.materialCapacity = materialCapacity;
+    wavefront.bindingSets = {};
+    wavefront.scanBindingSet = nullptr;
+}
+
+// Index of the Main.hlsl permutation matching the settings, see shaders.cfg
+static uint32_t GetPipelineKey(const HRay::SceneInfo& sceneInfo)
+{
+    uint32_t key = uint32_t(sceneInfo.settings.renderingMode);
+    key |= uint32_t(sceneInfo.view.enableDepthOfField) << 2;
+    key |= uint32_t(sceneInfo.view.enableVisualFocusDistance) << 3;
+
+    return key;
+}
+
+static HRay::PipelinePermutation& GetPipeline(HRay::RendererData& data, const HRay::SceneInfo& sceneInfo)
+{
+    uint32_t key = GetPipelineKey(sceneInfo);
+
+    auto it = data.pipelines.find(key);
+    if (it != data.pipelines.end())
+        return it->second;
+
+    HE_PROFILE_FUNCTION();
+
+    auto& permutation = data.pipelines[key];
+
+    {
+        HE_PROFILE_SCOPE("CreateShaderLibrary");
+
+        std::string renderingMode = std::to_string(int(sceneInfo.settings.renderingMode));
+        std::vector<ShaderMake::ShaderConstant> defines = {
+            { "RENDERING_MODE", renderingMode.c_str() },
+            { "ENABLE_DEPTH_OF_FIELD", sceneInfo.view.enableDepthOfField ? "1" : "0" },
+            { "ENABLE_VISUAL_FOCUS_DISTANCE", sceneInfo.view.enableVisualFocusDistance ? "1" : "0" },
+        };
+
+        permutation.shaderLibrary = HE::RHI::CreateShaderLibrary(data.device, STATIC_SHADER(Main), &defines);
+        HE_VERIFY(permutation.shaderLibrary);
+    }
+
+    {
+        HE_PROFILE_SCOPE("createRayTracingPipeline");
+
+        nvrhi::rt::PipelineDesc pipelineDesc;
+        pipelineDesc.globalBindingLayouts = { data.bindingLayout, data.bindlessLayout };
+        pipelineDesc.shaders = {
+            { "", permutation.shaderLibrary->getShader("RayGen", nvrhi::ShaderType::RayGeneration), nullptr },
+            { "", permutation.shaderLibrary->getShader("Miss", nvrhi::ShaderType::Miss), nullptr }
+        };
+
+        pipelineDesc.hitGroups = { {
+            "HitGroup",
+            permutation.shaderLibrary->getShader("ClosestHit", nvrhi::ShaderType::ClosestHit),
+            permutation.shaderLibrary->getShader("AnyHit", nvrhi::ShaderType::AnyHit),
+            nullptr,
+            nullptr,
+            false
+        } };
+
+        pipelineDesc.maxPayloadSize = sizeof(RayPayload);
+        permutation.pipeline = data.device->createRayTracingPipeline(pipelineDesc);
+        HE_VERIFY(permutation.pipeline);
+
+        permutation.shaderTable = permutation.pipeline->createShaderTable();
+        permutation.shaderTable->setRayGenerationShader("RayGen");
+        permutation.shaderTable->addMissShader("Miss");
+        permutation.shaderTable->addHitGroup("HitGroup");
+    }
+
+    return permutation;
+}
+
+static HRay::WavefrontPipeline& GetWavefrontPipeline(HRay::RendererData& data)
+{
+    auto& wavefront = data.wavefront;
+    if (wavefront.pipeline)
+        return wavefront;
+
+    HE_PROFILE_FUNCTION();
+
+    {
+        HE_PROFILE_SCOPE("CreateShaderLibrary");
+
+        wavefront.shaderLibrary = HE::RHI::CreateShaderLibrary(data.device, STATIC_SHADER(Wavefront), nullptr);
+        HE_VERIFY(wavefront.shaderLibrary);
+    }
+
+    {
+        HE_PROFILE_SCOPE("createRayTracingPipeline");
+
+        nvrhi::rt::PipelineDesc pipelineDesc;
+        pipelineDesc.globalBindingLayouts = { data.wavefrontBindingLayout, data.bindlessLayout };
+
+        for (const char* stage : c_WavefrontStageNames)
+            pipelineDesc.shaders.push_back({ "", wavefront.shaderLibrary->getShader(stage, nvrhi::ShaderType::RayGeneration), nullptr });
+        pipelineDesc.shaders.push_back({ "", wavefront.shaderLibrary->getShader("Miss", nvrhi::ShaderType::Miss), nullptr });
+
+        pipelineDesc.hitGroups = { {
+            "HitGroup",
+            wavefront.shaderLibrary->getShader("ClosestHit", nvrhi::ShaderType::ClosestHit),
+            wavefront.shaderLibrary->getShader("AnyHit", nvrhi::ShaderType::AnyHit),
+            nullptr,
+            nullptr,
+            false
+        } };
+
+        pipelineDesc.maxPayloadSize = sizeof(RayPayload);
+        wavefront.pipeline = data.device->createRayTracingPipeline(pipelineDesc);
+        HE_VERIFY(wavefront.pipeline);
+
+        for (size_t i = 0; i < c_WavefrontStageNames.size(); i++)
+        {
+            auto& shaderTable = wavefront.shaderTables[i];
+            shaderTable = wavefront.pipeline->createShaderTable();
+            shaderTable->setRayGenerationShader(c_WavefrontStageNames[i]);
+            shaderTable->addMissShader("Miss");
+            shaderTable->addHitGroup("HitGroup");
+        }
+    }
+
+    {
+        HE_PROFILE_SCOPE("createComputePipeline");
+
+        nvrhi::ShaderDesc desc;
+        desc.shaderType = nvrhi::ShaderType::Compute;
+        desc.entryName = "Main";
+        wavefront.scanShader = HE::RHI::CreateStaticShader(data.device, STATIC_SHADER(WavefrontScan_Main), nullptr, desc);
+        HE_VERIFY(wavefront.scanShader);
+
+        nvrhi::BindingLayoutDesc layoutDesc;
+        layoutDesc.visibility = nvrhi::ShaderType::Compute;
+        layoutDesc.bindings = {
+            nvrhi::BindingLayoutItem::PushConstants(0, sizeof(WavefrontScanConstants)),
+            nvrhi::BindingLayoutItem::StructuredBuffer_UAV(0),
+            nvrhi::BindingLayoutItem::StructuredBuffer_UAV(1)
+        };
+
+        wavefront.scanBindingLayout = data.device->createBindingLayout(layoutDesc);
+        HE_VERIFY(wavefront.scanBindingLayout);
+
+        nvrhi::ComputePipelineDesc pipelineDesc;
+        pipelineDesc.bindingLayouts = { wavefront.scanBindingLayout };
+        pipelineDesc.CS = wavefront.scanShader;
+        wavefront.scanPipeline = data.device->createComputePipeline(pipelineDesc);
+        HE_VERIFY(wavefront.scanPipeline);
+    }
+
+    return wavefront;
+}
+
+static nvrhi::BindingSetDesc GetBindingSetDesc(HRay::RendererData& data, HRay::FrameData& frameData, uint32_t current)
+{
+    HE_ASSERT(frameData.topLevelAS);
+    HE_ASSERT(frameData.instanceBuffer);
+    HE_ASSERT(frameData.geometryBuffer);
+    HE_ASSERT(frameData.materialBuffer);
+    HE_ASSERT(frameData.directionalLightBuffer);
+    HE_ASSERT(frameData.accumulation[0]);
+    HE_ASSERT(frameData.accumulation[1]);
+    HE_ASSERT(frameData.LDRColor);
+    HE_ASSERT(frameData.sceneInfoBuffer);
+
+    nvrhi::BindingSetDesc bindingSetDesc;
+    bindingSetDesc.bindings = {
+        nvrhi::BindingSetItem::RayTracingAccelStruct(0, frameData.topLevelAS),
+        nvrhi::BindingSetItem::StructuredBuffer_SRV(1, frameData.instanceBuffer),
+        nvrhi::BindingSetItem::StructuredBuffer_SRV(2, frameData.geometryBuffer),
+        nvrhi::BindingSetItem::StructuredBuffer_SRV(3, frameData.materialBuffer),
+        nvrhi::BindingSetItem::StructuredBuffer_SRV(4, frameData.directionalLightBuffer),
+        nvrhi::BindingSetItem::StructuredBuffer_SRV(5, data.sobolMatrices),
+        nvrhi::BindingSetItem::StructuredBuffer_SRV(6, data.blueNoise),
+        nvrhi::BindingSetItem::Texture_UAV(0, frameData.accumulation[current]),
+        nvrhi::BindingSetItem::Texture_UAV(1, frameData.accumulation[current ^ 1]),
+        nvrhi::BindingSetItem::Texture_UAV(2, frameData.LDRColor),
+        nvrhi::BindingSetItem::Texture_UAV(3, frameData.depth ? frameData.depth : data.placeholderDepth),
+        nvrhi::BindingSetItem::Texture_UAV(4, frameData.entitiesID ? frameData.entitiesID : data.placeholderEntitiesID),
+        nvrhi::BindingSetItem::Texture_UAV(5, frameData.accumulationError ? frameData.accumulationError : data.placeholderAccumulationError),
+        nvrhi::BindingSetItem::StructuredBuffer_UAV(13, data.textureStreaming.feedback),
+        nvrhi::BindingSetItem::Sampler(0, data.anisotropicWrapSampler),
+        nvrhi::BindingSetItem::ConstantBuffer(0, frameData.sceneInfoBuffer),
+    };
+
+    return bindingSetDesc;
+}
+
+// Runs the stages of Wavefront.hlsl. There is no indirect dispatch : every stage is dispatched over the full
+// path count and the threads past the size of their queue return, so late bounces cost a dispatch each but little work
+static void DispatchWavefront(HRay::RendererData& data, HRay::FrameData& frameData, nvrhi::ICommandList* commandList, uint32_t width, uint32_t height)
+{
+    HE_PROFILE_FUNCTION();
+
+    auto& pipeline = GetWavefrontPipeline(data);
+    auto& wavefront = frameData.wavefront;
+
+    uint32_t pathCount = width * height;
+    if (wavefront.pathCount != pathCount || wavefront.materialCapacity < frameData.materialData.size())
+        CreateOrResizeWavefrontBuffers(data, frameData, commandList, pathCount);
+
+    uint32_t current = frameData.accumulationIndex;
+    auto& bindingSet = wavefront.bindingSets[current];
+    if (!bindingSet)
+    {
+        HE_PROFILE_SCOPE("CreateBindingSet");
+
+        nvrhi::BindingSetDesc bindingSetDesc = GetBindingSetDesc(data, frameData, current);
+        bindingSetDesc.bindings.push_back(nvrhi::BindingSetItem::StructuredBuffer_UAV(6, wavefront.paths));
+        bindingSetDesc.bindings.push_back(nvrhi::BindingSetItem::StructuredBuffer_UAV(7, wavefront.rayQueues));
+        bindingSetDesc.bindings.push_back(nvrhi::BindingSetItem::StructuredBuffer_UAV(8, wavefront.hits));
+        bindingSetDesc.bindings.push_back(nvrhi::BindingSetItem::StructuredBuffer_UAV(9, wavefront.sortedHits));
+        bindingSetDesc.bindings.push_back(nvrhi::BindingSetItem::StructuredBuffer_UAV(10, wavefront.radianceSum));
+        bindingSetDesc.bindings.push_back(nvrhi::BindingSetItem::StructuredBuffer_UAV(11, wavefront.counters));
+        bindingSetDesc.bindings.push_back(nvrhi::BindingSetItem::StructuredBuffer_UAV(12, wavefront.materialBins));
+        bindingSetDesc.bindings.push_back(nvrhi::BindingSetItem::PushConstants(1, sizeof(WavefrontConstants)));
+
+        bindingSet = data.device->createBindingSet(bindingSetDesc, data.wavefrontBindingLayout);
+    }
+
+    if (!wavefront.scanBindingSet)
+    {
+        nvrhi::BindingSetDesc bindingSetDesc;
+        bindingSetDesc.bindings = {
+            nvrhi::BindingSetItem::PushConstants(0, sizeof(WavefrontScanConstants)),
+            nvrhi::BindingSetItem::StructuredBuffer_UAV(0, wavefront.counters),
+            nvrhi::BindingSetItem::StructuredBuffer_UAV(1, wavefront.materialBins)
+        };
+
+        wavefront.scanBindingSet = data.device->createBindingSet(bindingSetDesc, pipeline.scanBindingLayout);
+    }
+
+    WavefrontConstants constants = {};
+    constants.materialCount = frameData.materialCount;
+    constants.targetWidth = width;
+
+    auto dispatch = [&](WavefrontStage stage, uint32_t dispatchWidth, uint32_t dispatchHeight) {
+
+        nvrhi::rt::State state;
+        state.shaderTable = pipeline.shaderTables[uint32_t(stage)];
+        state.bindings = { bindingSet, data.descriptorTable->GetDescriptorTable() };
+        commandList->setRayTracingState(state);
+        commandList->setPushConstants(&constants, sizeof(WavefrontConstants));
+
+        nvrhi::rt::DispatchRaysArguments args;
+        args.width = dispatchWidth;
+        args.height = dispatchHeight;
+        commandList->dispatchRays(args);
+    };
+
+    // one group, the material count is small next to the path count but may exceed a group
+    auto scan = [&]() {
+
+        nvrhi::ComputeState state;
+        state.pipeline = pipeline.scanPipeline;
+        state.bindings = { wavefront.scanBindingSet };
+        commandList->setComputeState(state);
+
+        WavefrontScanConstants scanConstants = { constants.bounce, constants.materialCount };
+        commandList->setPushConstants(&scanConstants, sizeof(WavefrontScanConstants));
+        commandList->dispatch(1);
+    };
+
+    const auto& settings = frameData.sceneInfo.settings;
+    for (int i = 0; i < settings.maxSamples; i++)
+    {
+        constants.sampleIndex = i;
+        constants.bounce = 0;
+        dispatch(WavefrontStage::Generate, width, height);
+
+        for (int bounce = 0; bounce < settings.maxLighteBounces; bounce++)
+        {
+            constants.bounce = bounce;
+            dispatch(WavefrontStage::Extend, width, height);
+            dispatch(WavefrontStage::Count, width, height);
+            scan();
+            dispatch(WavefrontStage::Scatter, width, height);
+            dispatch(WavefrontStage::Shade, width, height);
+        }
+    }
+
+    dispatch(WavefrontStage::Resolve, width, height);
 }
 
 void HRay::Init(RendererData& data, nvrhi::DeviceHandle pDevice, nvrhi::CommandListHandle commandList)
@@ -234,7 +910,7 @@ void HRay::Init(RendererData& data, nvrhi::DeviceHandle pDevice, nvrhi::CommandL
         nvrhi::BindlessLayoutDesc bindlessLayoutDesc;
         bindlessLayoutDesc.visibility = nvrhi::ShaderType::All;
         bindlessLayoutDesc.firstSlot = 0;
-        bindlessLayoutDesc.maxCapacity = 1024;
+        bindlessLayoutDesc.maxCapacity = c_DescriptorTableCapacity;
         bindlessLayoutDesc.registerSpaces = {
             nvrhi::BindingLayoutItem::RawBuffer_SRV(1),
             nvrhi::BindingLayoutItem::Texture_SRV(2)
@@ -243,16 +919,6 @@ void HRay::Init(RendererData& data, nvrhi::DeviceHandle pDevice, nvrhi::CommandL
         data.descriptorTable = HE::CreateRef<Assets::DescriptorTableManager>(data.device, data.bindlessLayout);
     }
 
-    // Shaders
-    {
-        {
-            HE_PROFILE_SCOPE("CreateShaderLibrary");
-
-            data.shaderLibrary = HE::RHI::CreateShaderLibrary(data.device, STATIC_SHADER(Main), nullptr);
-            HE_VERIFY(data.shaderLibrary);
-        }
-    }
-
     // Samplers
     {
         HE_PROFILE_SCOPE("create Samplers");
@@ -267,6 +933,97 @@ void HRay::Init(RendererData& data, nvrhi::DeviceHandle pDevice, nvrhi::CommandL
         HE_VERIFY(data.anisotropicWrapSampler);
     }
 
+    // Sampler tables
+    {
+        HE_PROFILE_SCOPE("Create Sampler Tables");
+
+        auto sobolMatrices = GenerateSobolMatrices();
+        auto blueNoise = GenerateBlueNoise(c_BlueNoiseSize);
+
+        nvrhi::BufferDesc bufferDesc;
+        bufferDesc.structStride = sizeof(uint32_t);
+        bufferDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+        bufferDesc.keepInitialState = true;
+
+        bufferDesc.byteSize = sobolMatrices.size() * sizeof(uint32_t);
+        bufferDesc.debugName = "SobolMatrices";
+        data.sobolMatrices = data.device->createBuffer(bufferDesc);
+        HE_VERIFY(data.sobolMatrices);
+
+        bufferDesc.byteSize = blueNoise.size() * sizeof(float);
+        bufferDesc.debugName = "BlueNoise";
+        data.blueNoise = data.device->createBuffer(bufferDesc);
+        HE_VERIFY(data.blueNoise);
+
+        auto cl = data.device->createCommandList();
+        cl->open();
+        cl->writeBuffer(data.sobolMatrices, sobolMatrices.data(), sobolMatrices.size() * sizeof(uint32_t));
+        cl->writeBuffer(data.blueNoise, blueNoise.data(), blueNoise.size() * sizeof(float));
+        cl->close();
+        data.device->executeCommandList(cl);
+    }
+
+    // Placeholder Targets
+    {
+        HE_PROFILE_SCOPE("Create Placeholder Targets");
+
+        nvrhi::TextureDesc desc;
+        desc.width = 1;
+        desc.height = 1;
+        desc.initialState = nvrhi::ResourceStates::UnorderedAccess;
+        desc.keepInitialState = true;
+        desc.isUAV = true;
+
+        desc.format = nvrhi::Format::D32;
+        desc.debugName = "PlaceholderDepth";
+        data.placeholderDepth = data.device->createTexture(desc);
+        HE_VERIFY(data.placeholderDepth);
+
+        desc.format = nvrhi::Format::R32_UINT;
+        desc.debugName = "PlaceholderEntitiesID";
+        data.placeholderEntitiesID = data.device->createTexture(desc);
+        HE_VERIFY(data.placeholderEntitiesID);
+
+        desc.format = nvrhi::Format::RGBA32_FLOAT;
+        desc.debugName = "PlaceholderAccumulationError";
+        data.placeholderAccumulationError = data.device->createTexture(desc);
+        HE_VERIFY(data.placeholderAccumulationError);
+    }
+
+    // Texture Feedback
+    {
+        HE_PROFILE_SCOPE("Create Texture Feedback Buffers");
+
+        auto& streaming = data.textureStreaming;
+
+        nvrhi::BufferDesc desc;
+        desc.byteSize = c_TextureFeedbackCapacity * sizeof(uint32_t);
+        desc.structStride = sizeof(uint32_t);
+        desc.canHaveUAVs = true;
+        desc.initialState = nvrhi::ResourceStates::UnorderedAccess;
+        desc.keepInitialState = true;
+        desc.debugName = "TextureFeedback";
+        streaming.feedback = data.device->createBuffer(desc);
+        HE_VERIFY(streaming.feedback);
+
+        desc.structStride = 0;
+        desc.canHaveUAVs = false;
+        desc.cpuAccess = nvrhi::CpuAccessMode::Read;
+        desc.initialState = nvrhi::ResourceStates::CopyDest;
+        desc.debugName = "TextureFeedbackReadback";
+        for (auto& readback : streaming.readback)
+        {
+            readback = data.device->createBuffer(desc);
+            HE_VERIFY(readback);
+        }
+
+        auto cl = data.device->createCommandList();
+        cl->open();
+        cl->clearBufferUInt(streaming.feedback, c_Invalid);
+        cl->close();
+        data.device->executeCommandList(cl);
+    }
+
     // Global Binding Layout
     {
         HE_PROFILE_SCOPE("createBindingLayout");
@@ -279,57 +1036,43 @@ void HRay::Init(RendererData& data, nvrhi::DeviceHandle pDevice, nvrhi::CommandL
            nvrhi::BindingLayoutItem::StructuredBuffer_SRV(2),
            nvrhi::BindingLayoutItem::StructuredBuffer_SRV(3),
            nvrhi::BindingLayoutItem::StructuredBuffer_SRV(4),
+           nvrhi::BindingLayoutItem::StructuredBuffer_SRV(5),
+           nvrhi::BindingLayoutItem::StructuredBuffer_SRV(6),
            nvrhi::BindingLayoutItem::Texture_UAV(0),
            nvrhi::BindingLayoutItem::Texture_UAV(1),
            nvrhi::BindingLayoutItem::Texture_UAV(2),
            nvrhi::BindingLayoutItem::Texture_UAV(3),
            nvrhi::BindingLayoutItem::Texture_UAV(4),
+           nvrhi::BindingLayoutItem::Texture_UAV(5),
+           nvrhi::BindingLayoutItem::StructuredBuffer_UAV(13),
            nvrhi::BindingLayoutItem::Sampler(0),
            nvrhi::BindingLayoutItem::VolatileConstantBuffer(0)
         };
 
         data.bindingLayout = data.device->createBindingLayout(desc);
         HE_ASSERT(data.bindingLayout);
-    }
-
-    // Pipeline
-    {
-        HE_PROFILE_SCOPE("createRayTracingPipeline");
-
-        nvrhi::rt::PipelineDesc pipelineDesc;
-        pipelineDesc.globalBindingLayouts = { data.bindingLayout, data.bindlessLayout };
-        pipelineDesc.shaders = {
-            { "", data.shaderLibrary->getShader("RayGen", nvrhi::ShaderType::RayGeneration), nullptr },
-            { "", data.shaderLibrary->getShader("Miss", nvrhi::ShaderType::Miss), nullptr }
-        };
 
-        pipelineDesc.hitGroups = { {
-            "HitGroup",
-            data.shaderLibrary->getShader("ClosestHit", nvrhi::ShaderType::ClosestHit),
-            data.shaderLibrary->getShader("AnyHit", nvrhi::ShaderType::AnyHit),
-            nullptr,
-            nullptr,
-            false
-        } };
-
-        pipelineDesc.maxPayloadSize = sizeof(HitInfo);
-        data.pipeline = data.device->createRayTracingPipeline(pipelineDesc);
-        HE_VERIFY(data.pipeline);
-
-        data.shaderTable = data.pipeline->createShaderTable();
-        data.shaderTable->setRayGenerationShader("RayGen");
-        data.shaderTable->addMissShader("Miss");
-        data.shaderTable->addHitGroup("HitGroup");
+        desc.bindings.push_back(nvrhi::BindingLayoutItem::StructuredBuffer_UAV(6));
+        desc.bindings.push_back(nvrhi::BindingLayoutItem::StructuredBuffer_UAV(7));
+        desc.bindings.push_back(nvrhi::BindingLayoutItem::StructuredBuffer_UAV(8));
+        desc.bindings.push_back(nvrhi::BindingLayoutItem::StructuredBuffer_UAV(9));
+        desc.bindings.push_back(nvrhi::BindingLayoutItem::StructuredBuffer_UAV(10));
+        desc.bindings.push_back(nvrhi::BindingLayoutItem::StructuredBuffer_UAV(11));
+        desc.bindings.push_back(nvrhi::BindingLayoutItem::StructuredBuffer_UAV(12));
+        desc.bindings.push_back(nvrhi::BindingLayoutItem::PushConstants(1, sizeof(WavefrontConstants)));
+
+        data.wavefrontBindingLayout = data.device->createBindingLayout(desc);
+        HE_ASSERT(data.wavefrontBindingLayout);
     }
+
+    // the common configuration is created up front so that the first frame does not stall, the others on first use
+    GetPipeline(data, SceneInfo{});
 }
 
 void HRay::BeginScene(RendererData& data, FrameData& frameData)
 {
     HE_PROFILE_FUNCTION();
 
-    if (!frameData.HDRColor)
-        CreateOrResizeRenderTarget(data, frameData, 1920, 1080);
-
     if (!frameData.geometryBuffer)
         CreateOrResizeGeoBuffer(data, frameData, 1024);
 
@@ -354,6 +1097,9 @@ void HRay::BeginScene(RendererData& data, FrameData& frameData)
     frameData.instanceCount = 0;
     frameData.materialCount = 1; // 0 for DefaultMaterial
     frameData.sceneInfo.light.directionalLightCount = 0;
+    frameData.assets.clear();
+    frameData.stats = {};
+    frameData.statsResources.clear();
 
     {
         frameData.materials.clear();
@@ -397,94 +1143,202 @@ void HRay::EndScene(RendererData& data, FrameData& frameData, nvrhi::ICommandLis
         frameData.sceneInfo.view.viewSize = Math::float2(viewDesc.width, viewDesc.height);
         frameData.sceneInfo.view.viewSizeInv = 1.0f / frameData.sceneInfo.view.viewSize;
         frameData.sceneInfo.view.frameIndex = frameData.frameIndex;
+        frameData.sceneInfo.view.sampleOffset = frameData.sampleOffset;
+        frameData.sceneInfo.view.tileOffsetX = viewDesc.tileOffset.x;
+        frameData.sceneInfo.view.tileOffsetY = viewDesc.tileOffset.y;
         frameData.sceneInfo.view.halfWidth = halfWidth;
         frameData.sceneInfo.view.halfHeight = halfHeight;
         frameData.sceneInfo.view.focalCenter = viewDesc.cameraPosition + frameData.sceneInfo.view.front * frameData.sceneInfo.view.focusDistance;
         frameData.sceneInfo.view.fov = fov;
 
-        commandList->writeBuffer(frameData.sceneInfoBuffer, &frameData.sceneInfo, sizeof(SceneInfo));
+        WriteBuffer(frameData, commandList, frameData.sceneInfoBuffer, &frameData.sceneInfo, sizeof(SceneInfo));
     }
 
-    if ((viewDesc.width > 0 && viewDesc.height > 0) && (viewDesc.width != frameData.HDRColor->getDesc().width || viewDesc.height != frameData.HDRColor->getDesc().height))
-        CreateOrResizeRenderTarget(data, frameData, viewDesc.width, viewDesc.height);
+    bool tiled = viewDesc.tileSize.x > 0 && viewDesc.tileSize.y > 0;
+    uint32_t targetWidth = tiled ? viewDesc.tileSize.x : viewDesc.width;
+    uint32_t targetHeight = tiled ? viewDesc.tileSize.y : viewDesc.height;
+
+    if (targetWidth == 0 || targetHeight == 0)
+        return;
+
+    // targets are created lazily at the size of the view
+    bool resize = !frameData.accumulation[0] || targetWidth != frameData.accumulation[0]->getDesc().width || targetHeight != frameData.accumulation[0]->getDesc().height;
+    bool targetsChanged = frameData.enableDepthAndIDTargets != bool(frameData.depth) || frameData.sceneInfo.settings.enableCompensatedSummation != bool(frameData.accumulationError);
+    if (resize || targetsChanged)
+        CreateOrResizeRenderTarget(data, frameData, targetWidth, targetHeight);
 
-    if (!frameData.bindingSet)
+    frameData.accumulationIndex ^= 1;
+    uint32_t current = frameData.accumulationIndex;
+
+    WriteBuffer(frameData, commandList, frameData.geometryBuffer, frameData.geometryData.data(), frameData.geometryCount * sizeof(GeometryData));
+    WriteBuffer(frameData, commandList, frameData.instanceBuffer, frameData.instanceData.data(), frameData.instanceCount * sizeof(InstanceData));
+    WriteBuffer(frameData, commandList, frameData.materialBuffer, frameData.materialData.data(), frameData.materialCount * sizeof(MaterialData));
+    WriteBuffer(frameData, commandList, frameData.directionalLightBuffer, frameData.directionalLightData.data(), frameData.sceneInfo.light.directionalLightCount * sizeof(DirectionalLightData));
+    commandList->buildTopLevelAccelStruct(frameData.topLevelAS, frameData.instances.data(), frameData.instanceCount, nvrhi::rt::AccelStructBuildFlags::AllowEmptyInstances);
+
+    // Stats
     {
+        auto& stats = frameData.stats;
+        stats.instanceCount = frameData.instanceCount;
+        stats.geometryCount = frameData.geometryCount;
+        stats.materialCount = frameData.materialCount;
+        stats.directionalLightCount = frameData.sceneInfo.light.directionalLightCount;
+        stats.tlasBuildCount++;
+        stats.tlasBytes = data.device->getAccelStructMemoryRequirements(frameData.topLevelAS).size;
+        stats.descriptorCount = data.textureCount + data.bufferDescriptorCount;
+
+        for (nvrhi::IBuffer* buffer : { frameData.sceneInfoBuffer.Get(), frameData.geometryBuffer.Get(), frameData.instanceBuffer.Get(), frameData.materialBuffer.Get(), frameData.directionalLightBuffer.Get(),
+            frameData.wavefront.paths.Get(), frameData.wavefront.rayQueues.Get(), frameData.wavefront.hits.Get(), frameData.wavefront.sortedHits.Get(), frameData.wavefront.radianceSum.Get(),
+            frameData.wavefront.counters.Get(), frameData.wavefront.materialBins.Get() })
         {
-            HE_PROFILE_SCOPE("CreateBindingSet");
-
-            HE_ASSERT(frameData.topLevelAS);
-            HE_ASSERT(frameData.instanceBuffer);
-            HE_ASSERT(frameData.geometryBuffer);
-            HE_ASSERT(frameData.materialBuffer);
-            HE_ASSERT(frameData.directionalLightBuffer);
-            HE_ASSERT(frameData.HDRColor);
-            HE_ASSERT(frameData.accumulationOutput);
-            HE_ASSERT(frameData.LDRColor);
-            HE_ASSERT(frameData.depth);
-            HE_ASSERT(frameData.entitiesID);
-            HE_ASSERT(frameData.sceneInfoBuffer);
-
-            nvrhi::BindingSetDesc bindingSetDesc;
-            bindingSetDesc.bindings = {
-                nvrhi::BindingSetItem::RayTracingAccelStruct(0, frameData.topLevelAS),
-                nvrhi::BindingSetItem::StructuredBuffer_SRV(1, frameData.instanceBuffer),
-                nvrhi::BindingSetItem::StructuredBuffer_SRV(2, frameData.geometryBuffer),
-                nvrhi::BindingSetItem::StructuredBuffer_SRV(3, frameData.materialBuffer),
-                nvrhi::BindingSetItem::StructuredBuffer_SRV(4, frameData.directionalLightBuffer),
-                nvrhi::BindingSetItem::Texture_UAV(0, frameData.HDRColor),
-                nvrhi::BindingSetItem::Texture_UAV(1, frameData.accumulationOutput),
-                nvrhi::BindingSetItem::Texture_UAV(2, frameData.LDRColor),
-                nvrhi::BindingSetItem::Texture_UAV(3, frameData.depth),
-                nvrhi::BindingSetItem::Texture_UAV(4, frameData.entitiesID),
-                nvrhi::BindingSetItem::Sampler(0, data.anisotropicWrapSampler),
-                nvrhi::BindingSetItem::ConstantBuffer(0, frameData.sceneInfoBuffer),
-            };
+            if (buffer)
+                AddResourceBytes(frameData, buffer, stats.bufferBytes, buffer->getDesc().byteSize);
+        }
 
-            frameData.bindingSet = data.device->createBindingSet(bindingSetDesc, data.bindingLayout);
+        for (nvrhi::ITexture* texture : { frameData.accumulation[0].Get(), frameData.accumulation[1].Get(), frameData.accumulationError.Get(), frameData.LDRColor.Get(), frameData.depth.Get(), frameData.entitiesID.Get() })
+        {
+            if (texture)
+                AddResourceBytes(frameData, texture, stats.textureBytes, GetTextureBytes(texture->getDesc()));
         }
     }
 
-    commandList->writeBuffer(frameData.geometryBuffer, frameData.geometryData.data(), frameData.geometryCount * sizeof(GeometryData));
-    commandList->writeBuffer(frameData.instanceBuffer, frameData.instanceData.data(), frameData.instanceCount * sizeof(InstanceData));
-    commandList->writeBuffer(frameData.materialBuffer, frameData.materialData.data(), frameData.materialCount * sizeof(MaterialData));
-    commandList->writeBuffer(frameData.directionalLightBuffer, frameData.directionalLightData.data(), frameData.sceneInfo.light.directionalLightCount * sizeof(DirectionalLightData));
-    commandList->buildTopLevelAccelStruct(frameData.topLevelAS, frameData.instances.data(), frameData.instanceCount, nvrhi::rt::AccelStructBuildFlags::AllowEmptyInstances);
+    // the debug rendering modes end at the first hit, they gain nothing from the wavefront stages
+    if (frameData.integrator == IntegratorType::Wavefront && frameData.sceneInfo.settings.renderingMode == RenderingMode::PathTracing)
+    {
+        DispatchWavefront(data, frameData, commandList, targetWidth, targetHeight);
+    }
+    else
+    {
+        auto& bindingSet = frameData.bindingSets[current];
+        if (!bindingSet)
+        {
+            HE_PROFILE_SCOPE("CreateBindingSet");
 
-    nvrhi::rt::State state;
-    state.shaderTable = data.shaderTable;
-    state.bindings = { frameData.bindingSet, data.descriptorTable->GetDescriptorTable() };
-    commandList->setRayTracingState(state);
+            bindingSet = data.device->createBindingSet(GetBindingSetDesc(data, frameData, current), data.bindingLayout);
+        }
 
-    commandList->copyTexture(frameData.accumulationOutput, {}, frameData.HDRColor, {});
+        nvrhi::rt::State state;
+        state.shaderTable = GetPipeline(data, frameData.sceneInfo).shaderTable;
+        state.bindings = { bindingSet, data.descriptorTable->GetDescriptorTable() };
+        commandList->setRayTracingState(state);
 
-    nvrhi::rt::DispatchRaysArguments args;
-    args.width = viewDesc.width;
-    args.height = viewDesc.height;
-    commandList->dispatchRays(args);
+        nvrhi::rt::DispatchRaysArguments args;
+        args.width = targetWidth;
+        args.height = targetHeight;
+        commandList->dispatchRays(args);
+    }
+
+    CopyTextureFeedback(data, commandList);
 
     frameData.frameIndex += frameData.sceneInfo.settings.maxSamples;
     frameData.time = HE::Application::GetTime() - frameData.lastTime;
 }
 
-void HRay::SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset asset, Assets::Mesh& mesh, Math::float4x4 wt, uint32_t id, nvrhi::ICommandList* cl)
+// BLAS geometries of a mesh in order, Func(geometry, indexByteOffset, indexCount, flags). A classified geometry is
+// split into its opaque and its mixed triangles, its transparent triangles are left out
+template<typename Func>
+static void ForEachBLASGeometry(Assets::Mesh& mesh, const MeshSourceOpacity& opacity, Func&& func)
+{
+    for (auto& geometry : mesh.GetGeometrySpan())
+    {
+        uint64_t indexOffset = geometry.GetIndexRange().byteOffset;
+        auto it = opacity.geometries.find(indexOffset);
+
+        if (geometry.alfaMode == Assets::AlfaMode::Opaque)
+        {
+            func(geometry, indexOffset, geometry.indexCount, nvrhi::rt::GeometryFlags::Opaque);
+            continue;
+        }
+
+        // not classified yet, or fully transparent : a BLAS geometry needs triangles, AnyHit rejects them all
+        if (it == opacity.geometries.end() || it->second.opaqueCount + it->second.mixedCount == 0)
+        {
+            func(geometry, indexOffset, geometry.indexCount, nvrhi::rt::GeometryFlags::None);
+            continue;
+        }
+
+        const auto& split = it->second;
+        if (split.opaqueCount > 0)
+            func(geometry, indexOffset, split.opaqueCount * 3, nvrhi::rt::GeometryFlags::Opaque);
+
+        if (split.mixedCount > 0)
+            func(geometry, indexOffset + uint64_t(split.opaqueCount) * 3 * sizeof(uint32_t), split.mixedCount * 3, nvrhi::rt::GeometryFlags::None);
+    }
+}
+
+void HRay::SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset asset, Assets::Mesh& mesh, Math::float4x4 wt, uint32_t id, nvrhi::ICommandList* cl, uint32_t instanceMask)
 {
     auto meshSource = mesh.meshSource;
+    frameData.assets.insert(asset.GetHandle());
 
-    if (!asset.Has<MeshSourceBuffers, MeshSourceDescriptors>())
+    if (!asset.Has<MeshSourceBuffers, MeshSourceDescriptors, MeshSourceOpacity>())
     {
         asset.Add<MeshSourceBuffers>();
         asset.Add<MeshSourceDescriptors>();
+        asset.Add<MeshSourceOpacity>();
     }
 
     auto& buffers = asset.Get<MeshSourceBuffers>();
     auto& descriptors = asset.Get<MeshSourceDescriptors>();
+    auto& opacity = asset.Get<MeshSourceOpacity>();
 
     auto& indexBuffer = buffers.indexBuffer;
     auto& vertexBuffer = buffers.vertexBuffer;
     auto& indexBufferDescriptor = descriptors.indexBufferDescriptor;
     auto& vertexBufferDescriptor = descriptors.vertexBufferDescriptor;
 
+    // Opacity : classified once the material and its base texture are loaded, again when they change.
+    // The new triangle order needs a new index buffer and BLAS, the other meshes of the source keep their ranges
+    for (auto& geometry : mesh.GetGeometrySpan())
+    {
+        Assets::Material* material = data.am->GetAsset<Assets::Material>(geometry.materailHandle);
+        if (geometry.alfaMode == Assets::AlfaMode::Opaque || !material)
+            continue;
+
+        // AnyHit only tests the alpha of blended materials, the others are opaque whatever their texture
+        bool alphaTested = material->alfaMode == Assets::AlfaMode::Blend;
+        bool textured = alphaTested && data.am->IsAssetHandleValid(material->baseTextureHandle);
+        const AlphaMap* alphaMap = textured && data.alphaMaps.contains(material->baseTextureHandle) ? &data.alphaMaps.at(material->baseTextureHandle) : nullptr;
+        auto texCoordAttribute = (int)material->uvSet == 0 ? Assets::VertexAttribute::TexCoord0 : Assets::VertexAttribute::TexCoord1;
+
+        if ((textured && !alphaMap) || (alphaMap && !meshSource->HasAttribute(texCoordAttribute)))
+            continue;
+
+        uint64_t inputHash = 14695981039346656037ull;
+        Hash(inputHash, alphaTested);
+        Hash(inputHash, material->baseColor.a);
+        Hash(inputHash, material->alphaCutoff);
+        Hash(inputHash, material->uvSet);
+        Hash(inputHash, material->offset);
+        Hash(inputHash, material->rotation);
+        Hash(inputHash, material->scale);
+        Hash(inputHash, alphaMap ? alphaMap->sourceHash : 0ull);
+
+        uint64_t key = geometry.GetIndexRange().byteOffset;
+        if (opacity.geometries.contains(key) && opacity.geometries.at(key).inputHash == inputHash)
+            continue;
+
+        std::span<uint32_t> indices(meshSource->cpuIndexBuffer.data() + key / sizeof(uint32_t), geometry.indexCount);
+        std::span<const Math::float2> texcoords;
+        if (alphaMap)
+            texcoords = { reinterpret_cast<const Math::float2*>(meshSource->cpuVertexBuffer.data() + geometry.GetVertexRange(texCoordAttribute).byteOffset), geometry.vertexCount };
+
+        float baseAlpha = alphaTested ? material->baseColor.a : 1.0f;
+        GeometryOpacity& geometryOpacity = opacity.geometries[key];
+        geometryOpacity = ClassifyTriangles(indices, texcoords, Math::CreateMat3(material->offset, material->rotation, material->scale), alphaMap, baseAlpha, material->alphaCutoff);
+        geometryOpacity.inputHash = inputHash;
+
+        if (indexBufferDescriptor.IsValid())
+        {
+            data.descriptorTable->ReleaseDescriptor(indexBufferDescriptor.Get());
+            indexBufferDescriptor.Reset();
+            data.bufferDescriptorCount--;
+        }
+
+        indexBuffer = nullptr;
+        mesh.accelStruct = nullptr;
+    }
+
     // indexBuffer
     if (!indexBuffer)
     {
@@ -501,8 +1355,9 @@ void HRay::SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset as
         indexBuffer = data.device->createBuffer(bufferDesc);
 
         indexBufferDescriptor = data.descriptorTable->CreateDescriptorHandle(nvrhi::BindingSetItem::RawBuffer_SRV(0, indexBuffer));
+        data.bufferDescriptorCount++;
         cl->beginTrackingBufferState(indexBuffer, nvrhi::ResourceStates::Common);
-        cl->writeBuffer(indexBuffer, meshSource->cpuIndexBuffer.data(), meshSource->cpuIndexBuffer.size() * sizeof(uint32_t));
+        WriteBuffer(frameData, cl, indexBuffer, meshSource->cpuIndexBuffer.data(), meshSource->cpuIndexBuffer.size() * sizeof(uint32_t));
 
         nvrhi::ResourceStates state = nvrhi::ResourceStates::IndexBuffer | nvrhi::ResourceStates::ShaderResource | nvrhi::ResourceStates::AccelStructBuildInput;
 
@@ -510,53 +1365,86 @@ void HRay::SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset as
         cl->commitBarriers();
     }
 
+    // the quantization setting changed, the BLAS of the other meshes keep their own copy of the positions
+    if (vertexBuffer && (buffers.vertexLayout == VertexLayout::Quantized) != data.quantizeVertices)
+    {
+        if (vertexBufferDescriptor.IsValid())
+        {
+            data.descriptorTable->ReleaseDescriptor(vertexBufferDescriptor.Get());
+            vertexBufferDescriptor.Reset();
+            data.bufferDescriptorCount--;
+        }
+
+        vertexBuffer = nullptr;
+    }
+
     // vertexBuffer
     if (!vertexBuffer)
     {
         HE_PROFILE_SCOPE("Create VertexBuffer");
 
+        buffers.vertexLayout = VertexLayout::Float;
+        buffers.quantization = {};
+        if (data.quantizeVertices)
+        {
+            if (QuantizeVertices(*meshSource, data.positionTolerance, data.texCoordTolerance, buffers.quantization))
+                buffers.vertexLayout = VertexLayout::Quantized;
+            else
+                HE_INFO("HRay::SubmitMesh : {} kept as float, quantization error {} (position) {} (uv)", mesh.name, buffers.quantization.positionError, buffers.quantization.texCoordError);
+        }
+
+        bool quantized = buffers.vertexLayout == VertexLayout::Quantized;
+
         nvrhi::BufferDesc bufferDesc;
         bufferDesc.isVertexBuffer = true;
         bufferDesc.debugName = "VertexBuffer";
         bufferDesc.canHaveTypedViews = true;
         bufferDesc.canHaveRawViews = true;
-        bufferDesc.isAccelStructBuildInput = true;
-        bufferDesc.byteSize = meshSource->cpuVertexBuffer.size();
+        bufferDesc.isAccelStructBuildInput = !quantized;
+        bufferDesc.byteSize = quantized ? buffers.quantization.data.size() : meshSource->cpuVertexBuffer.size();
         vertexBuffer = data.device->createBuffer(bufferDesc);
 
         vertexBufferDescriptor = data.descriptorTable->CreateDescriptorHandle(nvrhi::BindingSetItem::RawBuffer_SRV(0, vertexBuffer));
+        data.bufferDescriptorCount++;
         cl->beginTrackingBufferState(vertexBuffer, nvrhi::ResourceStates::Common);
-        if (meshSource->HasAttribute(Assets::VertexAttribute::Position))
+        if (quantized)
+        {
+            WriteBuffer(frameData, cl, vertexBuffer, buffers.quantization.data.data(), buffers.quantization.data.size());
+            buffers.quantization.data = {};
+        }
+        else if (meshSource->HasAttribute(Assets::VertexAttribute::Position))
         {
             const auto& range = meshSource->getVertexBufferRange(Assets::VertexAttribute::Position);
-            cl->writeBuffer(vertexBuffer, meshSource->GetAttribute<Math::float3>(Assets::VertexAttribute::Position), range.byteSize, range.byteOffset);
+            WriteBuffer(frameData, cl, vertexBuffer, meshSource->GetAttribute<Math::float3>(Assets::VertexAttribute::Position), range.byteSize, range.byteOffset);
         }
 
         if (meshSource->HasAttribute(Assets::VertexAttribute::Normal))
         {
             const auto& range = meshSource->getVertexBufferRange(Assets::VertexAttribute::Normal);
-            cl->writeBuffer(vertexBuffer, meshSource->GetAttribute<uint32_t>(Assets::VertexAttribute::Normal), range.byteSize, range.byteOffset);
+            WriteBuffer(frameData, cl, vertexBuffer, meshSource->GetAttribute<uint32_t>(Assets::VertexAttribute::Normal), range.byteSize, range.byteOffset);
         }
 
         if (meshSource->HasAttribute(Assets::VertexAttribute::Tangent))
         {
             const auto& range = meshSource->getVertexBufferRange(Assets::VertexAttribute::Tangent);
-            cl->writeBuffer(vertexBuffer, meshSource->GetAttribute<uint32_t>(Assets::VertexAttribute::Tangent), range.byteSize, range.byteOffset);
+            WriteBuffer(frameData, cl, vertexBuffer, meshSource->GetAttribute<uint32_t>(Assets::VertexAttribute::Tangent), range.byteSize, range.byteOffset);
         }
 
         if (meshSource->HasAttribute(Assets::VertexAttribute::TexCoord0))
         {
             const auto& range = meshSource->getVertexBufferRange(Assets::VertexAttribute::TexCoord0);
-            cl->writeBuffer(vertexBuffer, meshSource->GetAttribute<Math::float2>(Assets::VertexAttribute::TexCoord0), range.byteSize, range.byteOffset);
+            WriteBuffer(frameData, cl, vertexBuffer, meshSource->GetAttribute<Math::float2>(Assets::VertexAttribute::TexCoord0), range.byteSize, range.byteOffset);
         }
 
         if (meshSource->HasAttribute(Assets::VertexAttribute::TexCoord1))
         {
             const auto& range = meshSource->getVertexBufferRange(Assets::VertexAttribute::TexCoord1);
-            cl->writeBuffer(vertexBuffer, meshSource->GetAttribute<Math::float2>(Assets::VertexAttribute::TexCoord1), range.byteSize, range.byteOffset);
+            WriteBuffer(frameData, cl, vertexBuffer, meshSource->GetAttribute<Math::float2>(Assets::VertexAttribute::TexCoord1), range.byteSize, range.byteOffset);
         }
 
-        nvrhi::ResourceStates state = nvrhi::ResourceStates::VertexBuffer | nvrhi::ResourceStates::ShaderResource | nvrhi::ResourceStates::AccelStructBuildInput;
+        nvrhi::ResourceStates state = nvrhi::ResourceStates::VertexBuffer | nvrhi::ResourceStates::ShaderResource;
+        if (!quantized)
+            state = state | nvrhi::ResourceStates::AccelStructBuildInput;
 
         cl->setPermanentBufferState(vertexBuffer, state);
         cl->commitBarriers();
@@ -567,37 +1455,69 @@ void HRay::SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset as
     {
         HE_PROFILE_SCOPE("Create BLAS");
 
+        // the builder reads no 16 bit layout relative to bounds, quantized meshes build from their decoded positions.
+        // The buffer is referenced by the command list until the build completes
+        nvrhi::BufferHandle blasVertexBuffer = vertexBuffer;
+        std::map<uint64_t, uint64_t> blasVertexOffsets; // by byte offset of the geometry positions in cpuVertexBuffer
+        if (buffers.vertexLayout == VertexLayout::Quantized)
+        {
+            std::vector<Math::float3> positions;
+            for (auto& geometry : mesh.GetGeometrySpan())
+            {
+                uint64_t byteOffset = geometry.GetVertexRange(Assets::VertexAttribute::Position).byteOffset;
+                if (blasVertexOffsets.contains(byteOffset))
+                    continue;
+
+                blasVertexOffsets[byteOffset] = positions.size() * sizeof(Math::float3);
+                std::span<const Math::float3> source(reinterpret_cast<const Math::float3*>(meshSource->cpuVertexBuffer.data() + byteOffset), geometry.vertexCount);
+                DecodePositions(buffers.quantization.bounds.at(byteOffset), source, positions);
+            }
+
+            nvrhi::BufferDesc bufferDesc;
+            bufferDesc.debugName = "BLASVertexBuffer";
+            bufferDesc.isAccelStructBuildInput = true;
+            bufferDesc.byteSize = std::max<uint64_t>(positions.size() * sizeof(Math::float3), sizeof(Math::float3));
+            blasVertexBuffer = data.device->createBuffer(bufferDesc);
+
+            cl->beginTrackingBufferState(blasVertexBuffer, nvrhi::ResourceStates::Common);
+            WriteBuffer(frameData, cl, blasVertexBuffer, positions.data(), positions.size() * sizeof(Math::float3));
+            cl->setBufferState(blasVertexBuffer, nvrhi::ResourceStates::AccelStructBuildInput);
+            cl->commitBarriers();
+        }
+
         nvrhi::rt::AccelStructDesc blasDesc;
         blasDesc.isTopLevel = false;
 
         blasDesc.bottomLevelGeometries.reserve(mesh.GetGeometrySpan().size());
-        for (auto& geometry : mesh.GetGeometrySpan())
-        {
+        ForEachBLASGeometry(mesh, opacity, [&](auto& geometry, uint64_t indexOffset, uint32_t indexCount, nvrhi::rt::GeometryFlags flags) {
+
             nvrhi::rt::GeometryDesc& geometryDesc = blasDesc.bottomLevelGeometries.emplace_back();
             auto& triangles = geometryDesc.geometryData.triangles;
             triangles.indexBuffer = indexBuffer;
-            triangles.indexOffset = geometry.GetIndexRange().byteOffset;
+            triangles.indexOffset = indexOffset;
             triangles.indexFormat = nvrhi::Format::R32_UINT;
-            triangles.indexCount = geometry.indexCount;
-            triangles.vertexBuffer = vertexBuffer;
-            triangles.vertexOffset = geometry.GetVertexRange(Assets::VertexAttribute::Position).byteOffset;
+            triangles.indexCount = indexCount;
+            uint64_t positionOffset = geometry.GetVertexRange(Assets::VertexAttribute::Position).byteOffset;
+            triangles.vertexBuffer = blasVertexBuffer;
+            triangles.vertexOffset = blasVertexOffsets.contains(positionOffset) ? blasVertexOffsets.at(positionOffset) : positionOffset;
             triangles.vertexFormat = nvrhi::Format::RGB32_FLOAT;
             triangles.vertexStride = Assets::GetVertexAttributeSize(Assets::VertexAttribute::Position);
             triangles.vertexCount = geometry.vertexCount;
             geometryDesc.geometryType = nvrhi::rt::GeometryType::Triangles;
-
-            switch (geometry.alfaMode)
-            {
-            case Assets::AlfaMode::Opaque: geometryDesc.flags = nvrhi::rt::GeometryFlags::Opaque; break;
-            case Assets::AlfaMode::Blend: geometryDesc.flags = nvrhi::rt::GeometryFlags::None; break;
-            case Assets::AlfaMode::Mask: geometryDesc.flags = nvrhi::rt::GeometryFlags::None; break;
-            }
-        }
+            geometryDesc.flags = flags;
+        });
 
         mesh.accelStruct = data.device->createAccelStruct(blasDesc);
         nvrhi::utils::BuildBottomLevelAccelStruct(cl, mesh.accelStruct, blasDesc);
+
+        frameData.stats.blasBuildCount++;
+        frameData.stats.blasBuildBytes += data.device->getAccelStructMemoryRequirements(mesh.accelStruct).size;
     }
 
+    AddResourceBytes(frameData, indexBuffer.Get(), frameData.stats.bufferBytes, indexBuffer->getDesc().byteSize);
+    AddResourceBytes(frameData, vertexBuffer.Get(), frameData.stats.bufferBytes, vertexBuffer->getDesc().byteSize);
+    AddResourceBytes(frameData, mesh.accelStruct.Get(), frameData.stats.blasBytes, data.device->getAccelStructMemoryRequirements(mesh.accelStruct).size);
+
     if (frameData.instanceData.size() <= frameData.instanceCount)
         CreateOrResizeInstanceBuffer(data, frameData, (uint32_t)frameData.instanceData.size() * 2);
 
@@ -607,7 +1527,7 @@ void HRay::SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset as
 
         HE_ASSERT(mesh.accelStruct);
         instanceDesc.bottomLevelAS = mesh.accelStruct;
-        instanceDesc.instanceMask = c_instanceMaskOpaque;
+        instanceDesc.instanceMask = instanceMask;
         instanceDesc.instanceID = frameData.instanceCount;
         //instanceDesc.instanceContributionToHitGroupIndex = ?; // TODO : What is it?
 
@@ -619,14 +1539,16 @@ void HRay::SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset as
     {
         InstanceData& idata = frameData.instanceData[frameData.instanceCount];
         idata.id = id;
-        idata.transform = wt;
+        idata.transform = Math::transpose(wt);
+        idata.normalMatrix = PackNormalMatrix(wt);
         idata.firstGeometryIndex = frameData.geometryCount;
     }
 
     // Geometry
     {
-        for (const auto& geometry : mesh.GetGeometrySpan())
-        {
+        // one entry per BLAS geometry, GeometryIndex() in the shaders indexes them
+        ForEachBLASGeometry(mesh, opacity, [&](auto& geometry, uint64_t indexOffset, uint32_t indexCount, nvrhi::rt::GeometryFlags) {
+
             if (frameData.geometryData.size() <= frameData.geometryCount)
                 CreateOrResizeGeoBuffer(data, frameData,(uint32_t)frameData.geometryData.size() * 2);
 
@@ -634,16 +1556,36 @@ void HRay::SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset as
                 CreateOrResizeMaterialBuffer(data, frameData,(uint32_t)frameData.materialData.size() * 2);
 
             GeometryData& gd = frameData.geometryData[frameData.geometryCount];
-            gd.indexBufferIndex = indexBufferDescriptor.IsValid() ? indexBufferDescriptor.Get() : c_Invalid;
-            gd.vertexBufferIndex = vertexBufferDescriptor.IsValid() ? vertexBufferDescriptor.Get() : c_Invalid;
-            gd.indexCount = geometry.indexCount;
-            gd.vertexCount = geometry.vertexCount;
-            gd.indexOffset = (uint32_t)geometry.GetIndexRange().byteOffset;
-            gd.positionOffset = meshSource->HasAttribute(Assets::VertexAttribute::Position) ? (uint32_t)geometry.GetVertexRange(Assets::VertexAttribute::Position).byteOffset : c_Invalid;
-            gd.normalOffset = meshSource->HasAttribute(Assets::VertexAttribute::Normal) ? (uint32_t)geometry.GetVertexRange(Assets::VertexAttribute::Normal).byteOffset : c_Invalid;
-            gd.tangentOffset = meshSource->HasAttribute(Assets::VertexAttribute::Tangent) ? (uint32_t)geometry.GetVertexRange(Assets::VertexAttribute::Tangent).byteOffset : c_Invalid;
-            gd.texCoord0Offset = meshSource->HasAttribute(Assets::VertexAttribute::TexCoord0) ? (uint32_t)geometry.GetVertexRange(Assets::VertexAttribute::TexCoord0).byteOffset : c_Invalid;
-            gd.texCoord1Offset = meshSource->HasAttribute(Assets::VertexAttribute::TexCoord1) ? (uint32_t)geometry.GetVertexRange(Assets::VertexAttribute::TexCoord1).byteOffset : c_Invalid;
+            HE_ASSERT(indexBufferDescriptor.Get() < 0xffff && vertexBufferDescriptor.Get() < 0xffff);
+            gd.bufferIndices = (indexBufferDescriptor.Get() & 0xffff) | (vertexBufferDescriptor.Get() << 16);
+            gd.indexCount = indexCount;
+            gd.indexOffset = (uint32_t)indexOffset;
+            gd.vertexLayout = buffers.vertexLayout;
+
+            auto attributeOffset = [&](Assets::VertexAttribute attribute) {
+
+                if (!meshSource->HasAttribute(attribute))
+                    return c_Invalid;
+
+                uint64_t byteOffset = geometry.GetVertexRange(attribute).byteOffset;
+                if (buffers.vertexLayout == VertexLayout::Quantized)
+                    byteOffset = GetQuantizedOffset(*meshSource, buffers.quantization, attribute, byteOffset);
+
+                return (uint32_t)byteOffset;
+            };
+
+            gd.positionOffset = attributeOffset(Assets::VertexAttribute::Position);
+            gd.normalOffset = attributeOffset(Assets::VertexAttribute::Normal);
+            gd.tangentOffset = attributeOffset(Assets::VertexAttribute::Tangent);
+            gd.texCoord0Offset = attributeOffset(Assets::VertexAttribute::TexCoord0);
+            gd.texCoord1Offset = attributeOffset(Assets::VertexAttribute::TexCoord1);
+
+            if (buffers.vertexLayout == VertexLayout::Quantized && meshSource->HasAttribute(Assets::VertexAttribute::Position))
+            {
+                const auto& bounds = buffers.quantization.bounds.at(geometry.GetVertexRange(Assets::VertexAttribute::Position).byteOffset);
+                gd.positionBias = bounds.bias;
+                gd.positionScale = bounds.scale;
+            }
 
             // materials
             if (frameData.materials.contains(geometry.materailHandle))
@@ -657,7 +1599,7 @@ void HRay::SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset as
             }
 
             frameData.geometryCount++;
-        }
+        });
     }
 
     frameData.instanceCount++;
@@ -681,6 +1623,7 @@ void HRay::SubmitMaterial(RendererData& data, FrameData& frameData, Assets::Asse
     if (baseTexture && baseTexture->texture && !baseTexture->descriptor.IsValid())
     {
         HE_ASSERT(baseTexture->texture);
+        CookTexture(data, material.baseTextureHandle, TextureKind::Color);
         baseTexture->descriptor = data.descriptorTable->CreateDescriptorHandle(nvrhi::BindingSetItem::Texture_SRV(0, baseTexture->texture));
         data.textureCount++;
     }
@@ -689,6 +1632,7 @@ void HRay::SubmitMaterial(RendererData& data, FrameData& frameData, Assets::Asse
     if (emissiveTexture && emissiveTexture->texture && !emissiveTexture->descriptor.IsValid())
     {
         HE_ASSERT(emissiveTexture->texture);
+        CookTexture(data, material.emissiveTextureHandle, TextureKind::Color);
         emissiveTexture->descriptor = data.descriptorTable->CreateDescriptorHandle(nvrhi::BindingSetItem::Texture_SRV(0, emissiveTexture->texture));
         data.textureCount++;
     }
@@ -697,6 +1641,7 @@ void HRay::SubmitMaterial(RendererData& data, FrameData& frameData, Assets::Asse
     if (metallicRoughnessTexture && metallicRoughnessTexture->texture && !metallicRoughnessTexture->descriptor.IsValid())
     {
         HE_ASSERT(metallicRoughnessTexture->texture);
+        CookTexture(data, material.metallicRoughnessTextureHandle, TextureKind::Color);
         metallicRoughnessTexture->descriptor = data.descriptorTable->CreateDescriptorHandle(nvrhi::BindingSetItem::Texture_SRV(0, metallicRoughnessTexture->texture));
         data.textureCount++;
     }
@@ -705,10 +1650,21 @@ void HRay::SubmitMaterial(RendererData& data, FrameData& frameData, Assets::Asse
     if (normalTexture && normalTexture->texture && !normalTexture->descriptor.IsValid())
     {
         HE_ASSERT(normalTexture->texture);
+        CookTexture(data, material.normalTextureHandle, TextureKind::Normal);
         normalTexture->descriptor = data.descriptorTable->CreateDescriptorHandle(nvrhi::BindingSetItem::Texture_SRV(0, normalTexture->texture));
         data.textureCount++;
     }
 
+    for (auto textureHandle : { material.baseTextureHandle, material.emissiveTextureHandle, material.metallicRoughnessTextureHandle, material.normalTextureHandle })
+        if (data.am->IsAssetHandleValid(textureHandle))
+            frameData.assets.insert(textureHandle);
+
+    for (Assets::Texture* texture : { baseTexture, emissiveTexture, metallicRoughnessTexture, normalTexture })
+    {
+        if (texture && texture->texture)
+            AddResourceBytes(frameData, texture->texture.Get(), frameData.stats.textureBytes, GetTextureBytes(texture->texture->getDesc()));
+    }
+
     uint32_t index = frameData.materials.at(handle);
     auto& mat = frameData.materialData[index];
 
@@ -766,18 +1722,14 @@ void HRay::SubmitSkyLight(RendererData& data, FrameData& frameData, Assets::SkyL
     if (!asset || asset.GetState() != Assets::AssetState::Loaded)
         return;
 
+    frameData.assets.insert(light.textureHandle);
+
     Assets::Texture* hdr = data.am->GetAsset<Assets::Texture>(light.textureHandle);
 
     auto width = hdr->texture->getDesc().width;
     auto height = hdr->texture->getDesc().height;
     frameData.sceneInfo.light.size = { width, height };
 
-    if (hdr && hdr->texture && !hdr->descriptor.IsValid())
-    {
-        hdr->descriptor = data.descriptorTable->CreateDescriptorHandle(nvrhi::BindingSetItem::Texture_SRV(0, hdr->texture));
-        data.textureCount++;
-    }
-
     if (light.totalSum == -1)
     {
         float* weights = new float[width * height];
@@ -824,21 +1776,227 @@ void HRay::SubmitSkyLight(RendererData& data, FrameData& frameData, Assets::SkyL
         delete[] cdf;
     }
 
+    // cooked once the CDF above has read the uncompressed texels
+    if (hdr && hdr->texture && !hdr->descriptor.IsValid())
+    {
+        CookTexture(data, light.textureHandle, TextureKind::HDR);
+        hdr->descriptor = data.descriptorTable->CreateDescriptorHandle(nvrhi::BindingSetItem::Texture_SRV(0, hdr->texture));
+        data.textureCount++;
+    }
+
+    if (hdr && hdr->texture)
+        AddResourceBytes(frameData, hdr->texture.Get(), frameData.stats.textureBytes, GetTextureBytes(hdr->texture->getDesc()));
+
     frameData.sceneInfo.light.totalSum = light.totalSum;
     frameData.sceneInfo.light.descriptorIndex = hdr ? hdr->descriptor.Get() : c_Invalid;
 }
 
+void HRay::WriteRendererStats(const RendererStats& stats, std::ostream& out)
+{
+    out << "{\n";
+    out << "\t\"instanceCount\" : " << stats.instanceCount << ",\n";
+    out << "\t\"geometryCount\" : " << stats.geometryCount << ",\n";
+    out << "\t\"materialCount\" : " << stats.materialCount << ",\n";
+    out << "\t\"directionalLightCount\" : " << stats.directionalLightCount << ",\n";
+    out << "\t\"uploadBytes\" : " << stats.uploadBytes << ",\n";
+    out << "\t\"blasBuildCount\" : " << stats.blasBuildCount << ",\n";
+    out << "\t\"blasBuildBytes\" : " << stats.blasBuildBytes << ",\n";
+    out << "\t\"tlasBuildCount\" : " << stats.tlasBuildCount << ",\n";
+    out << "\t\"tlasBytes\" : " << stats.tlasBytes << ",\n";
+    out << "\t\"blasBytes\" : " << stats.blasBytes << ",\n";
+    out << "\t\"bufferBytes\" : " << stats.bufferBytes << ",\n";
+    out << "\t\"textureBytes\" : " << stats.textureBytes << ",\n";
+    out << "\t\"descriptorCount\" : " << stats.descriptorCount << ",\n";
+    out << "\t\"descriptorCapacity\" : " << stats.descriptorCapacity << "\n";
+    out << "}\n";
+}
+
 void HRay::Clear(FrameData& frameData)
 {
     frameData.frameIndex = 0;
     frameData.lastTime = HE::Application::GetTime();
 }
 
+// Stable between sessions : the handle, the size and write time of the asset file and, for cooked textures,
+// the hash of the texels. Memory only assets have no file and are identified by their handle
+static uint64_t GetAssetStamp(HRay::RendererData& data, Assets::AssetHandle handle)
+{
+    uint64_t stamp = 14695981039346656037ull;
+    Hash(stamp, uint64_t(handle));
+
+    auto filePath = data.am->GetFilePath(handle);
+    if (!filePath.empty())
+    {
+        filePath = data.am->desc.assetsDirectory / filePath;
+
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(filePath, ec);
+        if (!ec)
+            Hash(stamp, size);
+
+        auto writeTime = std::filesystem::last_write_time(filePath, ec);
+        if (!ec)
+            Hash(stamp, writeTime.time_since_epoch().count());
+    }
+
+    if (data.textureHashes.contains(handle))
+        Hash(stamp, data.textureHashes.at(handle));
+
+    return stamp;
+}
+
+uint64_t HRay::ComputeSceneHash(RendererData& data, const FrameData& frameData, const ViewDesc& viewDesc)
+{
+    HE_PROFILE_FUNCTION();
+
+    uint64_t hash = 14695981039346656037ull;
+
+    Hash(hash, viewDesc.view);
+    Hash(hash, viewDesc.projection);
+    Hash(hash, viewDesc.fov);
+    Hash(hash, viewDesc.width);
+    Hash(hash, viewDesc.height);
+
+    // fields are hashed one by one, the padding in SceneInfo is never initialized
+    const auto& view = frameData.sceneInfo.view;
+    Hash(hash, view.minDistance);
+    Hash(hash, view.maxDistance);
+    Hash(hash, view.apertureRadius);
+    Hash(hash, view.focusFalloff);
+    Hash(hash, view.focusDistance);
+    Hash(hash, view.enableDepthOfField);
+    Hash(hash, view.enableVisualFocusDistance);
+
+    const auto& light = frameData.sceneInfo.light;
+    Hash(hash, light.groundColor);
+    Hash(hash, light.horizonSkyColor);
+    Hash(hash, light.zenithSkyColor);
+    Hash(hash, light.rotation);
+    Hash(hash, light.size);
+    Hash(hash, light.intensity);
+    Hash(hash, light.descriptorIndex != c_Invalid);
+    Hash(hash, light.directionalLightCount);
+    Hash(hash, light.enableEnvironmentLight);
+
+    const auto& settings = frameData.sceneInfo.settings;
+    Hash(hash, settings.maxLighteBounces);
+    Hash(hash, settings.maxSamples);
+    Hash(hash, settings.renderingMode);
+    Hash(hash, settings.samplerType);
+
+    for (uint32_t i = 0; i < frameData.instanceCount; i++)
+    {
+        Hash(hash, frameData.instanceData[i].firstGeometryIndex);
+        Hash(hash, frameData.instanceData[i].transform);
+        Hash(hash, uint32_t(frameData.instances[i].instanceMask));
+    }
+
+    // descriptor indices depend on load order, only the topology and material links are stable between sessions
+    for (uint32_t i = 0; i < frameData.geometryCount; i++)
+    {
+        Hash(hash, frameData.geometryData[i].indexCount);
+        Hash(hash, frameData.geometryData[i].positionOffset);
+        Hash(hash, frameData.geometryData[i].materialIndex);
+    }
+
+    for (uint32_t i = 0; i < frameData.materialCount; i++)
+    {
+        MaterialData material = frameData.materialData[i];
+        material.baseTextureIndex = material.baseTextureIndex != c_Invalid;
+        material.emissiveTextureIndex = material.emissiveTextureIndex != c_Invalid;
+        material.metallicRoughnessTextureIndex = material.metallicRoughnessTextureIndex != c_Invalid;
+        material.normalTextureIndex = material.normalTextureIndex != c_Invalid;
+        Hash(hash, material);
+    }
+
+    for (int i = 0; i < light.directionalLightCount; i++)
+        Hash(hash, frameData.directionalLightData[i]);
+
+    // the fields above miss edits of the asset content, a reimported mesh or a replaced texture
+    for (auto handle : frameData.assets)
+        Hash(hash, GetAssetStamp(data, handle));
+
+    return hash;
+}
+
+void HRay::ResumeAccumulation(RendererData& data, FrameData& frameData, nvrhi::ICommandList* commandList, uint32_t width, uint32_t height, const void* pixels, size_t rowPitch, uint32_t frameIndex)
+{
+    HE_PROFILE_FUNCTION();
+
+    if (!frameData.accumulation[0] || width != frameData.accumulation[0]->getDesc().width || height != frameData.accumulation[0]->getDesc().height)
+        CreateOrResizeRenderTarget(data, frameData, width, height);
+
+    // the next dispatch reads the previous sums from the target written last, the compensation terms start over
+    commandList->writeTexture(frameData.accumulation[frameData.accumulationIndex], 0, 0, pixels, rowPitch);
+    if (frameData.accumulationError)
+        commandList->clearTextureFloat(frameData.accumulationError, nvrhi::AllSubresources, nvrhi::Color(0.0f));
+    frameData.frameIndex = frameIndex;
+}
+
 nvrhi::ITexture* HRay::GetColorTarget(FrameData& frameData)
 {
     return frameData.LDRColor;
 }
 
+nvrhi::ITexture* HRay::GetHDRTarget(FrameData& frameData)
+{
+    return frameData.accumulation[frameData.accumulationIndex];
+}
+
+void HRay::ResolveAccumulation(Math::float4* pixels, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        float samples = pixels[i].w;
+        pixels[i] = samples > 0.0f ? Math::float4(Math::float3(pixels[i]) / samples, 1.0f) : Math::float4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+void HRay::AccumulateSample(Math::float3& sum, Math::float3& error, Math::float3 sampleSum, bool compensated)
+{
+    if (!compensated)
+    {
+        sum = sum + sampleSum;
+        return;
+    }
+
+    // same operations as the Kahan summation of Accumulate
+    Math::float3 y = sampleSum - error;
+    Math::float3 t = sum + y;
+    error = (t - sum) - y;
+    sum = t;
+}
+
+void HRay::BinHitsByMaterial(std::span<const uint32_t> hitMaterials, uint32_t materialCount, std::vector<uint32_t>& sortedHits)
+{
+    HE_PROFILE_FUNCTION();
+
+    // same passes as the Count and Scatter stages of Wavefront.hlsl around the scan of WavefrontScan.hlsl, misses
+    // (c_Invalid) are dropped. The order inside a bin is stable here while the GPU atomics leave it unspecified
+    std::vector<uint32_t> bins(size_t(materialCount) * 2, 0);
+
+    for (uint32_t materialIndex : hitMaterials)
+    {
+        if (materialIndex != c_Invalid)
+            bins[materialIndex]++;
+    }
+
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < materialCount; i++)
+    {
+        bins[materialCount + i] = offset;
+        offset += bins[i];
+    }
+
+    sortedHits.resize(offset);
+    for (uint32_t i = 0; i < hitMaterials.size(); i++)
+    {
+        uint32_t materialIndex = hitMaterials[i];
+        if (materialIndex != c_Invalid)
+            sortedHits[bins[materialCount + materialIndex]++] = i;
+    }
+}
+
 nvrhi::ITexture* HRay::GetDepthTarget(FrameData& frameData)
 {
     return frameData.depth;
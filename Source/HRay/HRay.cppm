@@ -12,8 +12,19 @@ import std;
 
 export namespace HRay {
 
-    constexpr uint32_t c_instanceMaskOpaque = 1;
+    // TLAS instance mask bits, one per ray class. Camera rays leave the eye, reflection rays leave a specular
+    // lobe and indirect rays any other lobe
+    constexpr uint32_t c_instanceMaskCamera = 1 << 0;
+    constexpr uint32_t c_instanceMaskIndirect = 1 << 1;
+    constexpr uint32_t c_instanceMaskReflection = 1 << 2;
+    constexpr uint32_t c_instanceMaskAll = c_instanceMaskCamera | c_instanceMaskIndirect | c_instanceMaskReflection;
     constexpr uint32_t c_Invalid = ~0u;
+    constexpr uint32_t c_SobolDimensions = 16;
+    constexpr uint32_t c_SobolBits = 32;
+    constexpr uint32_t c_BlueNoiseSize = 64;
+    constexpr uint32_t c_DescriptorTableCapacity = 1024; // bindless buffers and textures
+    constexpr uint32_t c_TextureFeedbackCapacity = 65536; // bindless indices covered by the texture feedback, see PathTracer.hlsli
+    constexpr nvrhi::Format c_ColorTargetFormat = nvrhi::Format::RGBA16_UNORM; // linear, gamma encoded on display and save
 
     enum class TonMapingType : int
     {
@@ -33,6 +44,31 @@ export namespace HRay {
         Bitangent
     };
 
+    enum class SamplerType : int
+    {
+        Random,
+        Sobol
+    };
+
+    enum class IntegratorType : int
+    {
+        Megakernel, // Main.hlsl, one thread traces a whole path
+        Wavefront   // Wavefront.hlsl, one dispatch per stage and bounce, path tracing only
+    };
+
+    enum class TextureKind : int
+    {
+        Color,  // BC7
+        Normal, // BC5, the shaders rebuild z from xy
+        HDR     // BC6H
+    };
+
+    enum class VertexLayout : uint32_t
+    {
+        Float,     // the vertex buffer of the mesh source as imported
+        Quantized  // positions as unorm16 of the geometry bounds and texture coordinates as half, see QuantizeVertices
+    };
+
     enum class AlfaMode : int
     {
         Opaque,
@@ -51,9 +87,9 @@ export namespace HRay {
             Math::float3 cameraPosition;
             uint32_t frameIndex;
 
-            Math::float3 front; int frontPadding;
-            Math::float3 up;    int upPadding;
-            Math::float3 right; int rightPadding;
+            Math::float3 front; uint32_t sampleOffset;
+            Math::float3 up;    uint32_t tileOffsetX;
+            Math::float3 right; uint32_t tileOffsetY;
 
             Math::float2 viewSize;
             Math::float2 viewSizeInv;
@@ -109,7 +145,11 @@ export namespace HRay {
             int maxLighteBounces = 8;
             int maxSamples = 1;
             RenderingMode renderingMode;
-            int padding0;
+            SamplerType samplerType = SamplerType::Sobol;
+
+            bool enableCompensatedSummation = false; // Kahan summation of the radiance sums, costs one more RGBA32F target
+            bool padding0[3];
+            Math::float3 padding1;
            
         } settings;
 
@@ -123,28 +163,34 @@ export namespace HRay {
         } postProssing;
     };
 
+    // mirrors GeometryData in PathTracer.hlsli, four 16 byte lines. The any-hit shader only reads the first two
     struct GeometryData
     {
-        Math::uint indexBufferIndex;
-        Math::uint vertexBufferIndex;
-
-        Math::uint indexCount;
-        Math::uint vertexCount;
-
+        Math::uint bufferIndices; // index buffer descriptor in the low 16 bits, vertex buffer descriptor in the high 16 bits
         Math::uint indexOffset;
+        Math::uint materialIndex = c_Invalid;
+        VertexLayout vertexLayout = VertexLayout::Float;
+
+        Math::uint texCoord0Offset;
+        Math::uint texCoord1Offset;
         Math::uint positionOffset;
         Math::uint normalOffset;
+
+        Math::float3 positionBias = { 0.0f, 0.0f, 0.0f }; // position = positionBias + q * positionScale
         Math::uint tangentOffset;
-        Math::uint texCoord0Offset;
-        Math::uint texCoord1Offset;
-        Math::uint materialIndex = c_Invalid;
+
+        Math::float3 positionScale = { 1.0f, 1.0f, 1.0f };
+        Math::uint indexCount;
     };
 
+    // mirrors InstanceData in PathTracer.hlsli, five 16 byte lines
     struct InstanceData
     {
+        Math::float3x4 transform; // object to world, rows of the column vector matrix like nvrhi::rt::InstanceDesc::transform
+        std::array<uint32_t, 5> normalMatrix; // halves, see PackNormalMatrix
         uint32_t id;
         Math::uint firstGeometryIndex;
-        Math::float4x4 transform;
+        uint32_t padding;
     };
 
     struct MaterialData
@@ -185,28 +231,180 @@ export namespace HRay {
         float haloFalloff;
     };
 
+    // One specialization of Main.hlsl, see shaders.cfg
+    struct PipelinePermutation
+    {
+        nvrhi::ShaderLibraryHandle shaderLibrary;
+        nvrhi::rt::PipelineHandle pipeline;
+        nvrhi::rt::ShaderTableHandle shaderTable;
+    };
+
+    // Wavefront.hlsl, one shader table per stage
+    struct WavefrontPipeline
+    {
+        nvrhi::ShaderLibraryHandle shaderLibrary;
+        nvrhi::rt::PipelineHandle pipeline;
+        std::array<nvrhi::rt::ShaderTableHandle, 6> shaderTables; // indexed by the stages of HRay.cpp
+        nvrhi::ShaderHandle scanShader; // WavefrontScan.hlsl
+        nvrhi::BindingLayoutHandle scanBindingLayout;
+        nvrhi::ComputePipelineHandle scanPipeline;
+    };
+
+    // Persistent queues of the wavefront integrator, sized by the target pixel count
+    struct WavefrontBuffers
+    {
+        std::array<nvrhi::BindingSetHandle, 2> bindingSets; // same ping-pong as FrameData::bindingSets
+        nvrhi::BindingSetHandle scanBindingSet;
+        nvrhi::BufferHandle paths;
+        nvrhi::BufferHandle rayQueues;
+        nvrhi::BufferHandle hits;
+        nvrhi::BufferHandle sortedHits;
+        nvrhi::BufferHandle radianceSum;
+        nvrhi::BufferHandle counters;
+        nvrhi::BufferHandle materialBins;
+        uint32_t pathCount = 0;
+        uint32_t materialCapacity = 0;
+    };
+
+    enum class TriangleOpacity : uint8_t
+    {
+        Opaque,
+        Mixed,
+        Transparent
+    };
+
+    // Alpha of a color texture at a reduced resolution, each cell holds the min and max alpha of the texels it covers
+    // and of its neighbours. Empty when the texture is fully opaque, see Opacity.cpp
+    struct AlphaMap
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> minAlpha;
+        std::vector<uint8_t> maxAlpha;
+        uint64_t sourceHash = 0; // of the texels, see CookTexture
+    };
+
+    // Triangles of an alpha tested geometry sorted opaque, mixed then transparent, the transparent ones are left out of the BLAS
+    struct GeometryOpacity
+    {
+        uint32_t opaqueCount = 0;
+        uint32_t mixedCount = 0;
+        uint64_t inputHash = 0; // material and alpha map the triangles were classified with
+    };
+
+    // Vertex streams of a mesh source in VertexLayout::Quantized. Normals and tangents are already snorm8 and copied as is
+    struct QuantizedVertices
+    {
+        struct Bounds
+        {
+            Math::float3 bias;
+            Math::float3 scale;
+        };
+
+        std::vector<uint8_t> data; // uploaded then released
+        std::map<Assets::VertexAttribute, uint64_t> offsets; // of each attribute stream in data
+        std::map<uint64_t, Bounds> bounds; // by byte offset of the geometry positions in cpuVertexBuffer
+        float positionError = 0.0f; // max, object space
+        float texCoordError = 0.0f;
+    };
+
+    // Cooked texture of which only the levels residentLevel to mipLevels - 1 are in VRAM, see Textures.cpp
+    struct StreamedTexture
+    {
+        nvrhi::Format format = nvrhi::Format::UNKNOWN;
+        uint32_t width = 0;     // size of level 0
+        uint32_t height = 0;
+        uint32_t mipLevels = 0;
+        uint32_t residentLevel = 0;
+        uint32_t requestedLevel = 0; // finest level asked for by the shaders
+        uint64_t lastRequestFrame = 0;
+
+        std::filesystem::path filePath; // cooked file the levels are read from
+        std::vector<uint64_t> levelOffsets;
+        std::vector<uint64_t> levelSizes;
+        std::vector<std::vector<uint8_t>> levels; // kept in memory when there is no texture cache
+    };
+
+    struct TextureStreaming
+    {
+        bool enable = true;  // disabled, every texture is fully resident
+        uint64_t budget = 2048ull << 20;
+        uint64_t residentBytes = 0;  // of the streamed textures
+        uint64_t frame = 0;
+        std::map<Assets::AssetHandle, StreamedTexture> textures;
+
+        nvrhi::BufferHandle feedback; // finest lod per bindless index, written by the shaders
+        std::array<nvrhi::BufferHandle, 3> readback;
+        std::array<uint64_t, 3> readbackFrame = {}; // frame of the copy held by each readback buffer, 0 once read
+        uint64_t lastCopyFrame = 0; // the feedback is copied once per frame whatever the number of EndScene calls
+    };
+
+    // Counters of the last BeginScene / EndScene of a FrameData. The VRAM fields cover the resources the frame references
+    struct RendererStats
+    {
+        uint32_t instanceCount = 0;
+        uint32_t geometryCount = 0; // BLAS geometries
+        uint32_t materialCount = 0;
+        uint32_t directionalLightCount = 0;
+
+        uint64_t uploadBytes = 0; // written through writeBuffer
+        uint32_t blasBuildCount = 0;
+        uint64_t blasBuildBytes = 0; // of the BLAS built this frame
+        uint32_t tlasBuildCount = 0;
+        uint64_t tlasBytes = 0;
+
+        uint64_t blasBytes = 0;
+        uint64_t bufferBytes = 0;  // mesh, scene and wavefront buffers
+        uint64_t textureBytes = 0; // material and environment textures, render targets
+
+        uint32_t descriptorCount = 0; // allocated in the descriptor table
+        uint32_t descriptorCapacity = c_DescriptorTableCapacity;
+    };
+
     struct RendererData
     {
         Assets::AssetManager* am;
         nvrhi::DeviceHandle device;
-        nvrhi::ShaderLibraryHandle shaderLibrary;
         nvrhi::BindingLayoutHandle bindingLayout;
+        nvrhi::BindingLayoutHandle wavefrontBindingLayout; // bindingLayout followed by the wavefront queues
         nvrhi::SamplerHandle anisotropicWrapSampler;
-        nvrhi::rt::PipelineHandle pipeline;
-        nvrhi::rt::ShaderTableHandle shaderTable;
+        std::map<uint32_t, PipelinePermutation> pipelines; // created on first use, keyed by rendering mode and view features
+        WavefrontPipeline wavefront; // created on first use
         HE::Ref<Assets::DescriptorTableManager> descriptorTable;
         nvrhi::BindingLayoutHandle bindlessLayout;
+        nvrhi::BufferHandle sobolMatrices;
+        nvrhi::BufferHandle blueNoise;
+
+        // 1x1 stand-ins bound when a frame has no depth / entity ID targets, the shader writes to them are out of bounds and discarded
+        nvrhi::TextureHandle placeholderDepth;
+        nvrhi::TextureHandle placeholderEntitiesID;
+        nvrhi::TextureHandle placeholderAccumulationError;
        
+        std::filesystem::path textureCacheDir; // cooked textures, empty disables the cache, see CookTexture
+        bool textureCacheReadOnly = false;     // distributed workers read the cache of the project but never write to it
+        TextureStreaming textureStreaming;
+        std::map<Assets::AssetHandle, AlphaMap> alphaMaps; // of the cooked color textures
+        std::map<Assets::AssetHandle, uint64_t> textureHashes; // of the texels of the cooked textures, see CookTexture
         uint32_t textureCount = 0;
+        uint32_t bufferDescriptorCount = 0; // index and vertex buffers of the mesh sources
+
+        // mesh sources encode to VertexLayout::Quantized when the error stays within the tolerances, see QuantizeVertices
+        bool quantizeVertices = true;
+        float positionTolerance = 1e-3f;        // object space
+        float texCoordTolerance = 1.0f / 2048;  // half a texel of a 1024 texture
     };
 
     struct FrameData
     {
-        nvrhi::BindingSetHandle bindingSet;
+        // ping-pong accumulation : rgb holds the radiance sum and a the sample count of each pixel.
+        // Each dispatch reads the previous sums from one target and writes the new ones into the other,
+        // bindingSets[i] writes accumulation[i] and reads accumulation[i ^ 1]
+        std::array<nvrhi::BindingSetHandle, 2> bindingSets;
+        std::array<nvrhi::TextureHandle, 2> accumulation;
+        nvrhi::TextureHandle accumulationError; // Kahan compensation terms, only with settings.enableCompensatedSummation
+        uint32_t accumulationIndex = 0; // target written by the last dispatch
         nvrhi::BufferHandle sceneInfoBuffer;
 
-        nvrhi::TextureHandle accumulationOutput;
-        nvrhi::TextureHandle HDRColor;
         nvrhi::TextureHandle LDRColor;
         nvrhi::TextureHandle depth;
         nvrhi::TextureHandle entitiesID;
@@ -216,6 +414,7 @@ export namespace HRay {
         nvrhi::BufferHandle materialBuffer;
         nvrhi::BufferHandle directionalLightBuffer;
         nvrhi::rt::AccelStructHandle topLevelAS;
+        WavefrontBuffers wavefront; // created on first use of IntegratorType::Wavefront
        
         std::vector<nvrhi::rt::InstanceDesc> instances;
         std::vector<InstanceData> instanceData;
@@ -223,14 +422,21 @@ export namespace HRay {
         std::vector<MaterialData> materialData;
         std::vector<DirectionalLightData> directionalLightData;
         std::map<Assets::AssetHandle, uint32_t> materials;
+        std::set<Assets::AssetHandle> assets; // mesh sources and textures the frame renders, see ComputeSceneHash
         SceneInfo sceneInfo;
         
+        bool enableDepthAndIDTargets = false; // only the viewports composite and pick, offline renders skip them
+        IntegratorType integrator = IntegratorType::Megakernel;
         uint32_t frameIndex = 0;
+        uint32_t sampleOffset = 0; // offsets the sample sequence, used to split samples of one frame across renderers
         float time = 0.0f;
         float lastTime = 0.0f;
         uint32_t geometryCount = 0;
         uint32_t instanceCount = 0;
         uint32_t materialCount = 0;
+
+        RendererStats stats;
+        std::unordered_set<const void*> statsResources; // counted in stats this frame
     };
 
     struct ViewDesc
@@ -240,18 +446,87 @@ export namespace HRay {
         Math::float3 cameraPosition;
         float fov;
         uint32_t width, height;
+
+        // tiled rendering : the targets are tile sized and only the tile is dispatched, zero size renders the full view
+        Math::uint2 tileOffset = { 0, 0 };
+        Math::uint2 tileSize = { 0, 0 };
     };
 
     void Init(RendererData& data, nvrhi::DeviceHandle pDevice, nvrhi::CommandListHandle commandList);
     void BeginScene(RendererData& data, FrameData& frameData);
     void EndScene(RendererData& data, FrameData& frameData, nvrhi::ICommandList* commandList, const ViewDesc& viewDesc);
-    void SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset asset, Assets::Mesh& mesh, Math::float4x4 wt, uint32_t id, nvrhi::ICommandList* cl);
+    void SubmitMesh(RendererData& data, FrameData& frameData, Assets::Asset asset, Assets::Mesh& mesh, Math::float4x4 wt, uint32_t id, nvrhi::ICommandList* cl, uint32_t instanceMask = c_instanceMaskAll);
     void SubmitMaterial(RendererData& data, FrameData& frameData, Assets::Asset materailAsset);
     void SubmitDirectionalLight(RendererData& data, FrameData& frameData, const Assets::DirectionalLightComponent& light, Math::float4x4 wt);
     void SubmitSkyLight(RendererData& data, FrameData& frameData, Assets::SkyLightComponent& light, float rotation);
     void ReleaseTexture(RendererData& data, Assets::Texture* texture);
+    void CookTexture(RendererData& data, Assets::AssetHandle handle, TextureKind kind); // replaces a single level texture by a block compressed mip chain
+    bool UpdateTextureStreaming(RendererData& data); // streams texture levels in and out from the feedback, true when finer levels arrived
+    bool MakeTexturesResident(RendererData& data); // streams every level in whatever the budget, true when levels arrived
+    void CopyTextureFeedback(RendererData& data, nvrhi::ICommandList* commandList);
+    AlphaMap BuildAlphaMap(std::span<const uint8_t> texels, uint32_t width, uint32_t height); // texels are RGBA8 or BGRA8
+    TriangleOpacity ClassifyTriangle(const AlphaMap& map, Math::float2 uv0, Math::float2 uv1, Math::float2 uv2, float baseAlpha, float alphaCutoff);
+    GeometryOpacity ClassifyTriangles(std::span<uint32_t> indices, std::span<const Math::float2> texcoords, const Math::float3x3& uvMat, const AlphaMap* map, float baseAlpha, float alphaCutoff); // reorders the indices
+    bool QuantizeVertices(Assets::MeshSource& meshSource, float positionTolerance, float texCoordTolerance, QuantizedVertices& quantized); // false when an error exceeds its tolerance
+    uint64_t GetQuantizedOffset(Assets::MeshSource& meshSource, const QuantizedVertices& quantized, Assets::VertexAttribute attribute, uint64_t byteOffset); // cpuVertexBuffer offset to data offset
+    uint16_t FloatToHalf(float value); // round to nearest even
+    std::array<uint32_t, 5> PackNormalMatrix(const Math::float4x4& wt); // inverse transpose of the upper 3x3 as row major halves, scaled to the largest element
+    uint32_t PackBarycentrics(Math::float2 barycentrics); // RayPayload::barycentrics, 2 x unorm16
+    Math::float2 UnpackBarycentrics(uint32_t value);
+    void DecodePositions(const QuantizedVertices::Bounds& bounds, std::span<const Math::float3> positions, std::vector<Math::float3>& decoded); // positions as the shaders read them back
     void Clear(FrameData& frameData);
+    void WriteRendererStats(const RendererStats& stats, std::ostream& out); // JSON object
+    uint64_t ComputeSceneHash(RendererData& data, const FrameData& frameData, const ViewDesc& viewDesc);
+    void ResumeAccumulation(RendererData& data, FrameData& frameData, nvrhi::ICommandList* commandList, uint32_t width, uint32_t height, const void* pixels, size_t rowPitch, uint32_t frameIndex);
     nvrhi::ITexture* GetColorTarget(FrameData& frameData);
+    nvrhi::ITexture* GetHDRTarget(FrameData& frameData); // RGBA32F, radiance sum in rgb and sample count in a, see ResolveAccumulation
+    void ResolveAccumulation(Math::float4* pixels, size_t count);
+    void AccumulateSample(Math::float3& sum, Math::float3& error, Math::float3 sampleSum, bool compensated); // CPU reference of the summation of Accumulate in PathTracer.hlsli
+    std::vector<uint32_t> GenerateSobolMatrices(); // c_SobolDimensions x c_SobolBits direction numbers, see Sampler.hlsli
+    float SampleSobol(std::span<const uint32_t> sobolMatrices, uint32_t index, uint32_t dimension, float shift); // CPU reference of SampleFloat in Sampler.hlsli, shift is the blue noise value of the pixel
+    void BinHitsByMaterial(std::span<const uint32_t> hitMaterials, uint32_t materialCount, std::vector<uint32_t>& sortedHits); // CPU reference of the wavefront material sort
     nvrhi::ITexture* GetDepthTarget(FrameData& frameData);
     nvrhi::ITexture* GetEntitiesIDTarget(FrameData& frameData);
-}
\ No newline at end of file
+
+    // Runs func(i) for every i in [0, count) on the HE::Jops workers, chunkSize indices per task. The calling thread
+    // takes chunks too and only waits for the chunks that are already running, a call made from a task can not
+    // wait on tasks queued behind it
+    template<typename Func>
+    void ParallelFor(uint32_t count, uint32_t chunkSize, Func&& func)
+    {
+        struct State
+        {
+            std::atomic<uint32_t> next = 0;
+            std::atomic<uint32_t> done = 0;
+        };
+
+        chunkSize = std::max(chunkSize, 1u);
+        const uint32_t chunkCount = uint32_t((uint64_t(count) + chunkSize - 1) / chunkSize);
+        if (chunkCount == 0)
+            return;
+
+        // a task that starts after the last chunk was taken returns without touching func
+        auto state = HE::CreateRef<State>();
+        auto run = [state, count, chunkSize, chunkCount, &func]() {
+            for (uint32_t chunk = state->next++; chunk < chunkCount; chunk = state->next++)
+            {
+                uint32_t begin = chunk * chunkSize;
+                uint32_t end = uint32_t(std::min(uint64_t(begin) + chunkSize, uint64_t(count)));
+                for (uint32_t i = begin; i < end; i++)
+                    func(i);
+
+                if (++state->done == chunkCount)
+                    state->done.notify_all();
+            }
+        };
+
+        uint32_t taskCount = std::min(chunkCount, std::max(std::thread::hardware_concurrency(), 1u)) - 1;
+        for (uint32_t i = 0; i < taskCount; i++)
+            HE::Jops::SubmitTask(run);
+
+        run();
+
+        for (uint32_t done = state->done; done < chunkCount; done = state->done)
+            state->done.wait(done);
+    }
+}
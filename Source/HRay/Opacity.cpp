@@ -0,0 +1,216 @@
+#include <HydraEngine/Base.h>
+
+import HRay;
+import HE;
+import Math;
+import std;
+
+// Triangle opacity classification : the alpha tested triangles are sorted into fully opaque, fully transparent
+// and mixed by rasterizing their uv footprint over a conservative alpha map of the base texture.
+// SubmitMesh builds the opaque triangles as a BLAS geometry flagged opaque, leaves the transparent ones out and
+// only the mixed ones run the any-hit alpha test.
+
+constexpr uint32_t c_AlphaMapSize = 256; // max cells per side
+
+HRay::AlphaMap HRay::BuildAlphaMap(std::span<const uint8_t> texels, uint32_t width, uint32_t height)
+{
+    HE_PROFILE_FUNCTION();
+
+    AlphaMap map;
+
+    bool opaque = true;
+    for (size_t i = 3; i < texels.size() && opaque; i += 4)
+        opaque = texels[i] == 255;
+
+    if (opaque)
+        return map;
+
+    uint32_t mapWidth = std::min(width, c_AlphaMapSize);
+    uint32_t mapHeight = std::min(height, c_AlphaMapSize);
+    std::vector<uint8_t> minAlpha(size_t(mapWidth) * mapHeight, 255);
+    std::vector<uint8_t> maxAlpha(size_t(mapWidth) * mapHeight, 0);
+
+    HRay::ParallelFor(mapHeight, 1, [&](uint32_t cy) {
+
+        uint32_t y0 = uint32_t(uint64_t(cy) * height / mapHeight);
+        uint32_t y1 = std::max(uint32_t(uint64_t(cy + 1) * height / mapHeight), y0 + 1);
+
+        for (uint32_t y = y0; y < y1; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint32_t cell = cy * mapWidth + uint32_t(uint64_t(x) * mapWidth / width);
+                uint8_t alpha = texels[(size_t(y) * width + x) * 4 + 3];
+                minAlpha[cell] = std::min(minAlpha[cell], alpha);
+                maxAlpha[cell] = std::max(maxAlpha[cell], alpha);
+            }
+        }
+    });
+
+    // bilinear filtering and the coarser levels of a streamed texture blend the neighbouring cells in
+    map.width = mapWidth;
+    map.height = mapHeight;
+    map.minAlpha.resize(minAlpha.size());
+    map.maxAlpha.resize(maxAlpha.size());
+
+    for (uint32_t y = 0; y < mapHeight; y++)
+    {
+        for (uint32_t x = 0; x < mapWidth; x++)
+        {
+            uint8_t minValue = 255;
+            uint8_t maxValue = 0;
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    uint32_t cell = ((y + mapHeight + dy) % mapHeight) * mapWidth + (x + mapWidth + dx) % mapWidth;
+                    minValue = std::min(minValue, minAlpha[cell]);
+                    maxValue = std::max(maxValue, maxAlpha[cell]);
+                }
+            }
+
+            map.minAlpha[size_t(y) * mapWidth + x] = minValue;
+            map.maxAlpha[size_t(y) * mapWidth + x] = maxValue;
+        }
+    }
+
+    return map;
+}
+
+// Conservative rasterization of the triangle in cell space : every cell the triangle touches is visited, the texture
+// wraps like the material sampler
+template<typename Func>
+static void ForEachCoveredCell(const HRay::AlphaMap& map, Math::float2 p0, Math::float2 p1, Math::float2 p2, Func&& func)
+{
+    Math::float2 size = { float(map.width), float(map.height) };
+    p0 *= size;
+    p1 *= size;
+    p2 *= size;
+
+    Math::float2 lower = Math::min(p0, Math::min(p1, p2));
+    Math::float2 upper = Math::max(p0, Math::max(p1, p2));
+
+    // covers a whole period of the texture, every cell is touched
+    if (upper.x - lower.x >= size.x || upper.y - lower.y >= size.y)
+    {
+        for (uint32_t cell = 0; cell < map.width * map.height; cell++)
+        {
+            if (!func(cell))
+                return;
+        }
+
+        return;
+    }
+
+    // counter clockwise, a degenerate triangle keeps its bounds only
+    float area = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+    if (area < 0.0f)
+        std::swap(p1, p2);
+
+    const Math::float2 vertices[3] = { p0, p1, p2 };
+
+    int x0 = int(std::floor(lower.x));
+    int y0 = int(std::floor(lower.y));
+    int x1 = int(std::floor(upper.x));
+    int y1 = int(std::floor(upper.y));
+
+    for (int y = y0; y <= y1; y++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            bool outside = false;
+            for (uint32_t e = 0; e < 3 && area != 0.0f && !outside; e++)
+            {
+                Math::float2 a = vertices[e];
+                Math::float2 b = vertices[(e + 1) % 3];
+                Math::float2 edge = b - a;
+
+                // the cell corner furthest inside the edge
+                float cornerX = edge.y > 0.0f ? float(x) : float(x + 1);
+                float cornerY = edge.x > 0.0f ? float(y + 1) : float(y);
+                outside = edge.x * (cornerY - a.y) - edge.y * (cornerX - a.x) < 0.0f;
+            }
+
+            if (outside)
+                continue;
+
+            uint32_t cellX = uint32_t((x % int(map.width) + int(map.width)) % int(map.width));
+            uint32_t cellY = uint32_t((y % int(map.height) + int(map.height)) % int(map.height));
+            if (!func(cellY * map.width + cellX))
+                return;
+        }
+    }
+}
+
+HRay::TriangleOpacity HRay::ClassifyTriangle(const AlphaMap& map, Math::float2 uv0, Math::float2 uv1, Math::float2 uv2, float baseAlpha, float alphaCutoff)
+{
+    // same test as AnyHit : baseColor.a * texture.a < alphaCutoff rejects the hit
+    if (map.minAlpha.empty())
+        return baseAlpha < alphaCutoff ? TriangleOpacity::Transparent : TriangleOpacity::Opaque;
+
+    bool opaque = true;
+    bool transparent = true;
+    ForEachCoveredCell(map, uv0, uv1, uv2, [&](uint32_t cell) {
+
+        opaque = opaque && baseAlpha * (map.minAlpha[cell] / 255.0f) >= alphaCutoff;
+        transparent = transparent && baseAlpha * (map.maxAlpha[cell] / 255.0f) < alphaCutoff;
+
+        return opaque || transparent;
+    });
+
+    return opaque ? TriangleOpacity::Opaque : transparent ? TriangleOpacity::Transparent : TriangleOpacity::Mixed;
+}
+
+HRay::GeometryOpacity HRay::ClassifyTriangles(std::span<uint32_t> indices, std::span<const Math::float2> texcoords, const Math::float3x3& uvMat, const AlphaMap* map, float baseAlpha, float alphaCutoff)
+{
+    HE_PROFILE_FUNCTION();
+
+    static const AlphaMap c_OpaqueMap;
+    if (!map)
+        map = &c_OpaqueMap;
+
+    uint32_t triangleCount = uint32_t(indices.size() / 3);
+
+    // untextured or opaque texture : the whole geometry is opaque or transparent, texcoords may be empty
+    GeometryOpacity opacity;
+    if (map->minAlpha.empty())
+    {
+        opacity.opaqueCount = baseAlpha < alphaCutoff ? 0 : triangleCount;
+        return opacity;
+    }
+
+    // the shaders transform the texture coordinates as a row vector, mul(float3(uv, 1), uvMat)
+    Math::float3x3 transform = Math::transpose(uvMat);
+
+    std::vector<TriangleOpacity> opacities(triangleCount);
+
+    HRay::ParallelFor(triangleCount, 1024, [&](uint32_t t) {
+
+        Math::float2 uv[3];
+        for (uint32_t i = 0; i < 3; i++)
+            uv[i] = Math::float2(transform * Math::float3(texcoords[indices[t * 3 + i]], 1.0f));
+
+        opacities[t] = ClassifyTriangle(*map, uv[0], uv[1], uv[2], baseAlpha, alphaCutoff);
+    });
+
+    // stable partition, opaque then mixed then transparent
+    std::vector<uint32_t> sorted;
+    sorted.reserve(triangleCount * 3);
+
+    for (TriangleOpacity pass : { TriangleOpacity::Opaque, TriangleOpacity::Mixed, TriangleOpacity::Transparent })
+    {
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            if (opacities[t] != pass)
+                continue;
+
+            sorted.insert(sorted.end(), { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] });
+            opacity.opaqueCount += pass == TriangleOpacity::Opaque;
+            opacity.mixedCount += pass == TriangleOpacity::Mixed;
+        }
+    }
+
+    std::copy(sorted.begin(), sorted.end(), indices.begin());
+
+    return opacity;
+}
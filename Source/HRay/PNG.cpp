@@ -0,0 +1,166 @@
+#include "HydraEngine/Base.h"
+
+import HE;
+import std;
+import Editor;
+
+// Streaming PNG writer for images too large to encode in memory, reference: https://www.w3.org/TR/png-3/
+// The zlib stream is made of stored deflate blocks : the file is not compressed, but every scanline band
+// is written as soon as it is read and nothing else of the image is kept in memory.
+
+static const std::array<uint32_t, 256>& GetCRCTable()
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t;
+        for (uint32_t n = 0; n < t.size(); n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    return table;
+}
+
+static uint32_t UpdateCRC(uint32_t crc, const uint8_t* data, size_t size)
+{
+    const auto& table = GetCRCTable();
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+    return crc;
+}
+
+static void WriteBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(uint8_t(value >> 24));
+    out.push_back(uint8_t(value >> 16));
+    out.push_back(uint8_t(value >> 8));
+    out.push_back(uint8_t(value));
+}
+
+static void WriteChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> header;
+    WriteBigEndian(header, uint32_t(data.size()));
+    header.insert(header.end(), type, type + 4);
+
+    uint32_t crc = UpdateCRC(0xffffffffu, header.data() + 4, 4);
+    crc = UpdateCRC(crc, data.data(), data.size()) ^ 0xffffffffu;
+
+    std::vector<uint8_t> footer;
+    WriteBigEndian(footer, crc);
+
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    file.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+}
+
+// Splits the filtered scanlines into stored deflate blocks, blocks may span scanline bands
+struct StoredDeflateStream
+{
+    static constexpr size_t c_MaxBlockSize = 65535;
+
+    std::vector<uint8_t> pending;
+    uint32_t adlerA = 1;
+    uint32_t adlerB = 0;
+
+    void Append(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            adlerA = (adlerA + data[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+
+        pending.insert(pending.end(), data, data + size);
+
+        size_t offset = 0;
+        while (pending.size() - offset >= c_MaxBlockSize)
+        {
+            WriteBlock(pending.data() + offset, c_MaxBlockSize, false, out);
+            offset += c_MaxBlockSize;
+        }
+
+        pending.erase(pending.begin(), pending.begin() + offset);
+    }
+
+    void Finish(std::vector<uint8_t>& out)
+    {
+        WriteBlock(pending.data(), pending.size(), true, out);
+        pending.clear();
+
+        WriteBigEndian(out, (adlerB << 16) | adlerA);
+    }
+
+    static void WriteBlock(const uint8_t* data, size_t size, bool final, std::vector<uint8_t>& out)
+    {
+        uint16_t len = uint16_t(size);
+        uint16_t nlen = uint16_t(~len);
+
+        out.push_back(final ? 1 : 0); // BFINAL, BTYPE = 00
+        out.push_back(uint8_t(len));
+        out.push_back(uint8_t(len >> 8));
+        out.push_back(uint8_t(nlen));
+        out.push_back(uint8_t(nlen >> 8));
+        out.insert(out.end(), data, data + size);
+    }
+};
+
+bool Editor::WritePNG(const std::string& filePath, uint32_t width, uint32_t height, uint32_t bandHeight, const ReadRowsFn& readRows)
+{
+    HE_PROFILE_FUNCTION();
+
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file)
+        return false;
+
+    constexpr std::array<uint8_t, 8> c_Signature = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    file.write(reinterpret_cast<const char*>(c_Signature.data()), c_Signature.size());
+
+    {
+        std::vector<uint8_t> ihdr;
+        WriteBigEndian(ihdr, width);
+        WriteBigEndian(ihdr, height);
+        ihdr.push_back(8); // bit depth
+        ihdr.push_back(6); // RGBA
+        ihdr.push_back(0); // deflate
+        ihdr.push_back(0); // adaptive filtering
+        ihdr.push_back(0); // no interlace
+        WriteChunk(file, "IHDR", ihdr);
+    }
+
+    const size_t rowSize = size_t(width) * 4;
+    bandHeight = std::max(bandHeight, 1u);
+
+    std::vector<uint8_t> band(rowSize * std::min(bandHeight, height));
+    std::vector<uint8_t> idat = { 0x78, 0x01 }; // zlib header, 32K window, no dictionary
+    StoredDeflateStream stream;
+
+    for (uint32_t bandStart = 0; bandStart < height; bandStart += bandHeight)
+    {
+        uint32_t count = std::min(bandHeight, height - bandStart);
+        readRows(bandStart, count, band.data());
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const uint8_t filter = 0; // none, stored blocks gain nothing from filtering
+            stream.Append(&filter, 1, idat);
+            stream.Append(band.data() + i * rowSize, rowSize, idat);
+        }
+
+        if (bandStart + count == height)
+            stream.Finish(idat);
+
+        // one IDAT chunk per band
+        WriteChunk(file, "IDAT", idat);
+        idat.clear();
+    }
+
+    WriteChunk(file, "IEND", {});
+
+    return file.good();
+}
@@ -0,0 +1,282 @@
+#include <HydraEngine/Base.h>
+
+import HRay;
+import HE;
+import Assets;
+import Math;
+import std;
+
+// Vertex quantization : positions are stored as 3 x unorm16 of the bounds of their geometry and texture coordinates
+// as half floats, 18 instead of 28 bytes per vertex with one uv set. The encoder measures the round trip error of
+// every vertex and keeps the float layout when it exceeds the tolerances. Decoded by LoadPosition and LoadTexcoord
+// in PathTracer.hlsli
+
+constexpr uint32_t c_SizeOfQuantizedPosition = 6;
+constexpr uint32_t c_SizeOfQuantizedTexcoord = 4;
+constexpr float c_PositionSteps = 65535.0f;
+
+uint16_t HRay::FloatToHalf(float value)
+{
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponentBits = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+    int32_t exponent = int32_t(exponentBits) - 127 + 15;
+
+    // inf / nan
+    if (exponentBits == 0xff)
+        return uint16_t(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+    // overflow
+    if (exponent >= 0x1f)
+        return uint16_t(sign | 0x7c00);
+
+    // subnormal or zero
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+            return uint16_t(sign);
+
+        mantissa |= 0x800000;
+        uint32_t shift = uint32_t(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            half++;
+
+        return uint16_t(sign | half);
+    }
+
+    // round to nearest even, a carry into the exponent is the correct result
+    uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++;
+
+    return uint16_t(half);
+}
+
+static float HalfToFloat(uint16_t value)
+{
+    uint32_t sign = uint32_t(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+
+    if (exponent == 0x1f)
+        return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+
+    if (exponent == 0)
+    {
+        float magnitude = std::ldexp(float(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+
+    return std::bit_cast<float>(sign | ((exponent + 127 - 15) << 23) | (mantissa << 13));
+}
+
+static uint32_t GetQuantizedSize(Assets::VertexAttribute attribute)
+{
+    switch (attribute)
+    {
+    case Assets::VertexAttribute::Position:  return c_SizeOfQuantizedPosition;
+    case Assets::VertexAttribute::TexCoord0:
+    case Assets::VertexAttribute::TexCoord1: return c_SizeOfQuantizedTexcoord;
+    default:                                 return (uint32_t)Assets::GetVertexAttributeSize(attribute);
+    }
+}
+
+static HRay::QuantizedVertices::Bounds ComputeBounds(std::span<const Math::float3> positions)
+{
+    Math::float3 lower = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    Math::float3 upper = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    for (const auto& p : positions)
+    {
+        lower = Math::min(lower, p);
+        upper = Math::max(upper, p);
+    }
+
+    if (positions.empty())
+        lower = upper = { 0.0f, 0.0f, 0.0f };
+
+    return { lower, (upper - lower) / c_PositionSteps };
+}
+
+static std::array<uint16_t, 3> EncodePosition(const HRay::QuantizedVertices::Bounds& bounds, Math::float3 p)
+{
+    std::array<uint16_t, 3> q;
+    for (int c = 0; c < 3; c++)
+    {
+        float value = bounds.scale[c] > 0.0f ? (p[c] - bounds.bias[c]) / bounds.scale[c] : 0.0f;
+        q[c] = (uint16_t)std::clamp(std::round(value), 0.0f, c_PositionSteps);
+    }
+
+    return q;
+}
+
+// same arithmetic as LoadPosition
+static Math::float3 DecodePosition(const HRay::QuantizedVertices::Bounds& bounds, const std::array<uint16_t, 3>& q)
+{
+    return bounds.bias + Math::float3(float(q[0]), float(q[1]), float(q[2])) * bounds.scale;
+}
+
+bool HRay::QuantizeVertices(Assets::MeshSource& meshSource, float positionTolerance, float texCoordTolerance, QuantizedVertices& quantized)
+{
+    HE_PROFILE_FUNCTION();
+
+    quantized = {};
+
+    const Assets::VertexAttribute attributes[] = {
+        Assets::VertexAttribute::Position,
+        Assets::VertexAttribute::Normal,
+        Assets::VertexAttribute::Tangent,
+        Assets::VertexAttribute::TexCoord0,
+        Assets::VertexAttribute::TexCoord1
+    };
+
+    // stream layout, 4 byte aligned for the ByteAddressBuffer loads. The position stream is padded by a word,
+    // the last 6 byte position is read with an 8 byte load
+    uint64_t size = 0;
+    for (auto attribute : attributes)
+    {
+        if (!meshSource.HasAttribute(attribute))
+            continue;
+
+        uint64_t count = meshSource.getVertexBufferRange(attribute).byteSize / Assets::GetVertexAttributeSize(attribute);
+        quantized.offsets[attribute] = size;
+        size += count * GetQuantizedSize(attribute) + (attribute == Assets::VertexAttribute::Position ? 4 : 0);
+        size = (size + 3) & ~3ull;
+    }
+
+    quantized.data.resize(size);
+
+    // positions, one set of bounds per geometry
+    if (meshSource.HasAttribute(Assets::VertexAttribute::Position))
+    {
+        const auto& range = meshSource.getVertexBufferRange(Assets::VertexAttribute::Position);
+
+        std::vector<std::pair<uint64_t, uint32_t>> geometries; // position byte offset and vertex count
+        for (auto& mesh : meshSource.meshes)
+        {
+            for (auto& geometry : mesh.GetGeometrySpan())
+            {
+                uint64_t byteOffset = geometry.GetVertexRange(Assets::VertexAttribute::Position).byteOffset;
+                if (!quantized.bounds.contains(byteOffset))
+                {
+                    quantized.bounds[byteOffset] = {};
+                    geometries.push_back({ byteOffset, geometry.vertexCount });
+                }
+            }
+        }
+
+        std::vector<float> errors(geometries.size(), 0.0f);
+        HRay::ParallelFor((uint32_t)geometries.size(), 1, [&](uint32_t i) {
+
+            auto [byteOffset, vertexCount] = geometries[i];
+            std::span<const Math::float3> positions(reinterpret_cast<const Math::float3*>(meshSource.cpuVertexBuffer.data() + byteOffset), vertexCount);
+
+            auto& bounds = quantized.bounds.at(byteOffset);
+            bounds = ComputeBounds(positions);
+
+            uint8_t* out = quantized.data.data() + quantized.offsets.at(Assets::VertexAttribute::Position) + (byteOffset - range.byteOffset) / sizeof(Math::float3) * c_SizeOfQuantizedPosition;
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                auto q = EncodePosition(bounds, positions[v]);
+                std::memcpy(out + v * c_SizeOfQuantizedPosition, q.data(), c_SizeOfQuantizedPosition);
+
+                Math::float3 d = Math::abs(DecodePosition(bounds, q) - positions[v]);
+                errors[i] = std::max(errors[i], std::max(d.x, std::max(d.y, d.z)));
+            }
+        });
+
+        for (float error : errors)
+            quantized.positionError = std::max(quantized.positionError, error);
+    }
+
+    // texture coordinates
+    for (auto attribute : { Assets::VertexAttribute::TexCoord0, Assets::VertexAttribute::TexCoord1 })
+    {
+        if (!meshSource.HasAttribute(attribute))
+            continue;
+
+        const auto& range = meshSource.getVertexBufferRange(attribute);
+        const float* texcoords = reinterpret_cast<const float*>(meshSource.cpuVertexBuffer.data() + range.byteOffset);
+        uint16_t* out = reinterpret_cast<uint16_t*>(quantized.data.data() + quantized.offsets.at(attribute));
+
+        for (uint64_t i = 0; i < range.byteSize / sizeof(float); i++)
+        {
+            out[i] = HRay::FloatToHalf(texcoords[i]);
+            quantized.texCoordError = std::max(quantized.texCoordError, std::abs(HalfToFloat(out[i]) - texcoords[i]));
+        }
+    }
+
+    // normals and tangents
+    for (auto attribute : { Assets::VertexAttribute::Normal, Assets::VertexAttribute::Tangent })
+    {
+        if (!meshSource.HasAttribute(attribute))
+            continue;
+
+        const auto& range = meshSource.getVertexBufferRange(attribute);
+        std::memcpy(quantized.data.data() + quantized.offsets.at(attribute), meshSource.cpuVertexBuffer.data() + range.byteOffset, range.byteSize);
+    }
+
+    return quantized.positionError <= positionTolerance && quantized.texCoordError <= texCoordTolerance;
+}
+
+uint64_t HRay::GetQuantizedOffset(Assets::MeshSource& meshSource, const QuantizedVertices& quantized, Assets::VertexAttribute attribute, uint64_t byteOffset)
+{
+    uint64_t first = meshSource.getVertexBufferRange(attribute).byteOffset;
+    uint64_t index = (byteOffset - first) / Assets::GetVertexAttributeSize(attribute);
+
+    return quantized.offsets.at(attribute) + index * GetQuantizedSize(attribute);
+}
+
+void HRay::DecodePositions(const QuantizedVertices::Bounds& bounds, std::span<const Math::float3> positions, std::vector<Math::float3>& decoded)
+{
+    decoded.reserve(decoded.size() + positions.size());
+    for (const auto& p : positions)
+        decoded.push_back(DecodePosition(bounds, EncodePosition(bounds, p)));
+}
+
+// same arithmetic as PackBarycentrics and UnpackBarycentrics in Base.hlsli, saturate flushes nan to zero
+uint32_t HRay::PackBarycentrics(Math::float2 barycentrics)
+{
+    auto quantize = [](float value) { return uint32_t(std::nearbyint((value > 0.0f ? std::min(value, 1.0f) : 0.0f) * 65535.0f)); };
+
+    return quantize(barycentrics.x) | (quantize(barycentrics.y) << 16);
+}
+
+Math::float2 HRay::UnpackBarycentrics(uint32_t value)
+{
+    return Math::float2(float(value & 0xffff), float(value >> 16)) * (1.0f / 65535.0f);
+}
+
+std::array<uint32_t, 5> HRay::PackNormalMatrix(const Math::float4x4& wt)
+{
+    // wt transforms row vectors, the inverse transpose of its transpose is the inverse of its upper 3x3
+    Math::float3x3 normalMatrix = Math::inverse(Math::float3x3(wt));
+
+    // degenerate, a flat instance keeps the forward matrix
+    if (!std::isfinite(Math::determinant(normalMatrix)))
+        normalMatrix = Math::transpose(Math::float3x3(wt));
+
+    // the shaders normalize the transformed normals, the scale only keeps the halves in range
+    float largest = 0.0f;
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            largest = std::max(largest, std::abs(normalMatrix[r][c]));
+
+    if (largest == 0.0f)
+        largest = 1.0f;
+
+    std::array<uint16_t, 10> halves = {};
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            halves[r * 3 + c] = FloatToHalf(normalMatrix[r][c] / largest);
+
+    std::array<uint32_t, 5> packed;
+    for (int i = 0; i < 5; i++)
+        packed[i] = uint32_t(halves[i * 2]) | (uint32_t(halves[i * 2 + 1]) << 16);
+
+    return packed;
+}
@@ -0,0 +1,432 @@
+#include "HydraEngine/Base.h"
+
+import HE;
+import std;
+import Math;
+import Assets;
+import simdjson;
+import magic_enum;
+import Editor;
+
+// Job files are plain json, every field is optional and falls back to the project settings :
+// {
+//     "scene" : "Scenes/Main.scene",   relative to the assets directory
+//     "camera" : "Camera",             entity name, the primary camera otherwise
+//     "frameStart" : 0, "frameEnd" : 1, "frameStep" : 1,
+//     "maxSamples" : 64, "width" : 1920, "height" : 1080,
+//     "output" : "D:/Renders", "format" : "EXR"
+// }
+// <job>.json is renamed to <job>.running while it renders and to <job>.done / <job>.failed after,
+// <job>.status.json reports the progress and creating <job>.cancel stops it.
+
+static constexpr float c_PollInterval = 0.25f;   // seconds
+static constexpr float c_StatusInterval = 1.0f;  // seconds
+static constexpr float c_JobLoadTimeout = 300.0f; // seconds
+
+static std::filesystem::path GetJobFilePath(const std::filesystem::path& jobFilePath, std::string_view extension)
+{
+    return std::filesystem::path(jobFilePath).replace_extension(extension);
+}
+
+// messages carry job strings and paths, quotes, backslashes and control characters must not break the status file
+static std::string EscapeJsonString(std::string_view str)
+{
+    std::string result;
+    result.reserve(str.size());
+
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"':  result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (uint8_t(c) < 0x20)
+                result += std::format("\\u{:04x}", uint32_t(uint8_t(c)));
+            else
+                result += c;
+            break;
+        }
+    }
+
+    return result;
+}
+
+static void WriteJobStatus(std::string_view state, std::string_view message = "")
+{
+    auto& ctx = Editor::GetContext();
+    auto& server = ctx.renderServer;
+
+    float progress = 0.0f;
+    if (state == "done")
+    {
+        progress = 1.0f;
+    }
+    else if (server.state == Editor::RenderServer::State::Rendering && ctx.frameEnd > ctx.frameStart)
+    {
+        float frames = float(ctx.frameIndex - ctx.frameStart) + float(ctx.sampleCount) / float(Math::max(ctx.maxSamples, 1)) * float(ctx.frameStep);
+        progress = std::clamp(frames / float(ctx.frameEnd - ctx.frameStart), 0.0f, 1.0f);
+    }
+
+    std::ostringstream out;
+    out << "{\n";
+    out << "\t\"state\" : \"" << state << "\",\n";
+    out << "\t\"frame\" : " << ctx.frameIndex << ",\n";
+    out << "\t\"sample\" : " << ctx.sampleCount << ",\n";
+    out << "\t\"progress\" : " << progress << ",\n";
+    out << "\t\"message\" : \"" << EscapeJsonString(message) << "\"\n";
+    out << "}\n";
+
+    // clients may read the status at any time, never let them see a partial file
+    auto statusPath = GetJobFilePath(server.jobFilePath, ".status.json");
+    auto tmpPath = GetJobFilePath(server.jobFilePath, ".status.tmp");
+    {
+        std::ofstream file(tmpPath);
+        file << out.str();
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, statusPath, ec);
+
+    server.lastStatusTime = HE::Application::GetTime();
+}
+
+static void FinishJob(bool succeeded, std::string_view message = "")
+{
+    auto& ctx = Editor::GetContext();
+    auto& server = ctx.renderServer;
+
+    if (succeeded)
+    {
+        WriteJobStatus("done", message);
+        HE_INFO("Render job finished : {}", server.jobFilePath.string());
+    }
+    else
+    {
+        WriteJobStatus("failed", message);
+        HE_ERROR("Render job failed : {}, {}", server.jobFilePath.string(), message);
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(GetJobFilePath(server.jobFilePath, ".running"), GetJobFilePath(server.jobFilePath, succeeded ? ".done" : ".failed"), ec);
+    std::filesystem::remove(GetJobFilePath(server.jobFilePath, ".cancel"), ec);
+
+    server.state = Editor::RenderServer::State::Idle;
+    server.jobFilePath.clear();
+    server.camera.clear();
+
+    if (server.hasProjectSettings)
+    {
+        const auto& settings = server.projectSettings;
+        if (ctx.sceneHandle != settings.sceneHandle)
+        {
+            ctx.sceneHandle = settings.sceneHandle;
+            Editor::Clear();
+        }
+
+        ctx.frameStart = settings.frameStart;
+        ctx.frameEnd = settings.frameEnd;
+        ctx.frameStep = settings.frameStep;
+        ctx.maxSamples = settings.maxSamples;
+        ctx.width = settings.width;
+        ctx.height = settings.height;
+        ctx.outputPath = settings.outputPath;
+        ctx.outputFormat = settings.outputFormat;
+        server.hasProjectSettings = false;
+    }
+}
+
+static std::filesystem::path FindNextJob(const std::filesystem::path& jobsDir)
+{
+    std::filesystem::path next;
+
+    std::error_code ec;
+    for (auto& entry : std::filesystem::directory_iterator(jobsDir, ec))
+    {
+        if (!entry.is_regular_file())
+            continue;
+
+        auto& path = entry.path();
+        auto name = path.filename().string();
+        if (path.extension() != ".json" || name.ends_with(".status.json"))
+            continue;
+
+        // jobs run in name order
+        if (next.empty() || path.filename() < next.filename())
+            next = path;
+    }
+
+    return next;
+}
+
+// absent fields keep value, a field of the wrong type rejects the job
+template<typename T>
+static bool ReadJobField(simdjson::simdjson_result<simdjson::dom::element> doc, const char* key, T& value, std::string& error)
+{
+    auto field = doc[key];
+    if (field.error() == simdjson::NO_SUCH_FIELD)
+        return true;
+
+    if constexpr (std::is_same_v<T, int>)
+    {
+        int64_t number = 0;
+        if (field.get(number) || number < std::numeric_limits<int>::min() || number > std::numeric_limits<int>::max())
+        {
+            error = std::format("invalid {}, expected an integer", key);
+            return false;
+        }
+
+        value = (int)number;
+    }
+    else
+    {
+        std::string_view str;
+        if (field.get(str))
+        {
+            error = std::format("invalid {}, expected a string", key);
+            return false;
+        }
+
+        value = T(str);
+    }
+
+    return true;
+}
+
+static bool StartJob(const std::filesystem::path& jobFilePath, std::string& error)
+{
+    auto& ctx = Editor::GetContext();
+    auto& server = ctx.renderServer;
+
+    // the job overrides the project settings, FinishJob puts them back
+    server.projectSettings = {
+        .sceneHandle = ctx.sceneHandle,
+        .frameStart = ctx.frameStart,
+        .frameEnd = ctx.frameEnd,
+        .frameStep = ctx.frameStep,
+        .maxSamples = ctx.maxSamples,
+        .width = ctx.width,
+        .height = ctx.height,
+        .outputPath = ctx.outputPath,
+        .outputFormat = ctx.outputFormat
+    };
+    server.hasProjectSettings = true;
+
+    static simdjson::dom::parser parser;
+    auto doc = parser.load(jobFilePath.string());
+    if (doc.error() || !doc.is_object())
+    {
+        error = "invalid json";
+        return false;
+    }
+
+    std::string scene, format, output;
+    int frameStart = ctx.frameStart, frameEnd = ctx.frameEnd, frameStep = ctx.frameStep;
+    int maxSamples = ctx.maxSamples, width = ctx.width, height = ctx.height;
+
+    if (!ReadJobField(doc, "scene", scene, error) ||
+        !ReadJobField(doc, "camera", server.camera, error) ||
+        !ReadJobField(doc, "frameStart", frameStart, error) ||
+        !ReadJobField(doc, "frameEnd", frameEnd, error) ||
+        !ReadJobField(doc, "frameStep", frameStep, error) ||
+        !ReadJobField(doc, "maxSamples", maxSamples, error) ||
+        !ReadJobField(doc, "width", width, error) ||
+        !ReadJobField(doc, "height", height, error) ||
+        !ReadJobField(doc, "output", output, error) ||
+        !ReadJobField(doc, "format", format, error))
+    {
+        return false;
+    }
+
+    if (frameStep < 1 || maxSamples < 1 || width < 1 || height < 1)
+    {
+        error = "invalid frameStep, maxSamples, width or height, expected a positive integer";
+        return false;
+    }
+
+    if (!scene.empty())
+    {
+        auto handle = Editor::GetAssetManager().GetAssetHandleFromFilePath(std::filesystem::path(scene));
+        if (!Editor::GetAssetManager().IsAssetHandleValid(handle))
+        {
+            error = std::format("unknown scene {}", scene);
+            return false;
+        }
+
+        if (ctx.sceneHandle != handle)
+        {
+            ctx.sceneHandle = handle;
+            Editor::Clear();
+        }
+    }
+
+    ctx.frameStart = frameStart;
+    ctx.frameEnd = frameEnd;
+    ctx.frameStep = frameStep;
+    ctx.maxSamples = maxSamples;
+    ctx.width = width;
+    ctx.height = height;
+
+    if (!output.empty())
+        ctx.outputPath = output;
+
+    if (!format.empty())
+        ctx.outputFormat = magic_enum::enum_cast<Editor::OutputFormat>(format).value_or(ctx.outputFormat);
+
+    ctx.readbackQueue.failedWrites = 0;
+
+    std::error_code ec;
+    std::filesystem::create_directories(ctx.outputPath, ec);
+    if (!std::filesystem::exists(ctx.outputPath))
+    {
+        error = std::format("invalid output path {}", ctx.outputPath);
+        return false;
+    }
+
+    return true;
+}
+
+static bool SelectJobCamera(Assets::Scene* scene, const std::string& name)
+{
+    bool found = false;
+
+    auto camView = scene->registry.view<Assets::CameraComponent>();
+    for (auto e : camView)
+    {
+        Assets::Entity entity = { e, scene };
+        auto& c = entity.GetComponent<Assets::CameraComponent>();
+        c.isPrimary = !found && entity.GetName() == name;
+        found |= c.isPrimary;
+    }
+
+    return found;
+}
+
+void Editor::UpdateRenderServer()
+{
+    HE_PROFILE_FUNCTION();
+
+    auto& ctx = Editor::GetContext();
+    auto& server = ctx.renderServer;
+
+    if (!server.enabled || ctx.project.projectFilePath.empty())
+        return;
+
+    float time = HE::Application::GetTime();
+
+    switch (server.state)
+    {
+    case RenderServer::State::Idle:
+    {
+        if (ctx.sceneMode != SceneMode::Editor || time - server.lastPollTime < c_PollInterval)
+            break;
+
+        server.lastPollTime = time;
+
+        if (server.jobsDir.empty())
+        {
+            server.jobsDir = ctx.project.cacheDir / "Jobs";
+            std::filesystem::create_directories(server.jobsDir);
+            HE_INFO("Render server waiting for jobs in {}", server.jobsDir.string());
+        }
+
+        auto jobFilePath = FindNextJob(server.jobsDir);
+        if (jobFilePath.empty())
+            break;
+
+        // claim the job first so that it is never picked twice
+        std::error_code ec;
+        std::filesystem::rename(jobFilePath, GetJobFilePath(jobFilePath, ".running"), ec);
+        if (ec)
+            break;
+
+        server.jobFilePath = jobFilePath;
+        server.jobStartTime = time;
+        HE_INFO("Render job started : {}", jobFilePath.string());
+
+        std::string error;
+        if (!StartJob(GetJobFilePath(jobFilePath, ".running"), error))
+        {
+            FinishJob(false, error);
+            break;
+        }
+
+        server.state = RenderServer::State::Loading;
+        WriteJobStatus("loading");
+        break;
+    }
+    case RenderServer::State::Loading:
+    {
+        Assets::Scene* scene = Editor::GetScene();
+
+        if (!scene || !Editor::IsSceneLoaded(scene))
+        {
+            if (time - server.jobStartTime > c_JobLoadTimeout)
+                FinishJob(false, "the scene did not load");
+            break;
+        }
+
+        Editor::Animate();
+
+        if (ctx.sceneMode != SceneMode::Runtime)
+        {
+            FinishJob(false, "the scene has no camera");
+            break;
+        }
+
+        // the runtime scene is a copy, selecting the job camera leaves the project scene untouched
+        if (!server.camera.empty() && !SelectJobCamera(Editor::GetScene(), server.camera))
+        {
+            Editor::Stop();
+            FinishJob(false, std::format("unknown camera {}", server.camera));
+            break;
+        }
+
+        server.state = RenderServer::State::Rendering;
+        WriteJobStatus("rendering");
+        break;
+    }
+    case RenderServer::State::Rendering:
+    {
+        if (std::filesystem::exists(GetJobFilePath(server.jobFilePath, ".cancel")))
+        {
+            if (ctx.sceneMode == SceneMode::Runtime)
+                Editor::Stop();
+
+            FinishJob(false, "canceled");
+            break;
+        }
+
+        // the runtime loop stops once the last frame is written
+        if (ctx.sceneMode != SceneMode::Runtime)
+        {
+            // report done only once the last images are on disk
+            ctx.readbackQueue.Flush();
+            FinishJob(ctx.readbackQueue.failedWrites == 0);
+            break;
+        }
+
+        if (time - server.lastStatusTime >= c_StatusInterval)
+            WriteJobStatus("rendering");
+
+        break;
+    }
+    }
+}
+
+void Editor::ShutdownRenderServer()
+{
+    auto& ctx = Editor::GetContext();
+    auto& server = ctx.renderServer;
+
+    if (server.state == RenderServer::State::Idle)
+        return;
+
+    if (ctx.sceneMode == SceneMode::Runtime)
+        Editor::Stop();
+
+    FinishJob(false, "the render server shut down");
+}
@@ -0,0 +1,1081 @@
+#include <HydraEngine/Base.h>
+
+import HRay;
+import nvrhi;
+import HE;
+import Assets;
+import std;
+
+// Texture cooking : mip chain generation and block compression of the textures used by the renderer.
+// Color textures are encoded to BC7, normal maps to BC5 and HDR environment maps to BC6H, the cooked data is
+// stored in RendererData::textureCacheDir keyed by the hash of the source texels.
+// The encoders favor speed over quality : BC7 uses mode 6 only (one subset, RGBA endpoints) and BC6H mode 11 only
+// (one region, 10 bit endpoints), both fit the endpoints along the principal axis of the block.
+// Reference: https://learn.microsoft.com/en-us/windows/win32/direct3d11/texture-block-compression-in-direct3d-11
+//
+// Texture streaming : only the coarse levels of a cooked texture stay in VRAM, the finer ones are read back from
+// the cooked file when the shaders ask for them. GetTextureLod in PathTracer.hlsli records the finest lod used per
+// bindless texture, UpdateTextureStreaming reads it back a few frames later and streams levels in while they fit
+// in TextureStreaming::budget. Textures that are no longer requested fall back to their coarse levels.
+
+constexpr uint32_t c_CookedTextureMagic = 0x58545248; // "HRTX"
+constexpr uint32_t c_CookedTextureVersion = 1;
+constexpr uint32_t c_BlockSize = 16;
+constexpr uint32_t c_MinResidentSize = 64;                      // levels up to this size never leave VRAM
+constexpr uint32_t c_EvictionFrames = 120;                      // updates without a request before a texture falls back to its coarse levels
+constexpr uint64_t c_MaxUploadBytesPerUpdate = 64ull << 20;
+constexpr uint32_t c_ReadbackLatency = 2;                       // frames between a feedback copy and its readback
+
+struct CookedTextureHeader
+{
+    uint32_t magic = c_CookedTextureMagic;
+    uint32_t version = c_CookedTextureVersion;
+    uint64_t sourceHash = 0;
+    nvrhi::Format format = nvrhi::Format::UNKNOWN;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 0;
+};
+
+struct CookedTexture
+{
+    nvrhi::Format format = nvrhi::Format::UNKNOWN;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<uint8_t>> levels;
+};
+
+#pragma region Mipmaps
+
+static const std::array<float, 256>& GetSRGBToLinearLUT()
+{
+    static const std::array<float, 256> lut = [] {
+        std::array<float, 256> t;
+        for (uint32_t i = 0; i < t.size(); i++)
+        {
+            float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+
+    return lut;
+}
+
+static uint8_t LinearToSRGB(float c)
+{
+    c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return uint8_t(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+// 2x2 box filter of one RGBA8 level, odd sizes clamp the last row and column.
+// sRGB colors are averaged in linear space, alpha is always linear
+static void DownsampleRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, bool srgb)
+{
+    const auto& lut = GetSRGBToLinearLUT();
+
+    HRay::ParallelFor(dstHeight, 1, [&](uint32_t y) {
+
+        uint32_t y0 = std::min(y * 2, srcHeight - 1);
+        uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+        for (uint32_t x = 0; x < dstWidth; x++)
+        {
+            uint32_t x0 = std::min(x * 2, srcWidth - 1);
+            uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+            const uint8_t* texels[4] = {
+                src + (size_t(y0) * srcWidth + x0) * 4,
+                src + (size_t(y0) * srcWidth + x1) * 4,
+                src + (size_t(y1) * srcWidth + x0) * 4,
+                src + (size_t(y1) * srcWidth + x1) * 4
+            };
+
+            uint8_t* out = dst + (size_t(y) * dstWidth + x) * 4;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                if (srgb && c < 3)
+                {
+                    float sum = lut[texels[0][c]] + lut[texels[1][c]] + lut[texels[2][c]] + lut[texels[3][c]];
+                    out[c] = LinearToSRGB(sum * 0.25f);
+                }
+                else
+                {
+                    uint32_t sum = texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c];
+                    out[c] = uint8_t((sum + 2) / 4);
+                }
+            }
+        }
+    });
+}
+
+static std::vector<std::vector<uint8_t>> BuildMipChain(std::vector<uint8_t> level0, uint32_t width, uint32_t height, bool srgb)
+{
+    HE_PROFILE_FUNCTION();
+
+    uint32_t mipLevels = uint32_t(std::floor(std::log2(std::max(width, height)))) + 1;
+
+    std::vector<std::vector<uint8_t>> levels(mipLevels);
+    levels[0] = std::move(level0);
+
+    for (uint32_t level = 1; level < mipLevels; level++)
+    {
+        uint32_t srcWidth = std::max(width >> (level - 1), 1u);
+        uint32_t srcHeight = std::max(height >> (level - 1), 1u);
+        uint32_t dstWidth = std::max(width >> level, 1u);
+        uint32_t dstHeight = std::max(height >> level, 1u);
+
+        levels[level].resize(size_t(dstWidth) * dstHeight * 4);
+        DownsampleRGBA8(levels[level - 1].data(), srcWidth, srcHeight, levels[level].data(), dstWidth, dstHeight, srgb);
+    }
+
+    return levels;
+}
+
+#pragma endregion
+#pragma region Block Compression
+
+struct BlockWriter
+{
+    uint8_t* block;
+    uint32_t position = 0;
+
+    void Write(uint32_t value, uint32_t bitCount)
+    {
+        for (uint32_t i = 0; i < bitCount; i++, position++)
+        {
+            if ((value >> i) & 1)
+                block[position >> 3] |= uint8_t(1u << (position & 7));
+        }
+    }
+};
+
+// Endpoints along the principal axis of the texels, found by power iteration on their covariance
+template<uint32_t Channels>
+static void FitEndpoints(const float (&texels)[16][4], float (&e0)[4], float (&e1)[4])
+{
+    float mean[4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+        for (uint32_t c = 0; c < Channels; c++)
+            mean[c] += texels[i][c] / 16.0f;
+
+    float covariance[4][4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+        for (uint32_t a = 0; a < Channels; a++)
+            for (uint32_t b = 0; b < Channels; b++)
+                covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+
+    // start from the diagonal of the bounding box, with the channels that are anti-correlated to the dominant one
+    // flipped. A fixed start such as (1, 1, 1, 1) is orthogonal to the axis of a red to green edge
+    float lower[4] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float upper[4] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        for (uint32_t c = 0; c < Channels; c++)
+        {
+            lower[c] = std::min(lower[c], texels[i][c]);
+            upper[c] = std::max(upper[c], texels[i][c]);
+        }
+    }
+
+    uint32_t dominant = 0;
+    for (uint32_t c = 1; c < Channels; c++)
+        if (covariance[c][c] > covariance[dominant][dominant])
+            dominant = c;
+
+    float axis[4] = {};
+    for (uint32_t c = 0; c < Channels; c++)
+        axis[c] = covariance[dominant][c] < 0.0f ? lower[c] - upper[c] : upper[c] - lower[c];
+
+    for (uint32_t iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = {};
+        float length = 0.0f;
+        for (uint32_t a = 0; a < Channels; a++)
+        {
+            for (uint32_t b = 0; b < Channels; b++)
+                next[a] += covariance[a][b] * axis[b];
+            length = std::max(length, std::abs(next[a]));
+        }
+
+        if (length == 0.0f)
+            break;
+
+        for (uint32_t c = 0; c < Channels; c++)
+            axis[c] = next[c] / length;
+    }
+
+    float minT = std::numeric_limits<float>::max();
+    float maxT = std::numeric_limits<float>::lowest();
+    float axisLength2 = 0.0f;
+    for (uint32_t c = 0; c < Channels; c++)
+        axisLength2 += axis[c] * axis[c];
+
+    // flat block, both endpoints are the mean
+    if (axisLength2 == 0.0f)
+    {
+        for (uint32_t c = 0; c < Channels; c++)
+            e0[c] = e1[c] = mean[c];
+        return;
+    }
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (uint32_t c = 0; c < Channels; c++)
+            t += (texels[i][c] - mean[c]) * axis[c];
+        t /= axisLength2;
+
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    for (uint32_t c = 0; c < Channels; c++)
+    {
+        e0[c] = mean[c] + axis[c] * minT;
+        e1[c] = mean[c] + axis[c] * maxT;
+    }
+}
+
+// BC7 mode 6 : 7 bit RGBA endpoints with a shared p-bit each, 4 bit indices
+static void EncodeBC7Block(const float (&texels)[16][4], uint8_t* block)
+{
+    static constexpr uint32_t c_Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    float e[2][4];
+    FitEndpoints<4>(texels, e[0], e[1]);
+
+    // quantize each endpoint to 7 bits, the p-bit is the low bit shared by the 4 channels
+    uint32_t q[2][4];
+    uint32_t p[2];
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        float bestError = std::numeric_limits<float>::max();
+        for (uint32_t pbit = 0; pbit < 2; pbit++)
+        {
+            uint32_t candidate[4];
+            float error = 0.0f;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                float value = std::clamp(e[i][c], 0.0f, 255.0f);
+                candidate[c] = uint32_t(std::clamp(std::round((value - pbit) / 2.0f), 0.0f, 127.0f));
+                float d = value - float((candidate[c] << 1) | pbit);
+                error += d * d;
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                p[i] = pbit;
+                std::copy(std::begin(candidate), std::end(candidate), q[i]);
+            }
+        }
+    }
+
+    uint32_t endpoints[2][4];
+    for (uint32_t i = 0; i < 2; i++)
+        for (uint32_t c = 0; c < 4; c++)
+            endpoints[i][c] = (q[i][c] << 1) | p[i];
+
+    float palette[16][4];
+    for (uint32_t i = 0; i < 16; i++)
+        for (uint32_t c = 0; c < 4; c++)
+            palette[i][c] = float(((64 - c_Weights[i]) * endpoints[0][c] + c_Weights[i] * endpoints[1][c] + 32) >> 6);
+
+    uint32_t indices[16];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        float bestError = std::numeric_limits<float>::max();
+        for (uint32_t j = 0; j < 16; j++)
+        {
+            float error = 0.0f;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                float d = texels[i][c] - palette[j][c];
+                error += d * d;
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = j;
+            }
+        }
+    }
+
+    // the most significant index bit of the first texel is implicit zero
+    if (indices[0] & 8)
+    {
+        std::swap(q[0], q[1]);
+        std::swap(p[0], p[1]);
+        for (uint32_t& index : indices)
+            index = 15 - index;
+    }
+
+    std::fill(block, block + c_BlockSize, 0);
+    BlockWriter writer{ block };
+    writer.Write(1u << 6, 7);
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        writer.Write(q[0][c], 7);
+        writer.Write(q[1][c], 7);
+    }
+    writer.Write(p[0], 1);
+    writer.Write(p[1], 1);
+    for (uint32_t i = 0; i < 16; i++)
+        writer.Write(indices[i], i == 0 ? 3 : 4);
+}
+
+// BC4 : 8 bit endpoints and 3 bit indices into 8 interpolated values, red0 > red1
+static void EncodeBC4Block(const uint8_t (&values)[16], uint8_t* block)
+{
+    uint8_t red0 = *std::max_element(std::begin(values), std::end(values));
+    uint8_t red1 = *std::min_element(std::begin(values), std::end(values));
+
+    std::fill(block, block + 8, 0);
+    block[0] = red0;
+    block[1] = red1;
+
+    if (red0 == red1)
+        return;
+
+    float palette[8];
+    palette[0] = red0;
+    palette[1] = red1;
+    for (uint32_t i = 2; i < 8; i++)
+        palette[i] = ((8 - i) * red0 + (i - 1) * red1) / 7.0f;
+
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t best = 0;
+        for (uint32_t j = 1; j < 8; j++)
+        {
+            if (std::abs(values[i] - palette[j]) < std::abs(values[i] - palette[best]))
+                best = j;
+        }
+
+        bits |= uint64_t(best) << (i * 3);
+    }
+
+    for (uint32_t i = 0; i < 6; i++)
+        block[2 + i] = uint8_t(bits >> (i * 8));
+}
+
+static void EncodeBC5Block(const float (&texels)[16][4], uint8_t* block)
+{
+    uint8_t red[16];
+    uint8_t green[16];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        red[i] = uint8_t(texels[i][0]);
+        green[i] = uint8_t(texels[i][1]);
+    }
+
+    EncodeBC4Block(red, block);
+    EncodeBC4Block(green, block + 8);
+}
+
+// BC6H unsigned halves : negative values and nan flush to zero, the range stops at the largest finite half
+static uint16_t FloatToUnsignedHalf(float value)
+{
+    return HRay::FloatToHalf(value > 0.0f ? std::min(value, 65504.0f) : 0.0f);
+}
+
+// BC6H mode 11 : one region, 10 bit endpoints and 4 bit indices. The endpoints are fitted on the half float bits,
+// which interpolate close to logarithmically
+static void EncodeBC6HBlock(const float (&texels)[16][4], uint8_t* block)
+{
+    static constexpr uint32_t c_Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // values in the unquantized domain of the decoder, half bits scaled by 64 / 31
+    float values[16][4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+        for (uint32_t c = 0; c < 3; c++)
+            values[i][c] = FloatToUnsignedHalf(texels[i][c]) * (64.0f / 31.0f);
+
+    float e[2][4];
+    FitEndpoints<3>(values, e[0], e[1]);
+
+    uint32_t q[2][3];
+    float unquantized[2][3];
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            q[i][c] = uint32_t(std::clamp(std::round((e[i][c] - 32.0f) / 64.0f), 0.0f, 1023.0f));
+            unquantized[i][c] = q[i][c] == 0 ? 0.0f : q[i][c] == 1023 ? 65535.0f : float(q[i][c] * 64 + 32);
+        }
+    }
+
+    uint32_t indices[16];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        float bestError = std::numeric_limits<float>::max();
+        for (uint32_t j = 0; j < 16; j++)
+        {
+            float error = 0.0f;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                float interpolated = ((64 - c_Weights[j]) * unquantized[0][c] + c_Weights[j] * unquantized[1][c] + 32) / 64.0f;
+                float d = values[i][c] - interpolated;
+                error += d * d;
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = j;
+            }
+        }
+    }
+
+    if (indices[0] & 8)
+    {
+        std::swap(q[0], q[1]);
+        for (uint32_t& index : indices)
+            index = 15 - index;
+    }
+
+    std::fill(block, block + c_BlockSize, 0);
+    BlockWriter writer{ block };
+    writer.Write(0x03, 5);
+    for (uint32_t i = 0; i < 2; i++)
+        for (uint32_t c = 0; c < 3; c++)
+            writer.Write(q[i][c], 10);
+    for (uint32_t i = 0; i < 16; i++)
+        writer.Write(indices[i], i == 0 ? 3 : 4);
+}
+
+// Encodes one level block row by block row in parallel, blocks past the edges clamp to the last row and column
+template<typename Texel, typename Encoder>
+static std::vector<uint8_t> EncodeLevel(const Texel* texels, uint32_t width, uint32_t height, Encoder&& encoder)
+{
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+    std::vector<uint8_t> blocks(size_t(blocksWide) * blocksHigh * c_BlockSize);
+
+    HRay::ParallelFor(blocksHigh, 1, [&](uint32_t by) {
+
+        float block[16][4];
+        for (uint32_t bx = 0; bx < blocksWide; bx++)
+        {
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                uint32_t x = std::min(bx * 4 + i % 4, width - 1);
+                uint32_t y = std::min(by * 4 + i / 4, height - 1);
+                const Texel* texel = texels + (size_t(y) * width + x) * 4;
+                for (uint32_t c = 0; c < 4; c++)
+                    block[i][c] = float(texel[c]);
+            }
+
+            encoder(block, blocks.data() + (size_t(by) * blocksWide + bx) * c_BlockSize);
+        }
+    });
+
+    return blocks;
+}
+
+#pragma endregion
+#pragma region Cache
+
+static uint64_t HashTexels(const std::vector<uint8_t>& texels, HRay::TextureKind kind, const nvrhi::TextureDesc& desc)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    auto hashBytes = [&hash](const uint8_t* bytes, size_t size) {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    uint32_t key[4] = { uint32_t(kind), uint32_t(desc.format), desc.width, desc.height };
+    hashBytes(reinterpret_cast<const uint8_t*>(key), sizeof(key));
+    hashBytes(texels.data(), texels.size());
+
+    return hash;
+}
+
+// Reads the header and the level sizes, the level data is read on demand by ReadTextureLevel
+static bool ReadCookedTextureLayout(const std::filesystem::path& filePath, uint64_t sourceHash, HRay::StreamedTexture& streamed)
+{
+    HE_PROFILE_FUNCTION();
+
+    std::error_code ec;
+    uint64_t fileSize = std::filesystem::file_size(filePath, ec);
+    if (ec)
+        return false;
+
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file)
+        return false;
+
+    CookedTextureHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != c_CookedTextureMagic || header.version != c_CookedTextureVersion || header.sourceHash != sourceHash)
+        return false;
+
+    streamed.format = header.format;
+    streamed.width = header.width;
+    streamed.height = header.height;
+    streamed.mipLevels = header.mipLevels;
+    streamed.filePath = filePath;
+    streamed.levelOffsets.resize(header.mipLevels);
+    streamed.levelSizes.resize(header.mipLevels);
+
+    // seeking past the end does not fail the stream, a truncated file is caught by the size
+    uint64_t offset = sizeof(header);
+    for (uint32_t level = 0; level < header.mipLevels; level++)
+    {
+        uint64_t size = 0;
+        file.read(reinterpret_cast<char*>(&size), sizeof(size));
+        offset += sizeof(size);
+        if (!file || size > fileSize - std::min(offset, fileSize))
+            return false;
+
+        streamed.levelOffsets[level] = offset;
+        streamed.levelSizes[level] = size;
+        offset += size;
+        file.seekg(std::streamoff(offset));
+    }
+
+    return bool(file) && offset == fileSize;
+}
+
+static bool SaveCookedTexture(const std::filesystem::path& filePath, uint64_t sourceHash, const CookedTexture& cooked)
+{
+    HE_PROFILE_FUNCTION();
+
+    std::error_code ec;
+    std::filesystem::create_directories(filePath.parent_path(), ec);
+
+    // written next to the cache file and swapped in, a killed writer never leaves a truncated file behind.
+    // Editor instances sharing a project cook into the same directory, each one writes its own temporary file
+    std::random_device random;
+    uint64_t tmpId = (uint64_t(random()) << 32) | random();
+    auto tmpPath = std::filesystem::path(filePath).replace_extension(std::format("{:016x}.tmp", tmpId));
+    {
+        std::ofstream file(tmpPath, std::ios::binary);
+        if (!file)
+        {
+            HE_ERROR("Failed to write cooked texture {}", filePath.string());
+            return false;
+        }
+
+        CookedTextureHeader header;
+        header.sourceHash = sourceHash;
+        header.format = cooked.format;
+        header.width = cooked.width;
+        header.height = cooked.height;
+        header.mipLevels = uint32_t(cooked.levels.size());
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for (const auto& level : cooked.levels)
+        {
+            uint64_t size = level.size();
+            file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            file.write(reinterpret_cast<const char*>(level.data()), size);
+        }
+
+        file.close();
+        if (!file)
+        {
+            HE_ERROR("Failed to write cooked texture {}", filePath.string());
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    // the same texels cook to the same file, losing the race to another instance is fine
+    std::filesystem::rename(tmpPath, filePath, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tmpPath, ec);
+        return std::filesystem::exists(filePath);
+    }
+
+    return true;
+}
+
+static std::vector<uint8_t> ReadTextureLevel(const HRay::StreamedTexture& streamed, uint32_t level)
+{
+    HE_PROFILE_FUNCTION();
+
+    if (!streamed.levels.empty())
+        return streamed.levels[level];
+
+    std::vector<uint8_t> texels(streamed.levelSizes[level]);
+
+    std::ifstream file(streamed.filePath, std::ios::binary);
+    file.seekg(std::streamoff(streamed.levelOffsets[level]));
+    file.read(reinterpret_cast<char*>(texels.data()), texels.size());
+    if (!file)
+        HE_ERROR("Failed to read level {} of cooked texture {}", level, streamed.filePath.string());
+
+    return texels;
+}
+
+#pragma endregion
+
+// Level 0 of the texture, rows tightly packed
+static std::vector<uint8_t> ReadbackTexture(HRay::RendererData& data, nvrhi::ITexture* texture, uint32_t bytesPerPixel)
+{
+    HE_PROFILE_FUNCTION();
+
+    const auto& desc = texture->getDesc();
+    size_t rowSize = size_t(desc.width) * bytesPerPixel;
+    std::vector<uint8_t> texels(rowSize * desc.height);
+
+    auto commandList = data.device->createCommandList({ .enableImmediateExecution = false });
+    commandList->open();
+    nvrhi::StagingTextureHandle stagingTexture = data.device->createStagingTexture(desc, nvrhi::CpuAccessMode::Read);
+    HE_VERIFY(stagingTexture);
+    commandList->copyTexture(stagingTexture, nvrhi::TextureSlice(), texture, nvrhi::TextureSlice());
+    commandList->close();
+    data.device->executeCommandList(commandList);
+
+    size_t rowPitch = 0;
+    void* pData = data.device->mapStagingTexture(stagingTexture, nvrhi::TextureSlice(), nvrhi::CpuAccessMode::Read, &rowPitch);
+    HE_VERIFY(pData);
+
+    for (uint32_t y = 0; y < desc.height; y++)
+        std::memcpy(texels.data() + y * rowSize, reinterpret_cast<const uint8_t*>(pData) + y * rowPitch, rowSize);
+
+    data.device->unmapStagingTexture(stagingTexture);
+
+    return texels;
+}
+
+static CookedTexture Cook(std::vector<uint8_t> texels, const nvrhi::TextureDesc& desc, HRay::TextureKind kind)
+{
+    HE_PROFILE_FUNCTION();
+
+    CookedTexture cooked;
+    cooked.width = desc.width;
+    cooked.height = desc.height;
+
+    // the top level of a block compressed texture must be made of whole blocks
+    bool compress = desc.width % 4 == 0 && desc.height % 4 == 0;
+
+    if (kind == HRay::TextureKind::HDR)
+    {
+        // environment maps are sampled at level 0 only, see EvaluateEnvironmenMap
+        std::vector<float> rgba(size_t(desc.width) * desc.height * 4, 1.0f);
+        uint32_t channels = desc.format == nvrhi::Format::RGB32_FLOAT ? 3 : 4;
+        const float* src = reinterpret_cast<const float*>(texels.data());
+        for (size_t i = 0; i < size_t(desc.width) * desc.height; i++)
+            for (uint32_t c = 0; c < channels; c++)
+                rgba[i * 4 + c] = src[i * channels + c];
+
+        cooked.format = nvrhi::Format::BC6H_UFLOAT;
+        cooked.levels.push_back(EncodeLevel(rgba.data(), desc.width, desc.height, EncodeBC6HBlock));
+
+        return cooked;
+    }
+
+    bool srgb = desc.format == nvrhi::Format::SRGBA8_UNORM || desc.format == nvrhi::Format::SBGRA8_UNORM;
+    bool bgra = desc.format == nvrhi::Format::BGRA8_UNORM || desc.format == nvrhi::Format::SBGRA8_UNORM;
+
+    // the block formats have no BGRA variant
+    if (bgra && compress)
+    {
+        for (size_t i = 0; i < texels.size(); i += 4)
+            std::swap(texels[i], texels[i + 2]);
+    }
+
+    // normals are filtered like colors, the shaders renormalize them
+    cooked.levels = BuildMipChain(std::move(texels), desc.width, desc.height, srgb && kind == HRay::TextureKind::Color);
+
+    if (!compress)
+    {
+        cooked.format = desc.format;
+        return cooked;
+    }
+
+    cooked.format = kind == HRay::TextureKind::Normal ? nvrhi::Format::BC5_UNORM : srgb ? nvrhi::Format::BC7_UNORM_SRGB : nvrhi::Format::BC7_UNORM;
+
+    for (uint32_t level = 0; level < cooked.levels.size(); level++)
+    {
+        uint32_t width = std::max(desc.width >> level, 1u);
+        uint32_t height = std::max(desc.height >> level, 1u);
+        const uint8_t* levelTexels = cooked.levels[level].data();
+
+        if (kind == HRay::TextureKind::Normal)
+            cooked.levels[level] = EncodeLevel(levelTexels, width, height, EncodeBC5Block);
+        else
+            cooked.levels[level] = EncodeLevel(levelTexels, width, height, EncodeBC7Block);
+    }
+
+    return cooked;
+}
+
+#pragma region Streaming
+
+// the top level of a block compressed texture must be made of whole blocks
+static bool IsValidTopLevel(const HRay::StreamedTexture& streamed, uint32_t level)
+{
+    uint32_t blockSize = nvrhi::getFormatInfo(streamed.format).blockSize;
+    return std::max(streamed.width >> level, 1u) % blockSize == 0 && std::max(streamed.height >> level, 1u) % blockSize == 0;
+}
+
+// finest valid top level at or above level, level 0 is always valid
+static uint32_t GetTopLevel(const HRay::StreamedTexture& streamed, uint32_t level)
+{
+    while (level > 0 && !IsValidTopLevel(streamed, level))
+        level--;
+
+    return level;
+}
+
+// coarsest resident level of a texture, kept in VRAM whatever the budget
+static uint32_t GetTailLevel(const HRay::StreamedTexture& streamed)
+{
+    uint32_t level = 0;
+    while (level + 1 < streamed.mipLevels && std::max(streamed.width >> level, streamed.height >> level) > c_MinResidentSize)
+        level++;
+
+    return GetTopLevel(streamed, level);
+}
+
+static uint64_t GetResidentSize(const HRay::StreamedTexture& streamed, uint32_t firstLevel)
+{
+    uint64_t size = 0;
+    for (uint32_t level = firstLevel; level < streamed.mipLevels; level++)
+        size += streamed.levelSizes[level];
+
+    return size;
+}
+
+// Texture holding the levels firstLevel to mipLevels - 1 of a cooked texture. The levels present in previous,
+// which starts at previousFirstLevel, are copied on the GPU and the others are read from the cooked file
+static nvrhi::TextureHandle CreateResidentTexture(
+    HRay::RendererData& data,
+    nvrhi::TextureDesc desc,
+    const HRay::StreamedTexture& streamed,
+    uint32_t firstLevel,
+    nvrhi::ITexture* previous,
+    uint32_t previousFirstLevel,
+    nvrhi::ICommandList* commandList
+)
+{
+    HE_PROFILE_FUNCTION();
+
+    const auto& formatInfo = nvrhi::getFormatInfo(streamed.format);
+
+    desc.format = streamed.format;
+    desc.width = std::max(streamed.width >> firstLevel, 1u);
+    desc.height = std::max(streamed.height >> firstLevel, 1u);
+    desc.mipLevels = streamed.mipLevels - firstLevel;
+    desc.initialState = nvrhi::ResourceStates::ShaderResource;
+    desc.keepInitialState = true;
+    nvrhi::TextureHandle texture = data.device->createTexture(desc);
+    HE_VERIFY(texture);
+
+    for (uint32_t level = firstLevel; level < streamed.mipLevels; level++)
+    {
+        if (previous && level >= previousFirstLevel)
+        {
+            auto dstSlice = nvrhi::TextureSlice().setMipLevel(level - firstLevel);
+            auto srcSlice = nvrhi::TextureSlice().setMipLevel(level - previousFirstLevel);
+            commandList->copyTexture(texture, dstSlice, previous, srcSlice);
+        }
+        else
+        {
+            uint32_t width = std::max(streamed.width >> level, 1u);
+            size_t rowPitch = size_t((width + formatInfo.blockSize - 1) / formatInfo.blockSize) * formatInfo.bytesPerBlock;
+            std::vector<uint8_t> texels = ReadTextureLevel(streamed, level);
+            commandList->writeTexture(texture, 0, level - firstLevel, texels.data(), rowPitch);
+        }
+    }
+
+    return texture;
+}
+
+// swaps the texture of the asset, the descriptor points to the old one and is recreated
+static void SetResidentLevel(HRay::RendererData& data, Assets::Texture* texture, HRay::StreamedTexture& streamed, uint32_t firstLevel, nvrhi::ICommandList* commandList)
+{
+    HE_PROFILE_FUNCTION();
+
+    bool hadDescriptor = texture->descriptor.IsValid();
+
+    nvrhi::TextureHandle resident = CreateResidentTexture(data, texture->texture->getDesc(), streamed, firstLevel, texture->texture, streamed.residentLevel, commandList);
+    HRay::ReleaseTexture(data, texture);
+    texture->texture = resident;
+    streamed.residentLevel = firstLevel;
+
+    if (hadDescriptor)
+    {
+        texture->descriptor = data.descriptorTable->CreateDescriptorHandle(nvrhi::BindingSetItem::Texture_SRV(0, texture->texture));
+        data.textureCount++;
+    }
+}
+
+void HRay::CopyTextureFeedback(RendererData& data, nvrhi::ICommandList* commandList)
+{
+    HE_PROFILE_FUNCTION();
+
+    auto& streaming = data.textureStreaming;
+
+    // several views or an offline render can end a scene in the same frame, the feedback of the later ones
+    // stays in the buffer and goes with the copy of the next frame
+    if (streaming.frame == 0 || streaming.lastCopyFrame == streaming.frame)
+        return;
+
+    uint32_t slot = uint32_t(streaming.frame % streaming.readback.size());
+    commandList->copyBuffer(streaming.readback[slot], 0, streaming.feedback, 0, streaming.feedback->getDesc().byteSize);
+    commandList->clearBufferUInt(streaming.feedback, c_Invalid);
+    streaming.readbackFrame[slot] = streaming.frame;
+    streaming.lastCopyFrame = streaming.frame;
+}
+
+bool HRay::UpdateTextureStreaming(RendererData& data)
+{
+    HE_PROFILE_FUNCTION();
+
+    auto& streaming = data.textureStreaming;
+    streaming.frame++;
+
+    // unloaded textures leave the streamer, the others are looked up by the bindless index the feedback uses
+    std::unordered_map<uint32_t, StreamedTexture*> descriptors;
+    for (auto it = streaming.textures.begin(); it != streaming.textures.end();)
+    {
+        Assets::Texture* texture = data.am->GetAsset<Assets::Texture>(it->first);
+        if (!texture || !texture->texture)
+        {
+            it = streaming.textures.erase(it);
+            continue;
+        }
+
+        if (texture->descriptor.IsValid())
+            descriptors[texture->descriptor.Get()] = &it->second;
+        it++;
+    }
+
+    // the copies of the last frames are still in flight, mapping them would wait for the GPU
+    for (uint32_t slot = 0; slot < streaming.readback.size(); slot++)
+    {
+        uint64_t copyFrame = streaming.readbackFrame[slot];
+        if (copyFrame == 0 || streaming.frame - copyFrame < c_ReadbackLatency)
+            continue;
+
+        const uint32_t* feedback = static_cast<const uint32_t*>(data.device->mapBuffer(streaming.readback[slot], nvrhi::CpuAccessMode::Read));
+        HE_ASSERT(feedback);
+
+        for (auto [index, streamed] : descriptors)
+        {
+            if (index >= c_TextureFeedbackCapacity || feedback[index] == c_Invalid)
+                continue;
+
+            // same encoding as RecordTextureFeedback, the texture size turns the lod into a level of the full chain
+            float lod = feedback[index] / 64.0f - 32.0f + 0.5f * std::log2(float(streamed->width) * float(streamed->height));
+            uint32_t level = std::min(uint32_t(std::max(lod, 0.0f)), streamed->mipLevels - 1);
+
+            streamed->requestedLevel = streamed->lastRequestFrame == streaming.frame ? std::min(streamed->requestedLevel, level) : level;
+            streamed->lastRequestFrame = streaming.frame;
+        }
+
+        data.device->unmapBuffer(streaming.readback[slot]);
+        streaming.readbackFrame[slot] = 0;
+    }
+
+    auto getTargetLevel = [&](const StreamedTexture& streamed) {
+
+        if (!streaming.enable)
+            return 0u;
+
+        uint32_t tail = GetTailLevel(streamed);
+        if (streaming.frame - streamed.lastRequestFrame > c_EvictionFrames)
+            return tail;
+
+        return GetTopLevel(streamed, std::min(streamed.requestedLevel, tail));
+    };
+
+    // levels that are no longer requested are dropped first, they make room for the ones that are
+    std::vector<std::pair<Assets::AssetHandle, uint32_t>> changes;
+    std::vector<std::pair<Assets::AssetHandle, StreamedTexture*>> candidates;
+    uint64_t residentBytes = 0;
+
+    for (auto& [handle, streamed] : streaming.textures)
+    {
+        uint32_t target = getTargetLevel(streamed);
+        if (target > streamed.residentLevel)
+        {
+            changes.push_back({ handle, target });
+            residentBytes += GetResidentSize(streamed, target);
+        }
+        else
+        {
+            residentBytes += GetResidentSize(streamed, streamed.residentLevel);
+            if (target < streamed.residentLevel)
+                candidates.push_back({ handle, &streamed });
+        }
+    }
+
+    // most recently requested first. Requests that do not fit the budget wait, the resident textures are not evicted
+    // for them : the set of textures in view changes slowly and evicting here would stream the same levels back and forth
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return a.second->lastRequestFrame > b.second->lastRequestFrame;
+    });
+
+    bool streamedIn = false;
+    uint64_t uploadBytes = 0;
+    for (auto& [handle, streamed] : candidates)
+    {
+        uint32_t target = getTargetLevel(*streamed);
+        uint64_t size = GetResidentSize(*streamed, target) - GetResidentSize(*streamed, streamed->residentLevel);
+
+        if (streaming.enable && residentBytes + size > streaming.budget)
+            continue;
+
+        if (uploadBytes > 0 && uploadBytes + size > c_MaxUploadBytesPerUpdate)
+            break;
+
+        changes.push_back({ handle, target });
+        residentBytes += size;
+        uploadBytes += size;
+        streamedIn = true;
+    }
+
+    streaming.residentBytes = residentBytes;
+
+    if (changes.empty())
+        return false;
+
+    auto commandList = data.device->createCommandList();
+    commandList->open();
+    for (auto& [handle, level] : changes)
+        SetResidentLevel(data, data.am->GetAsset<Assets::Texture>(handle), streaming.textures.at(handle), level, commandList);
+    commandList->close();
+    data.device->executeCommandList(commandList);
+
+    return streamedIn;
+}
+
+bool HRay::MakeTexturesResident(RendererData& data)
+{
+    HE_PROFILE_FUNCTION();
+
+    auto& streaming = data.textureStreaming;
+
+    std::vector<Assets::AssetHandle> changes;
+    for (auto& [handle, streamed] : streaming.textures)
+    {
+        Assets::Texture* texture = data.am->GetAsset<Assets::Texture>(handle);
+        if (texture && texture->texture && streamed.residentLevel > 0)
+            changes.push_back(handle);
+    }
+
+    if (changes.empty())
+        return false;
+
+    auto commandList = data.device->createCommandList();
+    commandList->open();
+    for (auto& handle : changes)
+    {
+        auto& streamed = streaming.textures.at(handle);
+        streaming.residentBytes += GetResidentSize(streamed, 0) - GetResidentSize(streamed, streamed.residentLevel);
+        SetResidentLevel(data, data.am->GetAsset<Assets::Texture>(handle), streamed, 0, commandList);
+    }
+    commandList->close();
+    data.device->executeCommandList(commandList);
+
+    return true;
+}
+
+#pragma endregion
+
+void HRay::CookTexture(RendererData& data, Assets::AssetHandle handle, TextureKind kind)
+{
+    HE_PROFILE_FUNCTION();
+
+    Assets::Texture* texture = data.am->GetAsset<Assets::Texture>(handle);
+    if (!texture || !texture->texture)
+        return;
+
+    nvrhi::TextureDesc desc = texture->texture->getDesc();
+
+    // already cooked, or authored with its own mips
+    if (desc.mipLevels > 1 || nvrhi::getFormatInfo(desc.format).blockSize > 1 || desc.dimension != nvrhi::TextureDimension::Texture2D)
+        return;
+
+    // reloaded since it was cooked
+    data.textureStreaming.textures.erase(handle);
+
+    uint32_t bytesPerPixel = 0;
+    switch (desc.format)
+    {
+    case nvrhi::Format::RGBA8_UNORM:
+    case nvrhi::Format::SRGBA8_UNORM:
+    case nvrhi::Format::BGRA8_UNORM:
+    case nvrhi::Format::SBGRA8_UNORM:  bytesPerPixel = kind != TextureKind::HDR ? 4 : 0;  break;
+    case nvrhi::Format::RGB32_FLOAT:   bytesPerPixel = kind == TextureKind::HDR ? 12 : 0; break;
+    case nvrhi::Format::RGBA32_FLOAT:  bytesPerPixel = kind == TextureKind::HDR ? 16 : 0; break;
+    default: break;
+    }
+
+    bool wholeBlocks = desc.width % 4 == 0 && desc.height % 4 == 0;
+    if (bytesPerPixel == 0 || (kind == TextureKind::HDR && !wholeBlocks) || std::max(desc.width, desc.height) < 2)
+        return;
+
+    std::vector<uint8_t> texels = ReadbackTexture(data, texture->texture, bytesPerPixel);
+    uint64_t sourceHash = HashTexels(texels, kind, desc);
+    data.textureHashes[handle] = sourceHash;
+
+    // the triangle opacity classification of SubmitMesh reads the alpha of the base color textures
+    if (kind == TextureKind::Color)
+    {
+        AlphaMap& alphaMap = data.alphaMaps[handle];
+        alphaMap = BuildAlphaMap(texels, desc.width, desc.height);
+        alphaMap.sourceHash = sourceHash;
+    }
+
+    std::filesystem::path cachePath;
+    if (!data.textureCacheDir.empty())
+        cachePath = data.textureCacheDir / std::format("{:016x}.htx", sourceHash);
+
+    StreamedTexture streamed;
+    if (cachePath.empty() || !ReadCookedTextureLayout(cachePath, sourceHash, streamed))
+    {
+        CookedTexture cooked = Cook(std::move(texels), desc, kind);
+
+        // without a writable cache the levels stay in memory to be streamed from there
+        if (cachePath.empty() || data.textureCacheReadOnly || !SaveCookedTexture(cachePath, sourceHash, cooked) || !ReadCookedTextureLayout(cachePath, sourceHash, streamed))
+        {
+            streamed.format = cooked.format;
+            streamed.width = cooked.width;
+            streamed.height = cooked.height;
+            streamed.mipLevels = uint32_t(cooked.levels.size());
+            streamed.filePath.clear();
+            streamed.levelOffsets.assign(streamed.mipLevels, 0);
+            streamed.levelSizes.resize(streamed.mipLevels);
+            for (uint32_t level = 0; level < streamed.mipLevels; level++)
+                streamed.levelSizes[level] = cooked.levels[level].size();
+            streamed.levels = std::move(cooked.levels);
+        }
+    }
+
+    // streamed textures start from their coarse levels, the feedback of the next frames requests the finer ones
+    bool streaming = data.textureStreaming.enable && streamed.mipLevels > 1;
+    streamed.residentLevel = streaming ? GetTailLevel(streamed) : 0;
+    streamed.requestedLevel = streamed.residentLevel;
+    streamed.lastRequestFrame = data.textureStreaming.frame;
+
+    auto commandList = data.device->createCommandList();
+    commandList->open();
+    nvrhi::TextureHandle cookedTexture = CreateResidentTexture(data, desc, streamed, streamed.residentLevel, nullptr, 0, commandList);
+    commandList->close();
+    data.device->executeCommandList(commandList);
+
+    // the descriptor points to the old texture, the caller creates a new one
+    ReleaseTexture(data, texture);
+    texture->texture = cookedTexture;
+
+    // single level textures, the HDR environment maps, are not streamed
+    if (streamed.mipLevels > 1)
+    {
+        data.textureStreaming.residentBytes += GetResidentSize(streamed, streamed.residentLevel);
+        data.textureStreaming.textures[handle] = std::move(streamed);
+    }
+}
@@ -13,6 +13,7 @@ import HE;
 import nvrhi;
 import Assets;
 import ImGui;
+import HRay;
 import Editor;
 import std;
 import Tiny2D;
@@ -53,6 +54,9 @@ void Editor::ViewPortWindow::OnCreate()
     flyCamera = HE::CreateScope<Editor::FlyCamera>(60.0f, float(width) / float(height), 0.1f, 1000.0f);
     editorCamera = orbitCamera;
 
+    // compositing and picking read the depth and entity ID targets
+    fd.enableDepthAndIDTargets = true;
+
     auto& ctx = GetContext();
 
     // Binding Layout
@@ -121,6 +125,122 @@ static void DrawIcon(
     });
 }
 
+// Object-space debug line data, built once per mesh and reused every frame until the mesh source is reloaded
+struct MeshDebugLines
+{
+    std::vector<Math::float3> positions;
+    std::vector<Math::float3> normals;
+    std::vector<Math::float3> tangents;
+    std::vector<Math::float3> bitangents;
+};
+
+struct MeshDebugLinesCache
+{
+    std::unordered_map<uint32_t, MeshDebugLines> meshes;
+};
+
+void Editor::InvalidateMeshDebugLines(Assets::Asset asset)
+{
+    if (asset.Has<MeshDebugLinesCache>())
+        asset.Get<MeshDebugLinesCache>().meshes.clear();
+}
+
+static const MeshDebugLines& GetOrCreateMeshDebugLines(Assets::Asset asset, Assets::Mesh& mesh, uint32_t meshIndex)
+{
+    if (!asset.Has<MeshDebugLinesCache>())
+        asset.Add<MeshDebugLinesCache>();
+
+    auto& cache = asset.Get<MeshDebugLinesCache>();
+    auto it = cache.meshes.find(meshIndex);
+    if (it != cache.meshes.end())
+        return it->second;
+
+    HE_PROFILE_SCOPE("GetOrCreateMeshDebugLines");
+
+    auto positions = mesh.GetAttributeSpan<Math::float3>(Assets::VertexAttribute::Position);
+    auto normals = mesh.GetAttributeSpan<uint32_t>(Assets::VertexAttribute::Normal);
+    auto tangents = mesh.GetAttributeSpan<uint32_t>(Assets::VertexAttribute::Tangent);
+
+    auto& lines = cache.meshes[meshIndex];
+    uint32_t count = (uint32_t)positions.size();
+    lines.positions.assign(positions.begin(), positions.end());
+    lines.normals.resize(count);
+    lines.tangents.resize(count);
+    lines.bitangents.resize(count);
+
+    HRay::ParallelFor(count, 4096, [&](uint32_t i) {
+
+        Math::float3 normal = Math::normalize(Math::snorm8ToVector<3>(normals[i]));
+        Math::float4 tangent = Math::snorm8ToVector<4>(tangents[i]);
+        Math::float3 tangentVec = Math::normalize(Math::float3(tangent.x, tangent.y, tangent.z));
+
+        lines.normals[i] = normal;
+        lines.tangents[i] = tangentVec;
+        lines.bitangents[i] = Math::normalize(Math::cross(normal, tangentVec) * tangent.w);
+    });
+
+    return lines;
+}
+
+// Picks a vertex stride so that roughly one line is drawn per (spacing x spacing) pixels covered by the mesh
+static uint32_t ComputeDebugLineStride(const Math::float4x4& mvp, const Math::box3& aabb, int width, int height, float spacing, uint32_t vertexCount)
+{
+    Math::float2 minPx = { float(width), float(height) };
+    Math::float2 maxPx = { 0.0f, 0.0f };
+
+    for (int i = 0; i < 8; i++)
+    {
+        Math::float3 corner = {
+            (i & 1) ? aabb.max.x : aabb.min.x,
+            (i & 2) ? aabb.max.y : aabb.min.y,
+            (i & 4) ? aabb.max.z : aabb.min.z
+        };
+
+        Math::float4 clip = mvp * Math::float4(corner, 1.0f);
+        if (clip.w <= 0.0f)
+        {
+            // box crosses the camera plane, assume it covers the whole view
+            minPx = { 0.0f, 0.0f };
+            maxPx = { float(width), float(height) };
+            break;
+        }
+
+        Math::float2 px = (Math::float2(clip.x, clip.y) / clip.w * 0.5f + 0.5f) * Math::float2(float(width), float(height));
+        minPx = Math::min(minPx, px);
+        maxPx = Math::max(maxPx, px);
+    }
+
+    minPx = Math::clamp(minPx, Math::float2(0.0f), Math::float2(float(width), float(height)));
+    maxPx = Math::clamp(maxPx, Math::float2(0.0f), Math::float2(float(width), float(height)));
+    Math::float2 extent = Math::max(maxPx - minPx, Math::float2(1.0f));
+
+    float maxLines = std::max(extent.x * extent.y / (spacing * spacing), 1.0f);
+
+    return std::max(uint32_t(std::ceil(float(vertexCount) / maxLines)), 1u);
+}
+
+static void DrawMeshDebugLines(const std::vector<Math::float3>& positions, const std::vector<Math::float3>& directions, const Math::float4x4& wt, uint32_t stride, float lineLength, const Math::float4& color)
+{
+    HE_PROFILE_FUNCTION();
+
+    uint32_t lineCount = ((uint32_t)positions.size() + stride - 1) / stride;
+    std::vector<Math::float3> points(lineCount * 2);
+
+    Math::float3x3 normalMatrix = Math::float3x3(wt);
+
+    HRay::ParallelFor(lineCount, 4096, [&](uint32_t i) {
+
+        uint32_t v = i * stride;
+        Math::float3 position = wt * Math::float4(positions[v], 1.0f);
+        Math::float3 direction = Math::normalize(normalMatrix * directions[v]);
+
+        points[i * 2 + 0] = position;
+        points[i * 2 + 1] = position + direction * lineLength;
+    });
+
+    Tiny2D::DrawLineList(points, color);
+}
+
 void Editor::ViewPortWindow::OnUpdate(HE::Timestep ts)
 {
     auto& ctx = GetContext();
@@ -182,18 +302,17 @@ void Editor::ViewPortWindow::OnUpdate(HE::Timestep ts)
                 pixelReadbackPass.Init(ctx.device);
 
             {
-                auto format = HRay::GetColorTarget(fd)->getDesc().format;
-
                 if (!compositeTarget)
-                    CreateOrResizeRenderTarget(this, format, width, height);
+                    CreateOrResizeRenderTarget(this, HRay::c_ColorTargetFormat, width, height);
 
+                // the 8x MSAA overlay only draws flat colored lines and icons, 8 bits are enough
                 Tiny2D::BeginScene(
                     tiny2DView,
                     ctx.commandList,
                     {
                         projectionMatrix * viewMatrix,
                         { width, height },
-                        format,
+                        nvrhi::Format::RGBA8_UNORM,
                         8
                     }
                 );
@@ -291,7 +410,7 @@ void Editor::ViewPortWindow::OnUpdate(HE::Timestep ts)
                         auto& meshSource = asset.Get<Assets::MeshSource>();
                         auto& mesh = meshSource.meshes[dm.meshIndex];
 
-                        HRay::SubmitMesh(ctx.rd, fd, asset, mesh, wt, (uint32_t)e, ctx.commandList);
+                        HRay::SubmitMesh(ctx.rd, fd, asset, mesh, wt, (uint32_t)e, ctx.commandList, Editor::GetInstanceMask(entity));
 
                         if (debug.enableMeshAABB)
                         {
@@ -306,64 +425,17 @@ void Editor::ViewPortWindow::OnUpdate(HE::Timestep ts)
 
                         if (debug.enableMeshNormals || debug.enableMeshTangents || debug.enableMeshBitangents)
                         {
-                            auto positions = mesh.GetAttributeSpan<Math::float3>(Assets::VertexAttribute::Position);
-                            auto normals = mesh.GetAttributeSpan<uint32_t>(Assets::VertexAttribute::Normal);
-                            auto tangents = mesh.GetAttributeSpan<uint32_t>(Assets::VertexAttribute::Tangent);
-
-                            if (debug.enableMeshBitangents || debug.enableMeshTangents || debug.enableMeshNormals)
-                            {
-                                for (uint32_t i = 0; i < positions.size(); i++)
-                                {
-                                    Math::float4 pos = wt * Math::float4(positions[i], 1.0f);
-                                    Math::float3 position = { pos.x, pos.y, pos.z };
-
-                                    Math::float3 normal = Math::snorm8ToVector<3>(normals[i]);
-                                    normal = wt * Math::float4(normal, 0.0f);
-                                    normal = Math::normalize(normal);
+                            const auto& lines = GetOrCreateMeshDebugLines(asset, mesh, dm.meshIndex);
+                            uint32_t stride = ComputeDebugLineStride(projectionMatrix * viewMatrix * wt, mesh.aabb, width, height, debug.lineSpacing, (uint32_t)lines.positions.size());
 
-                                    Math::float4 tang = Math::snorm8ToVector<4>(tangents[i]);
-                                    Math::float4 tangent = { tang.x, tang.y, tang.z, tang.w };
+                            if (debug.enableMeshNormals)
+                                DrawMeshDebugLines(lines.positions, lines.normals, wt, stride, debug.lineLength, Math::float4(1.0f, 0.0f, 0.0f, debug.colorOpacity));
 
-                                    Math::float3 tangentVec = wt * Math::float4(tangent.x, tangent.y, tangent.z, 0);
-                                    Math::float3 bitangentVec = Math::cross(normal, tangentVec) * tangent.w;
-
-                                    tangentVec = Math::normalize(tangentVec);
-                                    bitangentVec = Math::normalize(bitangentVec);
-
-                                    if (debug.enableMeshNormals)
-                                    {
-                                        Tiny2D::DrawLine({
-                                            .from = position,
-                                            .to = position + normal * debug.lineLength,
-                                            .fromColor = Math::float4(1.0f,0.0f, 0.0f, debug.colorOpacity),
-                                            .toColor = Math::float4(1.0f,0.0f, 0.0f, debug.colorOpacity),
-                                            .thickness = 1.0f
-                                        });
-                                    }
+                            if (debug.enableMeshTangents)
+                                DrawMeshDebugLines(lines.positions, lines.tangents, wt, stride, debug.lineLength, Math::float4(0.0f, 1.0f, 0.0f, debug.colorOpacity));
 
-                                    if (debug.enableMeshTangents)
-                                    {
-                                        Tiny2D::DrawLine({
-                                            .from = position,
-                                            .to = position + tangentVec * debug.lineLength,
-                                            .fromColor = Math::float4(0.0f,1.0f, 0.0f, debug.colorOpacity),
-                                            .toColor = Math::float4(0.0f, 1.0f, 0.0f, debug.colorOpacity),
-                                            .thickness = 1.0f
-                                        });
-                                    }
-
-                                    if (debug.enableMeshBitangents)
-                                    {
-                                        Tiny2D::DrawLine({
-                                            .from = position,
-                                            .to = position + bitangentVec * debug.lineLength,
-                                            .fromColor = Math::float4(0.0f, 0.0f, 1.0f, debug.colorOpacity),
-                                            .toColor = Math::float4(0.0f, 0.0f, 1.0f, debug.colorOpacity),
-                                            .thickness = 1.0f
-                                        });
-                                    }
-                                }
-                            }
+                            if (debug.enableMeshBitangents)
+                                DrawMeshDebugLines(lines.positions, lines.bitangents, wt, stride, debug.lineLength, Math::float4(0.0f, 0.0f, 1.0f, debug.colorOpacity));
                         }
                     }
                 }
@@ -432,11 +504,12 @@ void Editor::ViewPortWindow::OnUpdate(HE::Timestep ts)
                 HE_ASSERT(compositeTarget);
                 if ((width > 0 && height > 0) && (width != compositeTarget->getDesc().width || height != compositeTarget->getDesc().height))
                 {
-                    auto format = HRay::GetColorTarget(fd)->getDesc().format;
-                    CreateOrResizeRenderTarget(this, format, width, height);
+                    CreateOrResizeRenderTarget(this, HRay::c_ColorTargetFormat, width, height);
                 }
             }
 
+            // the renderer creates its targets on the first frame with a non empty view
+            if (HRay::GetColorTarget(fd))
             {
                 if (!compositeBindingSet)
                 {
@@ -766,6 +839,7 @@ void Editor::ViewPortWindow::OnUpdate(HE::Timestep ts)
 
                             ImField::Checkbox("Stats", &debug.enableStats);
                             ImField::DragFloat("Line Length", &debug.lineLength, 0.001f, 0.01f, 1.0f);
+                            ImField::DragFloat("Line Spacing", &debug.lineSpacing, 0.1f, 1.0f, 64.0f);
                             ImField::DragFloat("Color Opacity", &debug.colorOpacity, 0.001f, 0.1f, 1.0f);
 
                             ImGui::EndTable();
@@ -958,6 +1032,14 @@ void Editor::ViewPortWindow::OnUpdate(HE::Timestep ts)
 
                 ImGui::Text("width/height %i / %i", compositeTarget->getDesc().width, compositeTarget->getDesc().height);
                 ImGui::Text("lines %i | quads %i | boxes %i", stats.LineCount, stats.quadCount, stats.boxCount);
+
+                const auto& streaming = ctx.rd.textureStreaming;
+                ImGui::Text("textures %i | streamed %i | resident %.1f / %.1f MB", ctx.rd.textureCount, (int)streaming.textures.size(), streaming.residentBytes / float(1 << 20), streaming.budget / float(1 << 20));
+
+                const auto& rs = fd.stats;
+                ImGui::Text("instances %u | geometries %u | materials %u | descriptors %u / %u", rs.instanceCount, rs.geometryCount, rs.materialCount, rs.descriptorCount, rs.descriptorCapacity);
+                ImGui::Text("upload %.2f MB | BLAS builds %u | VRAM buffers %.1f MB textures %.1f MB AS %.1f MB", rs.uploadBytes / float(1 << 20), rs.blasBuildCount,
+                    rs.bufferBytes / float(1 << 20), rs.textureBytes / float(1 << 20), (rs.blasBytes + rs.tlasBytes) / float(1 << 20));
             }
 
             if (appStats.FPS < 30) ImGui::PushStyleColor(ImGuiCol_Text, GetColor(Color::Dangerous));
@@ -1185,6 +1267,7 @@ void Editor::ViewPortWindow::Serialize(std::ostringstream& out)
         out << "\t\t\t\"enableMeshAABB\" : " << (debug.enableMeshAABB ? "true" : "false") << ",\n";
         out << "\t\t\t\"enableStats\" : " << (debug.enableStats ? "true" : "false") << ",\n";
         out << "\t\t\t\"lineLength\" : " << debug.lineLength << ",\n";
+        out << "\t\t\t\"lineSpacing\" : " << debug.lineSpacing << ",\n";
         out << "\t\t\t\"colorOpacity\" : " << debug.colorOpacity << "\n";
     }
     out << "\t\t},\n";
@@ -1318,6 +1401,9 @@ void Editor::ViewPortWindow::Deserialize(simdjson::dom::element element)
         if (!debugElement["lineLength"].error())
             debug.lineLength = (float)debugElement["lineLength"].get_double().value();
 
+        if (!debugElement["lineSpacing"].error())
+            debug.lineSpacing = (float)debugElement["lineSpacing"].get_double().value();
+
         if (!debugElement["colorOpacity"].error())
             debug.colorOpacity = (float)debugElement["colorOpacity"].get_double().value();
     }
@@ -1691,6 +1777,26 @@ void Editor::InspectorWindow::OnUpdate(HE::Timestep ts)
                         if (ImField::InputUInt("Index", &dm.meshIndex)) Editor::Clear();
                     }
 
+                    // ray classes that see the instance
+                    {
+                        uint32_t mask = Editor::GetInstanceMask(selectedEntity);
+                        bool camera = mask & HRay::c_instanceMaskCamera;
+                        bool indirect = mask & HRay::c_instanceMaskIndirect;
+                        bool reflection = mask & HRay::c_instanceMaskReflection;
+
+                        bool changed = false;
+                        changed |= ImField::Checkbox("Camera Visible", &camera);
+                        changed |= ImField::Checkbox("Indirect Visible", &indirect);
+                        changed |= ImField::Checkbox("Reflection Visible", &reflection);
+
+                        if (changed)
+                        {
+                            mask = (camera ? HRay::c_instanceMaskCamera : 0) | (indirect ? HRay::c_instanceMaskIndirect : 0) | (reflection ? HRay::c_instanceMaskReflection : 0);
+                            Editor::SetInstanceMask(selectedEntity, mask);
+                            Editor::Clear();
+                        }
+                    }
+
                     ImGui::EndTable();
                 }
             }
@@ -2121,6 +2227,42 @@ void Editor::RendererSettingsWindow::OnUpdate(HE::Timestep ts)
     
             if (ImField::DragInt("Max Lighte Bounces", &ctx.fd.sceneInfo.settings.maxLighteBounces)) Editor::Clear();
             if (ImField::DragInt("Max Samples", &ctx.fd.sceneInfo.settings.maxSamples)) Editor::Clear();
+
+            {
+                int selected = 0;
+                auto currentTypeStr = magic_enum::enum_name<HRay::SamplerType>(ctx.fd.sceneInfo.settings.samplerType);
+                auto types = magic_enum::enum_names<HRay::SamplerType>();
+                if (ImField::Combo("Sampler", types, currentTypeStr, selected))
+                {
+                    ctx.fd.sceneInfo.settings.samplerType = magic_enum::enum_cast<HRay::SamplerType>(types[selected]).value();
+
+                    Editor::Clear();
+                }
+            }
+
+            {
+                int selected = 0;
+                auto currentTypeStr = magic_enum::enum_name<HRay::IntegratorType>(ctx.fd.integrator);
+                auto types = magic_enum::enum_names<HRay::IntegratorType>();
+                if (ImField::Combo("Integrator", types, currentTypeStr, selected))
+                {
+                    ctx.fd.integrator = magic_enum::enum_cast<HRay::IntegratorType>(types[selected]).value();
+
+                    Editor::Clear();
+                }
+            }
+
+            if (ImField::Checkbox("Compensated Summation", &ctx.fd.sceneInfo.settings.enableCompensatedSummation)) Editor::Clear();
+
+            ImField::Checkbox("Texture Streaming", &ctx.rd.textureStreaming.enable);
+            {
+                int budget = int(ctx.rd.textureStreaming.budget >> 20);
+                if (ImField::DragInt("Texture Budget MB", &budget))
+                    ctx.rd.textureStreaming.budget = uint64_t(Math::max(budget, 64)) << 20;
+            }
+
+            if (ImField::Checkbox("Quantized Vertices", &ctx.rd.quantizeVertices)) Editor::Clear();
+
             if (ImField::DragFloat("Exposure", &ctx.fd.sceneInfo.postProssing.exposure)) Editor::Clear();
             if (ImField::DragFloat("Gamma", &ctx.fd.sceneInfo.postProssing.gamma)) Editor::Clear();
 
@@ -2147,12 +2289,44 @@ void Editor::RendererSettingsWindow::OnUpdate(HE::Timestep ts)
         {
             if (ImField::DragInt("Width", &ctx.width)) Editor::Clear();
             if (ImField::DragInt("Height", &ctx.height)) Editor::Clear();
+            if (ImField::DragInt("Tile Size", &ctx.tileSize)) ctx.tileSize = Math::max(ctx.tileSize, 0);
 
             ImField::DragInt("Frame Start", &ctx.frameStart);
             ImField::DragInt("Frame End", &ctx.frameEnd);
             ImField::DragInt("Frame Step", &ctx.frameStep);
             ImField::DragInt("Max Samples", &ctx.maxSamples);
 
+            {
+                int selected = 0;
+                auto currentStr = magic_enum::enum_name<OutputFormat>(ctx.outputFormat);
+                auto types = magic_enum::enum_names<OutputFormat>();
+                if (ImField::Combo("Format", types, currentStr, selected))
+                    ctx.outputFormat = magic_enum::enum_cast<OutputFormat>(types[selected]).value();
+            }
+
+            if (ctx.outputFormat == OutputFormat::EXR)
+            {
+                {
+                    int selected = 0;
+                    auto currentStr = magic_enum::enum_name<EXRPixelType>(ctx.exrPixelType);
+                    auto types = magic_enum::enum_names<EXRPixelType>();
+                    if (ImField::Combo("Pixel Type", types, currentStr, selected))
+                        ctx.exrPixelType = magic_enum::enum_cast<EXRPixelType>(types[selected]).value();
+                }
+
+                {
+                    int selected = 0;
+                    auto currentStr = magic_enum::enum_name<EXRCompression>(ctx.exrCompression);
+                    auto types = magic_enum::enum_names<EXRCompression>();
+                    if (ImField::Combo("Compression", types, currentStr, selected))
+                        ctx.exrCompression = magic_enum::enum_cast<EXRCompression>(types[selected]).value();
+                }
+            }
+
+            ImField::Checkbox("Checkpoints", &ctx.enableCheckpoints);
+            if (ctx.enableCheckpoints)
+                ImField::DragFloat("Checkpoint Interval", &ctx.checkpointInterval, 1.0f, 10.0f, 3600.0f);
+
             ImGui::EndTable();
         }
 
@@ -2218,15 +2392,62 @@ void Editor::RendererSettingsWindow::OnUpdate(HE::Timestep ts)
     }
     ImField::EndBlock();
 
+    if (ImField::BeginBlock("Distributed"))
+    {
+        auto& dr = ctx.distributed;
+
+        if (ImGui::BeginTable("Distributed", 2, ImGuiTableFlags_SizingFixedFit))
+        {
+            ImField::DragInt("Workers", &dr.workerCount);
+
+            {
+                int selected = 0;
+                auto currentStr = magic_enum::enum_name<DistributedMode>(dr.mode);
+                auto types = magic_enum::enum_names<DistributedMode>();
+                if (ImField::Combo("Mode", types, currentStr, selected))
+                    dr.mode = magic_enum::enum_cast<DistributedMode>(types[selected]).value();
+            }
+
+            ImGui::EndTable();
+        }
+
+        {
+            ImGui::Indent(8);
+            ImGui::ScopedStyle fp(ImGuiStyleVar_FramePadding, ImVec2(4, 4));
+
+            ImGui::BeginDisabled(dr.active || ctx.sceneMode == SceneMode::Runtime);
+            if (ImGui::Button("Render Distributed", { -1 , 0 }))
+                Editor::RenderDistributed();
+            ImGui::EndDisabled();
+
+            if (dr.active)
+                ImGui::Text("%d worker(s) running", dr.workers->running.load());
+
+            ImGui::Unindent(8);
+        }
+    }
+    ImField::EndBlock();
+
     if (ImField::BeginBlock("Stats"))
     {
         if (ImGui::BeginTable("Scene", 2, ImGuiTableFlags_SizingFixedFit))
         {
-            //ImField::Text("Geometry Count", "%zd", ctx.rd.geometryCount);
-            //ImField::Text("Instance Count", "%zd", ctx.rd.instanceCount);
-            //ImField::Text("Material Count", "%zd", ctx.rd.materialCount);
-            //ImField::Text("Texture Count", "%zd", ctx.rd.textureCount);
-            //ImField::Text("Directional Light Count", "%zd", ctx.rd.sceneInfo.light.directionalLightCount);
+            // last frame of the render, the viewports show their own in their stats overlay
+            const auto& stats = ctx.fd.stats;
+            constexpr float c_MB = float(1 << 20);
+
+            ImField::Text("Instance Count", "%u", stats.instanceCount);
+            ImField::Text("Geometry Count", "%u", stats.geometryCount);
+            ImField::Text("Material Count", "%u", stats.materialCount);
+            ImField::Text("Texture Count", "%u", ctx.rd.textureCount);
+            ImField::Text("Directional Light Count", "%u", stats.directionalLightCount);
+            ImField::Text("Upload", "%.2f MB", stats.uploadBytes / c_MB);
+            ImField::Text("BLAS Builds", "%u | %.2f MB", stats.blasBuildCount, stats.blasBuildBytes / c_MB);
+            ImField::Text("TLAS Builds", "%u | %.2f MB", stats.tlasBuildCount, stats.tlasBytes / c_MB);
+            ImField::Text("BLAS Memory", "%.2f MB", stats.blasBytes / c_MB);
+            ImField::Text("Buffer Memory", "%.2f MB", stats.bufferBytes / c_MB);
+            ImField::Text("Texture Memory", "%.2f MB", stats.textureBytes / c_MB);
+            ImField::Text("Descriptors", "%u / %u", stats.descriptorCount, stats.descriptorCapacity);
 
             Assets::Scene* scene = ctx.assetManager.GetAsset<Assets::Scene>(ctx.sceneHandle);
             if (scene)
@@ -2246,6 +2467,20 @@ void Editor::RendererSettingsWindow::OnUpdate(HE::Timestep ts)
 
             ImGui::EndTable();
         }
+
+        {
+            ImGui::Indent(8);
+            ImGui::ScopedStyle fp(ImGuiStyleVar_FramePadding, ImVec2(4, 4));
+
+            if (ImGui::Button("Export Stats", { -1 , 0 }))
+            {
+                auto file = HE::FileDialog::SaveFile({ { "json", "json" } });
+                if (!file.empty())
+                    Editor::WriteRendererStats(file);
+            }
+
+            ImGui::Unindent(8);
+        }
     }
     ImField::EndBlock();
 }
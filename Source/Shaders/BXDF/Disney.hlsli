@@ -293,12 +293,13 @@ float3 EvaluateBRDF(HitInfo hitInfo, float3 V, float3 N, float3 L, out float pdf
     return f * abs(L.z);
 }
 
-float3 SampleBRDF(HitInfo hitInfo, float3 V, float3 N, out float3 L, out float pdf, inout uint random)
+// specular is false for the diffuse lobe, true for the reflection, glass and clearcoat lobes
+float3 SampleBRDF(HitInfo hitInfo, float3 V, float3 N, out float3 L, out float pdf, out bool specular, inout SampleGenerator sg)
 {
     pdf = 0.0;
 
-    float r1 = RandomFloat(random);
-    float r2 = RandomFloat(random);
+    float r1 = SampleFloat(sg);
+    float r2 = SampleFloat(sg);
 
     float3 T, B;
     Onb(N, T, B);
@@ -342,7 +343,8 @@ float3 SampleBRDF(HitInfo hitInfo, float3 V, float3 N, out float3 L, out float p
     cdf[4] = cdf[3] + clearCtPr;
 
     // Sample a lobe based on its importance
-    float r3 = RandomFloat(random);
+    float r3 = SampleFloat(sg);
+    specular = r3 >= cdf[0];
 
     if (r3 < cdf[0]) // Diffuse
     {
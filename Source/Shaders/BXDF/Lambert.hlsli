@@ -8,13 +8,15 @@ float3 EvaluateBRDF(HitInfo hitInfo, float3 V, float3 N, float3 L, inout float p
     return (1.0 / c_PI) * hitInfo.baseColor * dot(N, L);
 }
 
-float3 SampleBRDF(HitInfo hitInfo, float3 V, float3 N, inout float3 L, inout float pdf, inout uint randomNum)
+float3 SampleBRDF(HitInfo hitInfo, float3 V, float3 N, inout float3 L, inout float pdf, out bool specular, inout SampleGenerator sg)
 {
+    specular = false;
+
     float3 T = hitInfo.tangent;
     float3 B = hitInfo.bitangent;
 
-    float r1 = RandomFloat(randomNum);
-    float r2 = RandomFloat(randomNum);
+    float r1 = SampleFloat(sg);
+    float r2 = SampleFloat(sg);
 
     L = CosineSampleHemisphere(r1, r2);
     L = T * L.x + B * L.y + N * L.z;
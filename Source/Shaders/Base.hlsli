@@ -15,6 +15,8 @@ static const uint c_SizeOfTriangleIndices = 12;
 static const uint c_SizeOfPosition = 12;
 static const uint c_SizeOfNormal = 4;
 static const uint c_SizeOfTexcoord = 8;
+static const uint c_SizeOfQuantizedPosition = 6; // 3 x unorm16 of the geometry bounds
+static const uint c_SizeOfQuantizedTexcoord = 4; // 2 x half
 static const uint c_SizeOfJointIndices = 8;
 static const uint c_SizeOfJointWeights = 16;
 
@@ -45,9 +47,22 @@ struct HitInfo
     float eta;
     float ax, ay;
 
+};
+
+// Compact trace payload, TraceRay only returns what identifies the hit and RayGen reconstructs the surface from it
+struct RayPayload
+{
+    float distance;
+    uint instanceIndex;
+    uint primitiveIndex;
+    uint geometryIndex;
+    uint barycentrics; // 2 x UNORM16, see PackBarycentrics
+
     bool HasHit() { return distance < 1000; }
 };
 
+_Static_assert(sizeof(RayPayload) == 20, "RayPayload in HRay.cpp sizes the pipeline payload");
+
 #pragma endregion
 #pragma region Macros
 
@@ -145,6 +160,17 @@ float4 Unpack_RGBA8_SNORM(uint value)
     );
 }
 
+uint PackBarycentrics(float2 barycentrics)
+{
+    uint2 q = uint2(round(saturate(barycentrics) * 65535.0));
+    return q.x | (q.y << 16);
+}
+
+float2 UnpackBarycentrics(uint value)
+{
+    return float2(value & 0xffff, value >> 16) * (1.0 / 65535.0);
+}
+
 float RandomFloat(inout uint state)
 {
     state = state * 747796405 + 2891336453;
@@ -175,6 +201,13 @@ float2 RandomPointInCircle(inout uint rngState)
     return pointOnCircle * sqrt(RandomFloat(rngState));
 }
 
+float2 PointInCircle(float2 u)
+{
+    float angle = u.x * c_2PI;
+    float2 pointOnCircle = float2(cos(angle), sin(angle));
+    return pointOnCircle * sqrt(u.y);
+}
+
 float3 CosineSampleHemisphere(float r1, float r2)
 {
     float3 dir;
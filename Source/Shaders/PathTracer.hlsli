@@ -0,0 +1,690 @@
+#ifndef PATH_TRACER_H
+#define PATH_TRACER_H
+
+// Scene data, material evaluation, accumulation and the hit shaders shared by the megakernel (Main.hlsl)
+// and the wavefront (Wavefront.hlsl) integrators
+
+#include "Base.hlsli"
+#include "Sampler.hlsli"
+
+#define DISNEY_BRDF
+#include "BXDF/BXDF.hlsli"
+
+enum TonMapingType
+{
+    TonMapingType_None,
+    TonMapingType_WhatEver,
+    TonMapingType_ACES,
+    TonMapingType_ACESFitted,
+    TonMapingType_Filmic,
+    TonMapingType_Reinhard,
+};
+
+enum RenderingMode
+{
+    RenderingMode_PathTracing,
+    RenderingMode_Normals,
+    RenderingMode_Tangent,
+    RenderingMode_Bitangent
+};
+
+enum AlfaMode
+{
+    AlfaMode_Opaque,
+    AlfaMode_Mask,
+    AlfaMode_Blend
+};
+
+struct SceneInfo
+{
+    struct View
+    {
+        float4x4 worldToView;
+        float4x4 viewToClip;
+        float4x4 clipToWorld;
+
+        float3 cameraPosition;
+        int frameIndex;
+
+        float3 front; uint sampleOffset;
+        float3 up;    uint tileOffsetX;
+        float3 right; uint tileOffsetY;
+
+        float2 viewSize;
+        float2 viewSizeInv;
+
+        float3 focalCenter; int focalCenterPadding;
+
+        float halfWidth;
+        float halfHeight;
+        float2 halfWidthHeightPadding;
+
+        float minDistance;
+        float maxDistance;
+        float apertureRadius;
+        float focusFalloff;
+
+        float focusDistance;
+        float fov;
+        float2 padding0;
+
+        bool enableVisualFocusDistance;
+        bool enableDepthOfField;
+        float2 padding1;
+
+    } view;
+
+    struct Light
+    {
+        float4 groundColour;
+        float4 skyColourHorizon;
+        float4 skyColourZenith;
+
+        float rotation;
+        float totalSum;
+        float2 size;
+
+        float intensity;
+        uint descriptorIndex;
+        float2 envPaddding;
+
+        int directionalLightCount;
+        bool enableEnvironmentLight;  
+        float2 padding0;
+
+    } light;
+
+    struct Settings
+    {
+        int maxLighteBounces;
+        int maxSamples;
+        int renderingMode;
+        int samplerType;
+
+        bool enableCompensatedSummation;
+        float3 padding0;
+
+    } settings;
+
+    struct PostProssing
+    {
+        float exposure;
+        float gamma;
+        int tonMappingType;
+        int padding0;
+
+    } postProssing;
+};
+
+// HRay::GeometryData, four 16 byte lines. The any-hit shader only reads the first two
+struct GeometryData
+{
+    uint bufferIndices; // index buffer descriptor in the low 16 bits, vertex buffer descriptor in the high 16 bits
+    uint indexOffset;
+    uint materialIndex;
+    uint vertexLayout; // c_VertexLayoutFloat or c_VertexLayoutQuantized
+
+    uint texCoord0Offset;
+    uint texCoord1Offset;
+    uint positionOffset;
+    uint normalOffset;
+
+    float3 positionBias;
+    uint tangentOffset;
+
+    float3 positionScale;
+    uint indexCount;
+};
+
+// HRay::InstanceData, five 16 byte lines
+struct InstanceData
+{
+    row_major float3x4 transform; // object to world
+    uint normalMatrix[5];         // 3x3 row major halves, see GetNormalMatrix
+    uint id;
+    uint firstGeometryIndex;
+    uint padding;
+};
+
+// the C++ side asserts the same sizes and the field offsets, see HRay.cpp
+_Static_assert(sizeof(GeometryData) == 64, "GeometryData must match HRay::GeometryData");
+_Static_assert(sizeof(InstanceData) == 80, "InstanceData must match HRay::InstanceData");
+
+struct Material
+{
+    float4 baseColor;
+    float metallic;
+    float roughness;
+    float anisotropic;
+    float subsurface;
+    float specularTint;
+    float sheen;
+    float sheenTint;
+    float clearcoat;
+    float clearcoatRoughness;
+    float transmission;
+    float ior;
+    float3 emissiveColor;
+
+    uint baseTextureIndex;
+    uint emissiveTextureIndex;
+    uint metallicRoughnessTextureIndex;
+    uint normalTextureIndex;
+
+    int alfaMode;
+    float alphaCutoff;
+
+    int uvSet;
+    float3x3 uvMat;
+};
+
+struct DirectionalLightData
+{
+    float3 direction;
+    float3 color;
+    float intensity;
+    float angularRadius;
+    float haloSize;
+    float haloFalloff;
+};
+
+VK_BINDING(0, 1) ByteAddressBuffer bindlessBuffers[] : register(t0, space1);
+VK_BINDING(1, 1) Texture2D bindlessTextures[] : register(t0, space2);
+
+RaytracingAccelerationStructure TLAS : register(t0);
+StructuredBuffer<InstanceData> instanceData : register(t1);
+StructuredBuffer<GeometryData> geometryData : register(t2);
+StructuredBuffer<Material> materialData : register(t3);
+StructuredBuffer<DirectionalLightData> directionalLightData : register(t4);
+
+ConstantBuffer<SceneInfo> sceneInfoBuffer : register(b0);
+
+SamplerState materialSampler : register(s0);
+
+// rgb holds the radiance sum and a the sample count of the pixel, the two targets swap roles every dispatch
+RWTexture2D<float4> HDRColor : register(u0);
+RWTexture2D<float4> accumulationOutput : register(u1);
+RWTexture2D<float4> LDRColor : register(u2);
+RWTexture2D<float> depth : register(u3);
+RWTexture2D<uint> entitiesID : register(u4);
+RWTexture2D<float4> accumulationError : register(u5);
+
+// TLAS instance mask bits, HRay::c_instanceMask*. Each ray class only sees the instances visible to it
+static const uint c_InstanceMaskCamera = 1;
+static const uint c_InstanceMaskIndirect = 2;
+static const uint c_InstanceMaskReflection = 4;
+
+// mask of the ray leaving a surface, from the lobe SampleBRDF picked
+uint GetScatterRayMask(bool specular)
+{
+    return specular ? c_InstanceMaskReflection : c_InstanceMaskIndirect;
+}
+
+// finest lod requested per bindless texture index, read back by HRay::UpdateTextureStreaming and reset every frame.
+// u6 to u12 belong to the wavefront queues, see Wavefront.hlsl
+RWStructuredBuffer<uint> textureFeedback : register(u13);
+static const uint c_TextureFeedbackCapacity = 65536; // HRay::c_TextureFeedbackCapacity
+
+typedef BuiltInTriangleIntersectionAttributes HitAttributes;
+
+ByteAddressBuffer GetIndexBuffer(GeometryData geometry)
+{
+    return bindlessBuffers[NonUniformResourceIndex(geometry.bufferIndices & 0xffff)];
+}
+
+ByteAddressBuffer GetVertexBuffer(GeometryData geometry)
+{
+    return bindlessBuffers[NonUniformResourceIndex(geometry.bufferIndices >> 16)];
+}
+
+// inverse transpose of the object to world 3x3, scaled : the transformed normals need a normalize
+float3x3 GetNormalMatrix(InstanceData instance)
+{
+    float m[9];
+    for (uint i = 0; i < 9; i++)
+        m[i] = f16tof32(instance.normalMatrix[i / 2] >> ((i & 1) * 16));
+
+    return float3x3(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]);
+}
+
+// HRay::VertexLayout
+static const uint c_VertexLayoutFloat = 0;
+static const uint c_VertexLayoutQuantized = 1;
+
+float3 LoadPosition(ByteAddressBuffer vertexBuffer, GeometryData geometry, uint index)
+{
+    if (geometry.vertexLayout == c_VertexLayoutFloat)
+        return asfloat(vertexBuffer.Load3(geometry.positionOffset + index * c_SizeOfPosition));
+
+    // the 6 byte positions straddle two aligned words, the stream is padded for the last one
+    uint address = geometry.positionOffset + index * c_SizeOfQuantizedPosition;
+    uint2 words = vertexBuffer.Load2(address & ~3u);
+    uint3 q = (address & 2) ? uint3(words.x >> 16, words.y & 0xffff, words.y >> 16) : uint3(words.x & 0xffff, words.x >> 16, words.y & 0xffff);
+
+    return geometry.positionBias + float3(q) * geometry.positionScale;
+}
+
+float2 LoadTexcoord(ByteAddressBuffer vertexBuffer, GeometryData geometry, uint texCoordOffset, uint index)
+{
+    if (geometry.vertexLayout == c_VertexLayoutFloat)
+        return asfloat(vertexBuffer.Load2(texCoordOffset + index * c_SizeOfTexcoord));
+
+    uint packed = vertexBuffer.Load(texCoordOffset + index * c_SizeOfQuantizedTexcoord);
+    return f16tof32(uint2(packed, packed >> 16));
+}
+
+struct GeometrySample
+{
+    Material material;
+    int entityID;
+    int materialID;
+
+    float3 objectSpacePosition;
+    float4 tangent;
+    float3 flatNormal;
+    float3 geometryNormal;
+    float2 texcoord;
+    float texcoordLod; // 0.5 * log2(uv area / world area) of the triangle, see GetHitInfo
+};
+
+GeometrySample SampleGeometry(
+    uint instanceIndex,
+    uint triangleIndex,
+    uint geometryIndex,
+    float2 rayBarycentrics
+)
+{
+    GeometrySample gs;
+
+    InstanceData instance = instanceData[instanceIndex];
+    GeometryData geometry = geometryData[instance.firstGeometryIndex + geometryIndex];
+    gs.material = materialData[geometry.materialIndex];
+    gs.materialID = geometry.materialIndex;
+
+    gs.entityID = instance.id;
+
+    ByteAddressBuffer indexBuffer = GetIndexBuffer(geometry);
+    ByteAddressBuffer vertexBuffer = GetVertexBuffer(geometry);
+
+    float3 barycentrics = float3(1 - rayBarycentrics.x - rayBarycentrics.y, rayBarycentrics.x, rayBarycentrics.y);
+
+    uint3 indices = indexBuffer.Load3(geometry.indexOffset + triangleIndex * c_SizeOfTriangleIndices);
+
+    float3 vertexPositions[3];
+    {
+        vertexPositions[0] = LoadPosition(vertexBuffer, geometry, indices[0]);
+        vertexPositions[1] = LoadPosition(vertexBuffer, geometry, indices[1]);
+        vertexPositions[2] = LoadPosition(vertexBuffer, geometry, indices[2]);
+        gs.objectSpacePosition = Interpolate(vertexPositions, barycentrics);
+    }
+
+    if (geometry.normalOffset != c_Invalid)
+    {
+        float3 normals[3];
+        normals[0] = Unpack_RGB8_SNORM(vertexBuffer.Load(geometry.normalOffset + indices[0] * c_SizeOfNormal));
+        normals[1] = Unpack_RGB8_SNORM(vertexBuffer.Load(geometry.normalOffset + indices[1] * c_SizeOfNormal));
+        normals[2] = Unpack_RGB8_SNORM(vertexBuffer.Load(geometry.normalOffset + indices[2] * c_SizeOfNormal));
+        gs.geometryNormal = Interpolate(normals, barycentrics);
+        gs.geometryNormal = mul(GetNormalMatrix(instance), gs.geometryNormal);
+        gs.geometryNormal = normalize(gs.geometryNormal);
+    }
+
+    if (geometry.tangentOffset != c_Invalid)
+    {
+        float4 tangents[3];
+        tangents[0] = Unpack_RGBA8_SNORM(vertexBuffer.Load(geometry.tangentOffset + indices[0] * c_SizeOfNormal));
+        tangents[1] = Unpack_RGBA8_SNORM(vertexBuffer.Load(geometry.tangentOffset + indices[1] * c_SizeOfNormal));
+        tangents[2] = Unpack_RGBA8_SNORM(vertexBuffer.Load(geometry.tangentOffset + indices[2] * c_SizeOfNormal));
+        gs.tangent.xyz = Interpolate(tangents, barycentrics).xyz;
+        gs.tangent.xyz = mul(instance.transform, float4(gs.tangent.xyz, 0.0)).xyz;
+        gs.tangent.xyz = normalize(gs.tangent.xyz);
+        gs.tangent.w = tangents[0].w;
+    }
+
+    uint texCoordOffset = gs.material.uvSet == 0 ? geometry.texCoord0Offset : geometry.texCoord1Offset;
+    gs.texcoordLod = 0;
+
+    if (texCoordOffset != c_Invalid)
+    {
+        float2 vertexTexcoords[3];
+        vertexTexcoords[0] = LoadTexcoord(vertexBuffer, geometry, texCoordOffset, indices[0]);
+        vertexTexcoords[1] = LoadTexcoord(vertexBuffer, geometry, texCoordOffset, indices[1]);
+        vertexTexcoords[2] = LoadTexcoord(vertexBuffer, geometry, texCoordOffset, indices[2]);
+        gs.texcoord = Interpolate(vertexTexcoords, barycentrics);
+
+        // texel density of the triangle, the uv transform of the material and the instance scale both change it
+        float2 uv0 = mul(float3(vertexTexcoords[0], 1.0), gs.material.uvMat).xy;
+        float2 uv1 = mul(float3(vertexTexcoords[1], 1.0), gs.material.uvMat).xy;
+        float2 uv2 = mul(float3(vertexTexcoords[2], 1.0), gs.material.uvMat).xy;
+        float uvArea = abs((uv1.x - uv0.x) * (uv2.y - uv0.y) - (uv2.x - uv0.x) * (uv1.y - uv0.y));
+
+        float3 e1 = mul(instance.transform, float4(vertexPositions[1] - vertexPositions[0], 0.0)).xyz;
+        float3 e2 = mul(instance.transform, float4(vertexPositions[2] - vertexPositions[0], 0.0)).xyz;
+        float worldArea = length(cross(e1, e2));
+
+        gs.texcoordLod = 0.5 * log2(max(uvArea, 1e-12) / max(worldArea, 1e-12));
+    }
+
+    float3 objectSpaceFlatNormal = normalize(cross(vertexPositions[1] - vertexPositions[0], vertexPositions[2] - vertexPositions[0]));
+    gs.flatNormal = normalize(mul(GetNormalMatrix(instance), objectSpaceFlatNormal));
+
+    return gs;
+}
+
+float3 EvaluateEnvironmentLight(float3 rayOrigin, float3 rayDirection)
+{
+    float3 totalSunColor = 0;
+    float groundToSkyT = 1;
+
+    if (sceneInfoBuffer.light.enableEnvironmentLight)
+    {
+        float3 skyColourHorizon = sceneInfoBuffer.light.skyColourHorizon.rgb;
+        float3 skyColourZenith = sceneInfoBuffer.light.skyColourZenith.rgb;
+        float3 groundColour = sceneInfoBuffer.light.groundColour.rgb;
+
+        float skyT = pow(smoothstep(0.0, 0.4, rayDirection.y), 0.35);
+        groundToSkyT = smoothstep(-0.01, 0.0, rayDirection.y);
+        float3 skyGradient = lerp(skyColourHorizon, skyColourZenith, skyT);
+        totalSunColor += lerp(groundColour, skyGradient, groundToSkyT);
+    }
+
+    for (int i = 0; i < sceneInfoBuffer.light.directionalLightCount; i++)
+    {
+        DirectionalLightData light = directionalLightData[i];
+
+        float3 lightColorLinear = light.color;
+        float cosTheta = dot(normalize(rayDirection), -light.direction);
+        float softness = 0.05;
+        float sunDisk = smoothstep(cos(light.angularRadius + softness), cos(light.angularRadius), cosTheta);
+        float haloStart = light.angularRadius;
+        float haloEnd = light.angularRadius + light.haloSize;
+        float halo = smoothstep(cos(haloEnd), cos(haloStart), cosTheta);
+        //halo = pow(halo, light.haloFalloff);
+        float sunIntensity = sunDisk * light.intensity;
+        float haloIntensity = halo * light.intensity;
+
+        float3 sunContribution = (sunIntensity + haloIntensity) * lightColorLinear * (groundToSkyT >= 1);
+
+        totalSunColor += sunContribution;
+    }
+
+    return totalSunColor;
+}
+
+float4 EvaluateEnvironmenMap(
+    float3 rayDirection, 
+    float rotation,
+    float totalSum,
+    float2 size,
+    uint descriptorIndex
+)
+{
+    float theta = acos(clamp(rayDirection.y, -1.0, 1.0));
+    float2 uv = float2((c_PI + atan2(rayDirection.z, rayDirection.x)) * c_Inv_2PI, theta * c_Inv_PI) + float2(rotation, 0.0);
+
+    Texture2D texture = bindlessTextures[NonUniformResourceIndex(descriptorIndex)];
+    float3 color = texture.SampleLevel(materialSampler, uv, 0).rgb;
+    float pdf = Luminance(color) / totalSum;
+
+    return float4(color, (pdf * size.x * size.y) / (c_2PI * c_PI * sin(theta)));
+}
+
+// Ray cones : texture footprint of a path, the width grows with the distance travelled and the spread with every bounce.
+// Reference: Akenine-Moller et al., Improved Shader and Texture Level of Detail Using Ray Cones, JCGT 2021
+struct RayCone
+{
+    float width;
+    float spreadAngle;
+};
+
+// angle covered by one pixel of the primary rays
+float GetPixelSpreadAngle()
+{
+    return atan(2.0 * tan(sceneInfoBuffer.view.fov * 0.5) * sceneInfoBuffer.view.viewSizeInv.y);
+}
+
+RayCone CreatePrimaryRayCone()
+{
+    RayCone cone;
+    cone.width = 0;
+    cone.spreadAngle = GetPixelSpreadAngle();
+
+    return cone;
+}
+
+RayCone PropagateRayCone(RayCone cone, float distance)
+{
+    cone.width += cone.spreadAngle * distance;
+    return cone;
+}
+
+// the curvature of the surface is not known, the BSDF roughness widens the cone instead
+RayCone ScatterRayCone(RayCone cone, float roughness)
+{
+    cone.spreadAngle = min(cone.spreadAngle + 2.0 * roughness * roughness, c_PI * 0.5);
+    return cone;
+}
+
+// The lod is stored before the texture size is applied : the shader only sees the resident levels of a streamed
+// texture while the streamer knows the size of the full chain. 1/64 steps from -32, the min keeps the finest request
+void RecordTextureFeedback(uint textureIndex, float lod)
+{
+    if (textureIndex >= c_TextureFeedbackCapacity)
+        return;
+
+    uint encoded = uint(clamp(lod + 32.0, 0.0, 63.0) * 64.0);
+    if (encoded < textureFeedback[textureIndex])
+        InterlockedMin(textureFeedback[textureIndex], encoded);
+}
+
+// lod of GetHitInfo is in log2 of texels per unit of uv, the texture size turns it into a mip level.
+// A streamed texture starts at its finest resident level, its size already accounts for the missing ones
+float GetTextureLod(uint textureIndex, Texture2D texture, float lod)
+{
+    RecordTextureFeedback(textureIndex, lod);
+
+    uint width, height;
+    texture.GetDimensions(width, height);
+
+    return max(lod + 0.5 * log2(float(width) * float(height)), 0.0);
+}
+
+// Radiance reaching a ray that left the scene, sky model or environment map
+float3 EvaluateMiss(float3 rayOrigin, float3 rayDirection)
+{
+    if (sceneInfoBuffer.light.descriptorIndex == c_Invalid)
+        return EvaluateEnvironmentLight(rayOrigin, rayDirection) * sceneInfoBuffer.light.intensity;
+
+    float4 envMapColPdf = EvaluateEnvironmenMap(
+        rayDirection,
+        sceneInfoBuffer.light.rotation,
+        sceneInfoBuffer.light.totalSum,
+        sceneInfoBuffer.light.size,
+        sceneInfoBuffer.light.descriptorIndex
+    );
+
+    return envMapColPdf.rgb * sceneInfoBuffer.light.intensity;
+}
+
+// Material fetch and Disney parameter setup for a hit, runs in RayGen so that the trace payload stays small.
+// coneWidth is the width of the ray cone at the hit, it selects the mip level of the material textures
+HitInfo GetHitInfo(RayPayload rayPayload, float3 rayDirection, float coneWidth)
+{
+    HitInfo hitInfo;
+
+    GeometrySample gs = SampleGeometry(rayPayload.instanceIndex, rayPayload.primitiveIndex, rayPayload.geometryIndex, UnpackBarycentrics(rayPayload.barycentrics));
+
+    float2 uv = mul(float3(gs.texcoord, 1.0), gs.material.uvMat).xy;
+    float lod = gs.texcoordLod + log2(max(coneWidth, 1e-8) / max(abs(dot(gs.flatNormal, rayDirection)), 1e-4));
+    
+    float4 baseColor = gs.material.baseColor;
+    if (gs.material.baseTextureIndex != c_Invalid)
+    {
+        Texture2D texture  = bindlessTextures[NonUniformResourceIndex(gs.material.baseTextureIndex)];
+        baseColor          *= texture.SampleLevel(materialSampler, uv, GetTextureLod(gs.material.baseTextureIndex, texture, lod));
+    }
+
+    float3 emissiveColor = gs.material.emissiveColor;
+    if (gs.material.emissiveTextureIndex != c_Invalid)
+    {
+        Texture2D texture  = bindlessTextures[NonUniformResourceIndex(gs.material.emissiveTextureIndex)];
+        emissiveColor     *= texture.SampleLevel(materialSampler, uv, GetTextureLod(gs.material.emissiveTextureIndex, texture, lod)).rgb;
+    }
+
+    float metallic  = gs.material.metallic;
+    float roughness = max(gs.material.roughness, 0.001);
+    if (gs.material.metallicRoughnessTextureIndex != c_Invalid)
+    {
+        Texture2D texture = bindlessTextures[NonUniformResourceIndex(gs.material.metallicRoughnessTextureIndex)];
+        float3 texColor   = texture.SampleLevel(materialSampler, uv, GetTextureLod(gs.material.metallicRoughnessTextureIndex, texture, lod)).rgb;
+        metallic          = texColor.b;
+        roughness         = max(texColor.g * texColor.g, 0.001);
+    }
+
+    {
+        float3 n = gs.geometryNormal;
+        float3 t = gs.tangent.xyz;
+        float3 b = normalize(cross(n, t) * gs.tangent.w);
+
+        hitInfo.normal = n;
+        hitInfo.tangent = t;
+        hitInfo.bitangent = b;
+
+        if (gs.material.normalTextureIndex != c_Invalid)
+        {
+            Texture2D texture = bindlessTextures[NonUniformResourceIndex(gs.material.normalTextureIndex)];
+            // z is rebuilt from xy : BC5 normal maps only store two channels, see HRay::CookTexture
+            float2 xy = texture.SampleLevel(materialSampler, uv, GetTextureLod(gs.material.normalTextureIndex, texture, lod)).rg * 2.0f - 1.0f;
+            float3 texNormal = normalize(float3(xy, sqrt(saturate(1.0f - dot(xy, xy)))));
+            float3x3 tbn = float3x3(t, b, n);
+            hitInfo.normal = normalize(mul(texNormal, tbn));
+        }
+
+        hitInfo.ffnormal = dot(n, -rayDirection) > 0.0 ? hitInfo.normal : -hitInfo.normal;
+    }
+
+    hitInfo.baseColor          = baseColor.rgb;
+    hitInfo.metallic           = metallic;
+    hitInfo.roughness          = roughness;
+    hitInfo.emissive           = emissiveColor;
+    hitInfo.distance           = rayPayload.distance;
+    hitInfo.anisotropic        = gs.material.anisotropic;
+    hitInfo.subsurface         = gs.material.subsurface;
+    hitInfo.specularTint       = gs.material.specularTint;
+    hitInfo.sheen              = gs.material.sheen;
+    hitInfo.sheenTint          = gs.material.sheenTint;
+    hitInfo.clearcoat          = gs.material.clearcoat;
+    hitInfo.clearcoatRoughness = lerp(0.1, 0.001, gs.material.clearcoatRoughness); // Remapping from gloss to roughness
+    hitInfo.transmission       = gs.material.transmission;
+    hitInfo.ior                = gs.material.ior;
+    hitInfo.entityID           = gs.entityID;
+
+    float aspect = sqrt(1.0 - hitInfo.anisotropic * 0.9);
+    hitInfo.ax = max(0.001, hitInfo.roughness / aspect);
+    hitInfo.ay = max(0.001, hitInfo.roughness * aspect);
+    hitInfo.eta = dot(rayDirection, hitInfo.normal) < 0.0 ? (1.0 / hitInfo.ior) : hitInfo.ior;
+
+    return hitInfo;
+}
+
+// Accumulation : sums and sample counts instead of a running average, pixels may carry different sample counts.
+// sampleSum holds the radiance of the settings.maxSamples samples traced for the pixel this frame
+void Accumulate(uint2 rayIndex, float3 sampleSum)
+{
+    float3 color;
+    {
+        // the previous target holds a stale frame after a reset
+        bool reset = sceneInfoBuffer.view.frameIndex == 0;
+        float4 prev = reset ? 0 : accumulationOutput[rayIndex];
+
+        precise float3 sum;
+        if (sceneInfoBuffer.settings.enableCompensatedSummation)
+        {
+            // Kahan summation, the error term carries the low order bits lost by the previous additions
+            precise float3 error = reset ? 0 : accumulationError[rayIndex].rgb;
+            precise float3 y = sampleSum - error;
+            sum = prev.rgb + y;
+            accumulationError[rayIndex] = float4((sum - prev.rgb) - y, 0);
+        }
+        else
+        {
+            sum = prev.rgb + sampleSum;
+        }
+
+        float sampleCount = prev.a + sceneInfoBuffer.settings.maxSamples;
+        HDRColor[rayIndex] = float4(sum, sampleCount);
+        color = sum / sampleCount;
+    }
+    
+    // Tone Mapping
+    {
+    
+        switch (sceneInfoBuffer.postProssing.tonMappingType)
+        {
+        case TonMapingType_None:                                                                        break;
+        case TonMapingType_WhatEver:   color = Tonemap(color, 1.5);                                     break;
+        case TonMapingType_ACES:       color = ACES(color);                                             break;
+        case TonMapingType_ACESFitted: color = ACESFitted(color);                                       break;
+        case TonMapingType_Filmic:     color = Filmic(color, sceneInfoBuffer.postProssing.exposure);    break;
+        case TonMapingType_Reinhard:   color = Reinhard(color, sceneInfoBuffer.postProssing.exposure);  break;
+        }
+        
+        LDRColor[rayIndex] = float4(color, 1);
+    }
+}
+
+[shader("closesthit")]
+void ClosestHit(inout RayPayload payload : SV_RayPayload, HitAttributes attr : SV_IntersectionAttributes)
+{
+    payload.distance       = RayTCurrent();
+    payload.instanceIndex  = InstanceID();
+    payload.primitiveIndex = PrimitiveIndex();
+    payload.geometryIndex  = GeometryIndex();
+    payload.barycentrics   = PackBarycentrics(attr.barycentrics);
+}
+
+
+// Only the mixed triangles of the alpha tested geometries reach the any-hit shader, SubmitMesh flags the opaque ones
+// and leaves the transparent ones out, see Opacity.cpp. The fetch is limited to the indices and texture coordinates
+[shader("anyhit")]
+void AnyHit(inout RayPayload payload : SV_RayPayload, HitAttributes attr : SV_IntersectionAttributes)
+{
+    InstanceData instance = instanceData[InstanceID()];
+    GeometryData geometry = geometryData[instance.firstGeometryIndex + GeometryIndex()];
+    Material material = materialData[geometry.materialIndex];
+
+    if (material.alfaMode != AlfaMode_Blend)
+        return;
+
+    float4 baseColor = material.baseColor;
+    uint texCoordOffset = material.uvSet == 0 ? geometry.texCoord0Offset : geometry.texCoord1Offset;
+    if (material.baseTextureIndex != c_Invalid && texCoordOffset != c_Invalid)
+    {
+        ByteAddressBuffer indexBuffer = GetIndexBuffer(geometry);
+        ByteAddressBuffer vertexBuffer = GetVertexBuffer(geometry);
+
+        uint3 indices = indexBuffer.Load3(geometry.indexOffset + PrimitiveIndex() * c_SizeOfTriangleIndices);
+        float2 vertexTexcoords[3];
+        vertexTexcoords[0] = LoadTexcoord(vertexBuffer, geometry, texCoordOffset, indices[0]);
+        vertexTexcoords[1] = LoadTexcoord(vertexBuffer, geometry, texCoordOffset, indices[1]);
+        vertexTexcoords[2] = LoadTexcoord(vertexBuffer, geometry, texCoordOffset, indices[2]);
+
+        float3 barycentrics = float3(1 - attr.barycentrics.x - attr.barycentrics.y, attr.barycentrics.x, attr.barycentrics.y);
+        float2 uv = mul(float3(Interpolate(vertexTexcoords, barycentrics), 1.0), material.uvMat).xy;
+
+        // the footprint needs the positions, the finest resident level keeps the cutout sharp instead
+        Texture2D texture = bindlessTextures[NonUniformResourceIndex(material.baseTextureIndex)];
+        baseColor *= texture.SampleLevel(materialSampler, uv, 0);
+    }
+
+    if (baseColor.a < material.alphaCutoff)
+        IgnoreHit();
+}
+
+[shader("miss")]
+void Miss(inout RayPayload payload : SV_RayPayload)
+{
+    payload.distance = 1000;
+}
+
+#endif // PATH_TRACER_H
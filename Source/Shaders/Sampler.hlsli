@@ -0,0 +1,113 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+// Owen scrambled Sobol points, decorrelated between pixels by a blue noise toroidal shift.
+// The Sobol matrices and the blue noise table are generated on the CPU, see HRay::Init.
+// Reference: Burley, Practical Hash-based Owen Scrambling, JCGT 2020
+//            Georgiev and Fajardo, Blue-noise Dithered Sampling, SIGGRAPH 2016
+
+static const uint c_SobolDimensions = 16;
+static const uint c_SobolBits = 32;
+static const uint c_BlueNoiseSize = 64;
+
+enum SamplerType
+{
+    SamplerType_Random,
+    SamplerType_Sobol
+};
+
+StructuredBuffer<uint> sobolMatrices : register(t5);
+StructuredBuffer<float> blueNoise : register(t6);
+
+struct SampleGenerator
+{
+    uint type;
+    uint2 pixel;
+    uint index;
+    uint dimension;
+    uint state;
+};
+
+uint Hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint LaineKarrasPermutation(uint x, uint seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint NestedUniformScramble(uint x, uint seed)
+{
+    x = reversebits(x);
+    x = LaineKarrasPermutation(x, seed);
+    return reversebits(x);
+}
+
+uint SobolSample(uint index, uint dimension)
+{
+    uint result = 0;
+    for (uint bit = 0; index != 0; index >>= 1, bit++)
+    {
+        if (index & 1)
+            result ^= sobolMatrices[dimension * c_SobolBits + bit];
+    }
+
+    return result;
+}
+
+SampleGenerator CreateSampleGenerator(uint type, uint2 pixel, uint viewWidth, uint sampleIndex)
+{
+    SampleGenerator sg;
+    sg.type = type;
+    sg.pixel = pixel;
+    sg.index = sampleIndex;
+    sg.dimension = 0;
+    sg.state = (pixel.y * viewWidth + pixel.x) + sampleIndex * 895623;
+
+    return sg;
+}
+
+// Dimensions are assigned per event (camera, bounce) so that the same event always reads the same dimensions
+void SetDimension(inout SampleGenerator sg, uint dimension)
+{
+    sg.dimension = dimension;
+}
+
+float SampleFloat(inout SampleGenerator sg)
+{
+    if (sg.type == SamplerType_Random)
+        return RandomFloat(sg.state);
+
+    uint dimension = sg.dimension++;
+
+    // past the table the dimensions are padded : same matrices, shuffled index and a new scramble seed
+    uint padding = dimension / c_SobolDimensions;
+    uint seed = Hash(dimension);
+    uint index = padding == 0 ? sg.index : NestedUniformScramble(sg.index, Hash(padding * 0x9e3779b9u));
+    float u = NestedUniformScramble(SobolSample(index, dimension % c_SobolDimensions), seed) * (1.0 / 4294967296.0);
+
+    // each dimension reads the blue noise table at a different offset so that dimensions stay uncorrelated
+    uint2 p = (sg.pixel + uint2(seed, seed >> 16)) % c_BlueNoiseSize;
+    return min(frac(u + blueNoise[p.y * c_BlueNoiseSize + p.x]), 0.99999994);
+}
+
+float2 SampleFloat2(inout SampleGenerator sg)
+{
+    float x = SampleFloat(sg);
+    float y = SampleFloat(sg);
+    return float2(x, y);
+}
+
+#endif // SAMPLER_H
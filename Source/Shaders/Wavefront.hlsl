@@ -0,0 +1,301 @@
+#include "PathTracer.hlsli"
+
+// Wavefront integrator : the bounce loop of Main.hlsl split into stages over persistent path, ray and hit queues.
+// HRay::EndScene dispatches them in order, per sample Generate then per bounce Extend, Count, the compute scan
+// of WavefrontScan.hlsl, Scatter and Shade, and Resolve once per frame. Paths are indexed by their target pixel,
+// one path per pixel is in flight at a time. Hits are binned by material before shading so that the threads of a
+// wave evaluate the same material and read the same textures, see HRay::BinHitsByMaterial for the CPU reference.
+// Reference: Laine, Karras and Aila, Megakernels Considered Harmful: Wavefront Path Tracing on GPUs, HPG 2013
+// The connect (shadow ray) stage of the paper has no counterpart, the integrator has no next event estimation.
+
+struct PathState
+{
+    float3 origin;
+    uint rngState; // SampleGenerator.state, only the random sampler advances it
+    float3 direction;
+    float coneWidth;
+    float3 throughput;
+    float coneSpreadAngle;
+    uint rayMask; // instance mask of the next ray, see c_InstanceMaskCamera
+};
+
+struct HitRecord
+{
+    RayPayload payload;
+    uint pathIndex;
+    uint materialIndex; // c_Invalid for a miss
+};
+
+struct WavefrontConstants
+{
+    uint sampleIndex; // sample of the frame, 0 to settings.maxSamples - 1
+    uint bounce;
+    uint materialCount;
+    uint targetWidth;
+};
+
+static const uint c_HitCountIndex = 2; // counters[0] and counters[1] hold the sizes of the two ray queues
+
+VK_PUSH_CONSTANT ConstantBuffer<WavefrontConstants> wavefront : register(b1);
+
+RWStructuredBuffer<PathState> paths : register(u6);
+RWStructuredBuffer<uint> rayQueues : register(u7);      // two queues of pathCount entries, bounces alternate between them
+RWStructuredBuffer<HitRecord> hits : register(u8);      // indexed like the ray queue of the bounce
+RWStructuredBuffer<uint> sortedHits : register(u9);     // hit indices grouped by material
+RWStructuredBuffer<float4> radianceSum : register(u10); // radiance of the samples of this frame, per path
+RWStructuredBuffer<uint> counters : register(u11);
+RWStructuredBuffer<uint> materialBins : register(u12);  // materialCount counts followed by materialCount offsets
+
+uint GetPathCount()
+{
+    return DispatchRaysDimensions().x * DispatchRaysDimensions().y;
+}
+
+uint GetThreadIndex()
+{
+    return DispatchRaysIndex().y * DispatchRaysDimensions().x + DispatchRaysIndex().x;
+}
+
+uint2 GetRayIndex(uint pathIndex)
+{
+    return uint2(pathIndex % wavefront.targetWidth, pathIndex / wavefront.targetWidth);
+}
+
+uint2 GetPixel(uint2 rayIndex)
+{
+    return rayIndex + uint2(sceneInfoBuffer.view.tileOffsetX, sceneInfoBuffer.view.tileOffsetY);
+}
+
+float2 GetNDC(uint2 pixel)
+{
+    float2 ndc = (float2(pixel) + 0.5) * sceneInfoBuffer.view.viewSizeInv;
+    ndc        = ndc * 2.0 - 1.0;
+    ndc.y      = -ndc.y; // Flip Y for DX
+
+    return ndc;
+}
+
+float3 GetFocusPoint(float2 ndc)
+{
+    float3 offset = ndc.x * sceneInfoBuffer.view.halfWidth * sceneInfoBuffer.view.right + ndc.y * sceneInfoBuffer.view.halfHeight * sceneInfoBuffer.view.up;
+    return sceneInfoBuffer.view.focalCenter + offset;
+}
+
+SampleGenerator GetSampleGenerator(uint2 pixel)
+{
+    uint sampleIndex = sceneInfoBuffer.view.frameIndex + sceneInfoBuffer.view.sampleOffset + wavefront.sampleIndex;
+    return CreateSampleGenerator(sceneInfoBuffer.settings.samplerType, pixel, (uint)sceneInfoBuffer.view.viewSize.x, sampleIndex);
+}
+
+// Camera rays of one sample, all paths enter the first ray queue
+[shader("raygeneration")]
+void Generate()
+{
+    uint2 rayIndex = DispatchRaysIndex().xy;
+    uint pathIndex = GetThreadIndex();
+    uint2 pixel    = GetPixel(rayIndex);
+    float2 ndc     = GetNDC(pixel);
+
+    float3 up    = sceneInfoBuffer.view.up;
+    float3 right = sceneInfoBuffer.view.right;
+
+    RayDesc primaryRay = CreatePrimaryRay(ndc, sceneInfoBuffer.view.clipToWorld, sceneInfoBuffer.view.cameraPosition);
+    float3 rayOrigin   = primaryRay.Origin;
+    float3 focusPoint  = GetFocusPoint(ndc);
+
+    SampleGenerator sg = GetSampleGenerator(pixel);
+
+    // dimensions 0-3 : aperture and depth of field, same layout as Main.hlsl
+    float2 apertureSample = SampleFloat2(sg);
+    float2 originSample = SampleFloat2(sg);
+
+    if (sceneInfoBuffer.view.enableDepthOfField)
+    {
+        float2 originOffset = PointInCircle(originSample) * sceneInfoBuffer.view.focusFalloff;
+        rayOrigin           = sceneInfoBuffer.view.cameraPosition + right * originOffset.x + up * originOffset.y;
+    }
+
+    float2 targetOffset = PointInCircle(apertureSample) * sceneInfoBuffer.view.apertureRadius;
+
+    PathState path;
+    path.origin     = rayOrigin;
+    path.direction  = normalize((focusPoint + right * targetOffset.x + up * targetOffset.y) - rayOrigin);
+    path.throughput = 1;
+    path.rngState   = sg.state;
+    path.rayMask    = c_InstanceMaskCamera;
+
+    RayCone cone         = CreatePrimaryRayCone();
+    path.coneWidth       = cone.width;
+    path.coneSpreadAngle = cone.spreadAngle;
+    paths[pathIndex] = path;
+
+    rayQueues[pathIndex] = pathIndex;
+
+    if (wavefront.sampleIndex == 0)
+        radianceSum[pathIndex] = 0;
+
+    if (pathIndex == 0)
+        counters[0] = GetPathCount();
+}
+
+// Traces the rays queued for this bounce, misses are resolved here and never reach the shading stage
+[shader("raygeneration")]
+void Extend()
+{
+    uint index = GetThreadIndex();
+    uint queue = wavefront.bounce & 1;
+    if (index >= counters[queue])
+        return;
+
+    uint pathIndex = rayQueues[queue * GetPathCount() + index];
+    PathState path = paths[pathIndex];
+
+    float near = sceneInfoBuffer.view.minDistance;
+    float far  = sceneInfoBuffer.view.maxDistance;
+
+    RayDesc ray;
+    ray.Origin    = path.origin;
+    ray.Direction = path.direction;
+    ray.TMin      = near;
+    ray.TMax      = far;
+
+    RayPayload rayPayload;
+    TraceRay(TLAS, RAY_FLAG_NONE, path.rayMask, 0, 0, 0, ray, rayPayload);
+    float3 hitPoint = path.origin + path.direction * rayPayload.distance;
+
+    HitRecord hit;
+    hit.payload       = rayPayload;
+    hit.pathIndex     = pathIndex;
+    hit.materialIndex = c_Invalid;
+
+    float depthValue = 1;
+    uint entityID = c_Invalid;
+
+    if (rayPayload.HasHit())
+    {
+        InstanceData instance = instanceData[rayPayload.instanceIndex];
+        hit.materialIndex = geometryData[instance.firstGeometryIndex + rayPayload.geometryIndex].materialIndex;
+
+        depthValue = ComputeDepth(path.origin, sceneInfoBuffer.view.front, hitPoint, near, far);
+        entityID = instance.id;
+    }
+    else
+    {
+        radianceSum[pathIndex].rgb += EvaluateMiss(path.origin, path.direction) * path.throughput;
+    }
+
+    if (wavefront.bounce == 0)
+    {
+        uint2 rayIndex = GetRayIndex(pathIndex);
+        depth[rayIndex] = depthValue;
+        entitiesID[rayIndex] = entityID;
+
+        if (sceneInfoBuffer.view.enableVisualFocusDistance && length(hitPoint - GetFocusPoint(GetNDC(GetPixel(rayIndex)))) <= 0.2)
+            radianceSum[pathIndex].rgb += float3(0, 0.1, 0);
+    }
+
+    hits[index] = hit;
+}
+
+// Material histogram of the hits of this bounce
+[shader("raygeneration")]
+void Count()
+{
+    uint index = GetThreadIndex();
+    if (index >= counters[wavefront.bounce & 1])
+        return;
+
+    uint materialIndex = hits[index].materialIndex;
+    if (materialIndex != c_Invalid)
+        InterlockedAdd(materialBins[materialIndex], 1);
+}
+
+// Writes every hit at the next free slot of its material bin
+[shader("raygeneration")]
+void Scatter()
+{
+    uint index = GetThreadIndex();
+    if (index >= counters[wavefront.bounce & 1])
+        return;
+
+    uint materialIndex = hits[index].materialIndex;
+    if (materialIndex == c_Invalid)
+        return;
+
+    uint slot;
+    InterlockedAdd(materialBins[wavefront.materialCount + materialIndex], 1, slot);
+    sortedHits[slot] = index;
+}
+
+// Shades the hits in material order and queues the continuation rays for the next bounce
+[shader("raygeneration")]
+void Shade()
+{
+    uint index = GetThreadIndex();
+    if (index >= counters[c_HitCountIndex])
+        return;
+
+    HitRecord hit  = hits[sortedHits[index]];
+    uint pathIndex = hit.pathIndex;
+    PathState path = paths[pathIndex];
+
+    RayCone cone;
+    cone.width       = path.coneWidth;
+    cone.spreadAngle = path.coneSpreadAngle;
+    cone             = PropagateRayCone(cone, hit.payload.distance);
+
+    HitInfo hitInfo = GetHitInfo(hit.payload, path.direction, cone.width);
+    float3 hitPoint = path.origin + path.direction * hit.payload.distance;
+
+    radianceSum[pathIndex].rgb += hitInfo.emissive * path.throughput;
+
+    SampleGenerator sg = GetSampleGenerator(GetPixel(GetRayIndex(pathIndex)));
+    sg.state = path.rngState;
+
+    // 4 dimensions per bounce : BSDF direction, lobe selection and Russian roulette
+    uint bounce = wavefront.bounce;
+    SetDimension(sg, 4 + bounce * 4);
+
+    float3 L;
+    float pdf;
+    bool specular;
+    float3 f = SampleBRDF(hitInfo, -path.direction, hitInfo.ffnormal, L, pdf, specular, sg);
+    if (pdf <= 0)
+        return;
+
+    path.throughput *= f / pdf;
+    path.direction = L;
+    path.origin = hitPoint + L * c_RayOffset;
+    path.rayMask = GetScatterRayMask(specular);
+
+    cone                 = ScatterRayCone(cone, hitInfo.roughness);
+    path.coneWidth       = cone.width;
+    path.coneSpreadAngle = cone.spreadAngle;
+
+    // Russian roulette
+    if (bounce > 2)
+    {
+        float q = min(max(path.throughput.x, max(path.throughput.y, path.throughput.z)) + 0.001, 0.95);
+        SetDimension(sg, 4 + bounce * 4 + 3);
+        if (SampleFloat(sg) > q) return;
+        path.throughput /= q;
+    }
+
+    if (bounce + 1 >= sceneInfoBuffer.settings.maxLighteBounces)
+        return;
+
+    path.rngState = sg.state;
+    paths[pathIndex] = path;
+
+    uint queue = (bounce + 1) & 1;
+    uint slot;
+    InterlockedAdd(counters[queue], 1, slot);
+    rayQueues[queue * GetPathCount() + slot] = pathIndex;
+}
+
+// Adds the samples of the frame to the accumulation targets
+[shader("raygeneration")]
+void Resolve()
+{
+    Accumulate(DispatchRaysIndex().xy, radianceSum[GetThreadIndex()].rgb);
+}
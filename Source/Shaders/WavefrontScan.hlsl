@@ -0,0 +1,62 @@
+#include "Base.hlsli"
+
+// Exclusive prefix sum of the material histogram of Wavefront.hlsl, dispatched between its Count and Scatter
+// stages. A single group walks the histogram in chunks of c_GroupSize materials, each chunk is scanned in
+// groupshared memory and offset by the total of the previous chunks. Also resets the counts for the next bounce
+// and empties the ray queue Shade appends to. See HRay::BinHitsByMaterial for the CPU reference.
+// Reference: Hillis and Steele, Data Parallel Algorithms, 1986
+
+struct WavefrontScanConstants
+{
+    uint bounce;
+    uint materialCount;
+};
+
+static const uint c_GroupSize = 256;
+static const uint c_HitCountIndex = 2; // counters[0] and counters[1] hold the sizes of the two ray queues
+
+VK_PUSH_CONSTANT ConstantBuffer<WavefrontScanConstants> scan : register(b0);
+
+RWStructuredBuffer<uint> counters : register(u0);
+RWStructuredBuffer<uint> materialBins : register(u1); // materialCount counts followed by materialCount offsets
+
+groupshared uint sums[c_GroupSize];
+
+[numthreads(c_GroupSize, 1, 1)]
+void Main(uint thread : SV_GroupIndex)
+{
+    uint materialCount = scan.materialCount;
+    uint total = 0;
+
+    for (uint first = 0; first < materialCount; first += c_GroupSize)
+    {
+        uint i = first + thread;
+        uint count = i < materialCount ? materialBins[i] : 0;
+        sums[thread] = count;
+        GroupMemoryBarrierWithGroupSync();
+
+        // inclusive scan of the chunk in log2(c_GroupSize) steps
+        for (uint stride = 1; stride < c_GroupSize; stride *= 2)
+        {
+            uint value = thread >= stride ? sums[thread - stride] : 0;
+            GroupMemoryBarrierWithGroupSync();
+            sums[thread] += value;
+            GroupMemoryBarrierWithGroupSync();
+        }
+
+        if (i < materialCount)
+        {
+            materialBins[i] = 0;
+            materialBins[materialCount + i] = total + sums[thread] - count;
+        }
+
+        total += sums[c_GroupSize - 1];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (thread == 0)
+    {
+        counters[c_HitCountIndex] = total;
+        counters[(scan.bounce + 1) & 1] = 0;
+    }
+}
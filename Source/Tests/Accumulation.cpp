@@ -0,0 +1,76 @@
+#include "Tests.h"
+
+import HRay;
+import Math;
+import std;
+
+// Drift of the accumulated radiance sums over a million frames of one sample, the summation of Accumulate
+// with and without enableCompensatedSummation
+
+constexpr uint32_t c_FrameCount = 1000000;
+
+struct Drift
+{
+    double naive;
+    double compensated;
+};
+
+// relative error of the mean of both sums against a double precision sum of the same samples
+template<typename SampleFn>
+static Drift MeasureDrift(SampleFn&& sample)
+{
+    Math::float3 naive = { 0.0f, 0.0f, 0.0f };
+    Math::float3 naiveError = { 0.0f, 0.0f, 0.0f }; // unused without compensation
+    Math::float3 sum = { 0.0f, 0.0f, 0.0f };
+    Math::float3 error = { 0.0f, 0.0f, 0.0f };
+    double reference = 0.0;
+
+    for (uint32_t i = 0; i < c_FrameCount; i++)
+    {
+        float value = sample();
+        reference += value;
+
+        HRay::AccumulateSample(naive, naiveError, Math::float3(value, value, value), false);
+        HRay::AccumulateSample(sum, error, Math::float3(value, value, value), true);
+    }
+
+    return { std::abs(naive.x - reference) / reference, std::abs(sum.x - reference) / reference };
+}
+
+TEST_CASE(CompensatedSummationConstant)
+{
+    auto drift = MeasureDrift([]() { return 0.7f; });
+    std::println("    relative error naive {:.3e} compensated {:.3e}", drift.naive, drift.compensated);
+
+    CHECK(drift.compensated < 1e-6);
+    CHECK(drift.naive > 1e-3); // the float sum stops resolving 0.7 long before a million frames
+}
+
+TEST_CASE(CompensatedSummationFireflies)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    // mostly dim samples and rare bright ones
+    auto drift = MeasureDrift([&]() {
+        float u = uniform(rng);
+        return u < 0.001f ? u * 10000.0f : u * 0.5f;
+    });
+    std::println("    relative error naive {:.3e} compensated {:.3e}", drift.naive, drift.compensated);
+
+    CHECK(drift.compensated < 1e-6);
+    CHECK(drift.compensated <= drift.naive);
+}
+
+TEST_CASE(ResolveAccumulation)
+{
+    Math::float4 pixels[] = {
+        { 6.0f, 3.0f, 1.5f, 3.0f },
+        { 1.0f, 1.0f, 1.0f, 0.0f }, // no sample yet
+    };
+
+    HRay::ResolveAccumulation(pixels, std::size(pixels));
+
+    CHECK(pixels[0].x == 2.0f && pixels[0].y == 1.0f && pixels[0].z == 0.5f && pixels[0].w == 1.0f);
+    CHECK(pixels[1].x == 0.0f && pixels[1].y == 0.0f && pixels[1].z == 0.0f && pixels[1].w == 1.0f);
+}
@@ -0,0 +1,50 @@
+#include "Tests.h"
+
+import std;
+
+// CPU tests of the renderer, mostly the C++ references of shader code : run HRayTests, the exit code is the
+// number of failed tests
+
+static Tests::TestCase* s_First = nullptr;
+static Tests::TestCase* s_Last = nullptr;
+static int s_Failures = 0;
+
+Tests::TestCase::TestCase(const char* name, void (*function)())
+    : name(name)
+    , function(function)
+{
+    (s_Last ? s_Last->next : s_First) = this;
+    s_Last = this;
+}
+
+void Tests::Fail(const char* expression, const char* file, int line)
+{
+    std::println("    {}({}) : CHECK({}) failed", file, line, expression);
+    s_Failures++;
+}
+
+int main(int argc, char** argv)
+{
+    // an argument runs the tests whose name contains it
+    std::string_view filter = argc > 1 ? argv[1] : "";
+
+    int failedTests = 0;
+    for (auto* test = s_First; test; test = test->next)
+    {
+        if (!std::string_view(test->name).contains(filter))
+            continue;
+
+        std::println("[ RUN  ] {}", test->name);
+
+        int failures = s_Failures;
+        test->function();
+
+        bool passed = failures == s_Failures;
+        failedTests += passed ? 0 : 1;
+        std::println("[ {} ] {}", passed ? "PASS" : "FAIL", test->name);
+    }
+
+    std::println("{} failed test(s)", failedTests);
+
+    return failedTests;
+}
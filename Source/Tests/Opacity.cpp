@@ -0,0 +1,102 @@
+#include "Tests.h"
+
+import HRay;
+import Math;
+import std;
+
+// Triangle opacity classification of the alpha tested geometries. The maps are built by hand, the test meshes stay
+// under one ParallelFor chunk
+
+constexpr float c_AlphaCutoff = 0.5f;
+
+// 4 x 4 cells, the left half opaque and the right half transparent
+static HRay::AlphaMap CreateHalfMap()
+{
+    HRay::AlphaMap map;
+    map.width = 4;
+    map.height = 4;
+    map.minAlpha.resize(16);
+    map.maxAlpha.resize(16);
+
+    for (uint32_t cell = 0; cell < 16; cell++)
+        map.minAlpha[cell] = map.maxAlpha[cell] = (cell % 4) < 2 ? 255 : 0;
+
+    return map;
+}
+
+static HRay::TriangleOpacity ClassifyStrip(const HRay::AlphaMap& map, float u0, float u1, float baseAlpha = 1.0f)
+{
+    return HRay::ClassifyTriangle(map, { u0, 0.1f }, { u1, 0.1f }, { u0, 0.9f }, baseAlpha, c_AlphaCutoff);
+}
+
+TEST_CASE(ClassifyTriangle)
+{
+    auto map = CreateHalfMap();
+
+    CHECK(ClassifyStrip(map, 0.05f, 0.45f) == HRay::TriangleOpacity::Opaque);
+    CHECK(ClassifyStrip(map, 0.55f, 0.95f) == HRay::TriangleOpacity::Transparent);
+    CHECK(ClassifyStrip(map, 0.3f, 0.7f) == HRay::TriangleOpacity::Mixed);
+
+    // the base color alpha scales the texture alpha
+    CHECK(ClassifyStrip(map, 0.05f, 0.45f, 0.4f) == HRay::TriangleOpacity::Transparent);
+
+    // the texture wraps like the material sampler
+    CHECK(ClassifyStrip(map, 1.05f, 1.45f) == HRay::TriangleOpacity::Opaque);
+    CHECK(ClassifyStrip(map, -0.45f, -0.05f) == HRay::TriangleOpacity::Transparent);
+    CHECK(ClassifyStrip(map, -0.2f, 0.2f) == HRay::TriangleOpacity::Mixed);
+
+    // a footprint wider than the texture covers every cell
+    CHECK(ClassifyStrip(map, 0.05f, 1.2f) == HRay::TriangleOpacity::Mixed);
+
+    // an opaque texture has no map, only the base color alpha decides
+    HRay::AlphaMap opaque;
+    CHECK(ClassifyStrip(opaque, 0.55f, 0.95f) == HRay::TriangleOpacity::Opaque);
+    CHECK(ClassifyStrip(opaque, 0.55f, 0.95f, 0.25f) == HRay::TriangleOpacity::Transparent);
+}
+
+TEST_CASE(ClassifyTriangles)
+{
+    const Math::float3x3 identity(1.0f);
+
+    // Mask or Blend without a base texture : no map and no texture coordinates
+    {
+        std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+        auto expected = indices;
+
+        auto opacity = HRay::ClassifyTriangles(indices, {}, identity, nullptr, 1.0f, c_AlphaCutoff);
+        CHECK(opacity.opaqueCount == 2 && opacity.mixedCount == 0);
+        CHECK(indices == expected);
+
+        opacity = HRay::ClassifyTriangles(indices, {}, identity, nullptr, 0.25f, c_AlphaCutoff);
+        CHECK(opacity.opaqueCount == 0 && opacity.mixedCount == 0);
+
+        HRay::AlphaMap opaque;
+        opacity = HRay::ClassifyTriangles(indices, {}, identity, &opaque, 1.0f, c_AlphaCutoff);
+        CHECK(opacity.opaqueCount == 2 && opacity.mixedCount == 0);
+    }
+
+    // one transparent, one mixed and one wrapped opaque triangle, sorted opaque then mixed then transparent
+    {
+        auto map = CreateHalfMap();
+
+        std::vector<Math::float2> texcoords = {
+            { 0.55f, 0.1f }, { 0.95f, 0.1f }, { 0.55f, 0.9f },
+            { 0.3f, 0.1f }, { 0.7f, 0.1f }, { 0.3f, 0.9f },
+            { 1.05f, 0.1f }, { 1.45f, 0.1f }, { 1.05f, 0.9f },
+        };
+
+        std::vector<uint32_t> indices = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+        auto opacity = HRay::ClassifyTriangles(indices, texcoords, identity, &map, 1.0f, c_AlphaCutoff);
+
+        CHECK(opacity.opaqueCount == 1 && opacity.mixedCount == 1);
+        CHECK((indices == std::vector<uint32_t>{ 6, 7, 8, 3, 4, 5, 0, 1, 2 }));
+
+        // the material transform applies before the lookup, an offset of half the texture swaps the halves
+        Math::float3x3 offset(1.0f);
+        offset[0][2] = 0.5f; // u + 0.5, see the transpose in ClassifyTriangles
+
+        indices = { 0, 1, 2 };
+        opacity = HRay::ClassifyTriangles(indices, texcoords, offset, &map, 1.0f, c_AlphaCutoff);
+        CHECK(opacity.opaqueCount == 1 && opacity.mixedCount == 0);
+    }
+}
@@ -0,0 +1,177 @@
+#include "Tests.h"
+
+import HRay;
+import Math;
+import std;
+
+// Round trips of the packed formats the shaders decode
+
+constexpr float c_UNorm16Step = 1.0f / 65535.0f;
+
+TEST_CASE(BarycentricsRoundTrip)
+{
+    CHECK(HRay::PackBarycentrics({ 0.0f, 0.0f }) == 0);
+    CHECK(HRay::PackBarycentrics({ 1.0f, 0.0f }) == 0xffff);
+    CHECK(HRay::PackBarycentrics({ 0.0f, 1.0f }) == 0xffff0000);
+
+    // out of range values and nan are saturated
+    CHECK(HRay::PackBarycentrics({ -0.25f, 1.5f }) == HRay::PackBarycentrics({ 0.0f, 1.0f }));
+    CHECK(HRay::PackBarycentrics({ std::numeric_limits<float>::quiet_NaN(), 0.0f }) == 0);
+
+    // the third barycentric and the hit position are rebuilt from the two stored ones
+    const Math::float3 p0 = { -500.0f, 20.0f, 3.0f };
+    const Math::float3 e1 = { 1000.0f, 0.0f, 0.0f };
+    const Math::float3 e2 = { 0.0f, 0.0f, -1000.0f };
+
+    float maxError = 0.0f;
+    float maxPositionError = 0.0f;
+    constexpr uint32_t c_Steps = 997;
+    for (uint32_t i = 0; i <= c_Steps; i++)
+    {
+        for (uint32_t j = 0; i + j <= c_Steps; j++)
+        {
+            Math::float2 b = { float(i) / c_Steps, float(j) / c_Steps };
+            Math::float2 d = HRay::UnpackBarycentrics(HRay::PackBarycentrics(b));
+
+            maxError = std::max({ maxError, std::abs(d.x - b.x), std::abs(d.y - b.y), std::abs((1.0f - d.x - d.y) - (1.0f - b.x - b.y)) });
+
+            Math::float3 position = p0 + e1 * b.x + e2 * b.y;
+            Math::float3 decoded = p0 + e1 * d.x + e2 * d.y;
+            Math::float3 delta = Math::abs(decoded - position);
+            maxPositionError = std::max({ maxPositionError, delta.x, delta.y, delta.z });
+        }
+    }
+
+    std::println("    max barycentric error {:.3e}, position error {:.3e} on a 1000 unit triangle", maxError, maxPositionError);
+
+    CHECK(maxError <= c_UNorm16Step * 1.01f);
+    CHECK(maxPositionError <= 1000.0f * c_UNorm16Step * 0.55f);
+}
+
+// reference decode, every finite half is exactly representable as a float
+static float HalfToFloat(uint16_t value)
+{
+    float magnitude = (value & 0x7c00) ? std::ldexp(float((value & 0x3ff) | 0x400), ((value >> 10) & 0x1f) - 25) : std::ldexp(float(value & 0x3ff), -24);
+    return (value & 0x8000) ? -magnitude : magnitude;
+}
+
+TEST_CASE(FloatToHalf)
+{
+    CHECK(HRay::FloatToHalf(0.0f) == 0x0000);
+    CHECK(HRay::FloatToHalf(-0.0f) == 0x8000);
+    CHECK(HRay::FloatToHalf(1.0f) == 0x3c00);
+    CHECK(HRay::FloatToHalf(-2.0f) == 0xc000);
+    CHECK(HRay::FloatToHalf(65504.0f) == 0x7bff);
+    CHECK(HRay::FloatToHalf(std::ldexp(1.0f, -24)) == 0x0001); // smallest subnormal
+    CHECK(HRay::FloatToHalf(std::ldexp(1.0f, -14)) == 0x0400); // smallest normal
+
+    // ties round to even, in the normal and the subnormal range
+    CHECK(HRay::FloatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3c00);
+    CHECK(HRay::FloatToHalf(1.0f + std::ldexp(3.0f, -11)) == 0x3c02);
+    CHECK(HRay::FloatToHalf(std::ldexp(1.0f, -25)) == 0x0000);
+    CHECK(HRay::FloatToHalf(std::ldexp(3.0f, -25)) == 0x0002);
+
+    // a carry out of the mantissa moves to the next exponent, past the largest half to infinity
+    CHECK(HRay::FloatToHalf(std::nextafter(2.0f, 0.0f)) == 0x4000);
+    CHECK(HRay::FloatToHalf(65520.0f) == 0x7c00);
+    CHECK(HRay::FloatToHalf(1e10f) == 0x7c00);
+    CHECK(HRay::FloatToHalf(-1e10f) == 0xfc00);
+    CHECK(HRay::FloatToHalf(std::numeric_limits<float>::infinity()) == 0x7c00);
+    CHECK((HRay::FloatToHalf(std::numeric_limits<float>::quiet_NaN()) & 0x7fff) > 0x7c00);
+    CHECK(HRay::FloatToHalf(std::ldexp(1.0f, -30)) == 0x0000);
+
+    // every finite half converts back to itself, and the midpoints to a neighbour
+    uint32_t mismatches = 0;
+    for (uint32_t h = 0; h < 0x10000; h++)
+    {
+        if ((h & 0x7c00) == 0x7c00)
+            continue;
+
+        float value = HalfToFloat(uint16_t(h));
+        mismatches += HRay::FloatToHalf(value) != h;
+
+        if ((h & 0x7fff) < 0x7bff)
+        {
+            float next = HalfToFloat(uint16_t(h + 1));
+            uint16_t half = HRay::FloatToHalf(std::midpoint(value, next));
+            mismatches += half != h && half != h + 1;
+        }
+    }
+
+    CHECK(mismatches == 0);
+}
+
+// the shaders decode InstanceData::normalMatrix as a row major 3x3, see GetNormalMatrix in PathTracer.hlsli
+static std::array<float, 9> UnpackNormalMatrix(const std::array<uint32_t, 5>& packed)
+{
+    std::array<float, 9> m;
+    for (uint32_t i = 0; i < 9; i++)
+        m[i] = HalfToFloat(uint16_t(packed[i / 2] >> ((i & 1) * 16)));
+
+    return m;
+}
+
+static Math::float3 Mul(const std::array<float, 9>& m, Math::float3 v)
+{
+    return {
+        m[0] * v.x + m[1] * v.y + m[2] * v.z,
+        m[3] * v.x + m[4] * v.y + m[5] * v.z,
+        m[6] * v.x + m[7] * v.y + m[8] * v.z
+    };
+}
+
+TEST_CASE(NormalMatrixPacking)
+{
+    // uniform scales pack to the identity, the last half is padding
+    {
+        Math::float4x4 wt(3.0f);
+        wt[3] = Math::float4(5.0f, -2.0f, 1.0f, 1.0f);
+
+        auto packed = HRay::PackNormalMatrix(wt);
+        CHECK(packed[0] == 0x00003c00 && packed[1] == 0 && packed[2] == 0x00003c00 && packed[3] == 0 && packed[4] == 0x00003c00);
+    }
+
+    // transformed normals stay perpendicular to the transformed surface
+    Math::float4x4 rotation = Math::toMat4(Math::angleAxis(Math::radians(37.0f), Math::normalize(Math::float3(1.0f, 2.0f, -0.5f))));
+
+    Math::float4x4 nonUniform(1.0f);
+    nonUniform[0][0] = 4.0f;
+    nonUniform[1][1] = 0.25f;
+    nonUniform[2][2] = -1.5f; // mirrored
+
+    Math::float4x4 shear(1.0f);
+    shear[1][0] = 0.75f;
+    shear[2][1] = -0.5f;
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+    float maxCosine = 0.0f;
+    for (const Math::float4x4& wt : { rotation, nonUniform, rotation * nonUniform, shear * rotation * nonUniform })
+    {
+        auto packed = HRay::PackNormalMatrix(wt);
+        auto normalMatrix = UnpackNormalMatrix(packed);
+
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            Math::float3 normal = Math::normalize(Math::float3(uniform(rng), uniform(rng), uniform(rng)));
+            Math::float3 tangent = Math::normalize(Math::cross(normal, Math::float3(uniform(rng), uniform(rng), uniform(rng))));
+
+            Math::float3 worldNormal = Math::normalize(Mul(normalMatrix, normal));
+            Math::float3 worldTangent = Math::normalize(Math::float3x3(wt) * tangent);
+            maxCosine = std::max(maxCosine, std::abs(worldNormal.x * worldTangent.x + worldNormal.y * worldTangent.y + worldNormal.z * worldTangent.z));
+        }
+    }
+
+    std::println("    max cosine between transformed normals and tangents {:.3e}", maxCosine);
+    CHECK(maxCosine < 2e-3f);
+
+    // a flat instance keeps finite halves
+    {
+        Math::float4x4 flat(1.0f);
+        flat[1][1] = 0.0f;
+
+        for (uint32_t word : HRay::PackNormalMatrix(flat))
+            CHECK((word & 0x7c00) != 0x7c00 && (word & 0x7c000000) != 0x7c000000);
+    }
+}
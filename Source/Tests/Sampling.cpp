@@ -0,0 +1,85 @@
+#include "Tests.h"
+
+import HRay;
+import std;
+
+// Error of the Owen scrambled Sobol sampler against independent uniform samples. Each pixel shifts the points by
+// its blue noise value, the RMSE is measured over random shifts like over the pixels of a flat region
+
+struct Integrand
+{
+    const char* name;
+    float (*function)(float x, float y);
+    double reference;
+    double maxErrorRatio; // Sobol RMSE / random RMSE at c_SampleCount
+};
+
+static const Integrand c_Integrands[] = {
+    { "gaussian",     [](float x, float y) { return std::exp(-(x * x + y * y)); }, std::pow(std::sqrt(std::numbers::pi) * 0.5 * std::erf(1.0), 2.0), 0.2 },
+    { "quarter disk", [](float x, float y) { return x * x + y * y < 1.0f ? 1.0f : 0.0f; }, std::numbers::pi / 4.0, 0.5 },
+};
+
+constexpr uint32_t c_SampleCount = 1024;
+constexpr uint32_t c_PixelCount = 128;
+
+// dimension pairs of the camera (pixel and lens) and of the first bounces, see SetDimension in Main.hlsl
+constexpr uint32_t c_DimensionPairs[] = { 0, 2, 4, 8, 12, 16, 20, 24, 28 };
+
+TEST_CASE(SobolErrorReduction)
+{
+    auto matrices = HRay::GenerateSobolMatrices();
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    for (uint32_t dimension : c_DimensionPairs)
+    {
+        for (const auto& integrand : c_Integrands)
+        {
+            double sobolError = 0.0;
+            double randomError = 0.0;
+
+            for (uint32_t pixel = 0; pixel < c_PixelCount; pixel++)
+            {
+                float shiftX = uniform(rng);
+                float shiftY = uniform(rng);
+
+                double sobolSum = 0.0;
+                double randomSum = 0.0;
+                for (uint32_t i = 0; i < c_SampleCount; i++)
+                {
+                    float x = HRay::SampleSobol(matrices, i, dimension, shiftX);
+                    float y = HRay::SampleSobol(matrices, i, dimension + 1, shiftY);
+                    sobolSum += integrand.function(x, y);
+                    randomSum += integrand.function(uniform(rng), uniform(rng));
+                }
+
+                sobolError += std::pow(sobolSum / c_SampleCount - integrand.reference, 2.0);
+                randomError += std::pow(randomSum / c_SampleCount - integrand.reference, 2.0);
+            }
+
+            double ratio = std::sqrt(sobolError / randomError);
+            std::println("    dimensions {:2}, {:2} {:12} : RMSE ratio {:.3f}", dimension, dimension + 1, integrand.name, ratio);
+
+            CHECK(ratio < integrand.maxErrorRatio);
+        }
+    }
+}
+
+TEST_CASE(SobolStratification)
+{
+    auto matrices = HRay::GenerateSobolMatrices();
+
+    // the first 2^k points of every dimension fall one per interval of size 2^-k, scrambling keeps it
+    for (uint32_t dimension = 0; dimension < HRay::c_SobolDimensions * 2; dimension++)
+    {
+        for (uint32_t k : { 4u, 8u, 10u })
+        {
+            std::vector<uint32_t> counts(1u << k, 0);
+            for (uint32_t i = 0; i < (1u << k); i++)
+                counts[uint32_t(HRay::SampleSobol(matrices, i, dimension, 0.0f) * float(1u << k))]++;
+
+            CHECK(std::ranges::all_of(counts, [](uint32_t count) { return count == 1; }));
+        }
+    }
+}
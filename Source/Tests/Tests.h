@@ -0,0 +1,25 @@
+#pragma once
+
+// Minimal test registry for the CPU side of the renderer. TEST_CASE registers a function that main runs,
+// CHECK reports a failed expression and keeps the test running
+
+namespace Tests {
+
+    struct TestCase
+    {
+        const char* name;
+        void (*function)();
+        TestCase* next = nullptr;
+
+        TestCase(const char* name, void (*function)());
+    };
+
+    void Fail(const char* expression, const char* file, int line);
+}
+
+#define TEST_CASE(name)                                     \
+    static void name();                                     \
+    static Tests::TestCase name##TestCase(#name, name);     \
+    static void name()
+
+#define CHECK(expression) do { if (!(expression)) Tests::Fail(#expression, __FILE__, __LINE__); } while (false)
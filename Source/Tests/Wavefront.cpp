@@ -0,0 +1,60 @@
+#include "Tests.h"
+
+import HRay;
+import std;
+
+// BinHitsByMaterial is the CPU reference of the Count, scan and Scatter passes of the wavefront integrator
+
+TEST_CASE(BinHitsByMaterial)
+{
+    // more materials than a group of WavefrontScan.hlsl scans at once
+    constexpr uint32_t c_MaterialCount = 600;
+    constexpr uint32_t c_HitCount = 100000;
+
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<uint32_t> material(0, c_MaterialCount + c_MaterialCount / 4);
+
+    std::vector<uint32_t> hitMaterials(c_HitCount);
+    for (auto& materialIndex : hitMaterials)
+    {
+        materialIndex = material(rng);
+        if (materialIndex >= c_MaterialCount)
+            materialIndex = HRay::c_Invalid; // miss
+    }
+
+    std::vector<uint32_t> sortedHits;
+    HRay::BinHitsByMaterial(hitMaterials, c_MaterialCount, sortedHits);
+
+    uint32_t hitCount = uint32_t(std::ranges::count_if(hitMaterials, [](uint32_t materialIndex) { return materialIndex != HRay::c_Invalid; }));
+    CHECK(sortedHits.size() == hitCount);
+
+    // every hit once, grouped by ascending material and in hit order inside a bin
+    std::vector<bool> seen(c_HitCount, false);
+    bool sorted = true;
+    for (size_t i = 0; i < sortedHits.size(); i++)
+    {
+        uint32_t hit = sortedHits[i];
+        CHECK(hit < c_HitCount);
+        if (hit >= c_HitCount)
+            return;
+
+        CHECK(!seen[hit] && hitMaterials[hit] != HRay::c_Invalid);
+        seen[hit] = true;
+
+        if (i > 0)
+        {
+            uint32_t previous = sortedHits[i - 1];
+            sorted &= hitMaterials[previous] < hitMaterials[hit] || (hitMaterials[previous] == hitMaterials[hit] && previous < hit);
+        }
+    }
+
+    CHECK(sorted);
+
+    // no hits, and only misses
+    HRay::BinHitsByMaterial({}, c_MaterialCount, sortedHits);
+    CHECK(sortedHits.empty());
+
+    std::vector<uint32_t> misses(64, HRay::c_Invalid);
+    HRay::BinHitsByMaterial(misses, c_MaterialCount, sortedHits);
+    CHECK(sortedHits.empty());
+}
@@ -63,6 +63,11 @@ workspace "HRay"
                 "Resources/Icons/resource.h",
             }
 
+            removefiles {
+            
+                "Source/Tests/**",
+            }
+
             includedirs {
             
                 "Source",
@@ -88,4 +93,44 @@ workspace "HRay"
                 "%{prj.location}/Source/HRay/Embeded", -- cacheDir
                 "--header"                             -- args
             )
+
+        -- CPU tests of the renderer module, the shader headers come from the HRay build
+        project "HRayTests"
+            kind "ConsoleApp"
+            language "C++"
+            cppdialect "C++latest"
+            staticruntime "off"
+            targetdir (binOutputDir)
+            objdir (IntermediatesOutputDir)
+
+            dependson { "HRay" }
+
+            LinkHydraApp(includSourceCode)
+            SetHydraFilters()
+
+            files {
+            
+                "Source/Tests/**.h",
+                "Source/Tests/**.cpp",
+                "Source/HRay/HRay.cppm",
+                "Source/HRay/HRay.cpp",
+                "Source/HRay/Opacity.cpp",
+                "Source/HRay/Quantization.cpp",
+                "Source/HRay/Textures.cpp",
+            }
+
+            includedirs {
+            
+                "Source",
+            }
+
+            links {
+            
+                "Assets",
+            }
+
+            buildoptions {
+            
+                AddCppm("Assets"),
+            }
     group ""